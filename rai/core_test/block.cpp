@@ -267,12 +267,48 @@ TEST (state_block, hashing)
 	((uint8_t *)&balance.data)[0] ^= 0x1;
 	block.balance_set (balance);
 	ASSERT_EQ (hash, block.hash ());
-	block.hashables.link.bytes[0] ^= 0x1;
+	auto link (block.link ());
+	link.bytes[0] ^= 0x1;
+	block.link_set (link);
 	ASSERT_NE (hash, block.hash ());
-	block.hashables.link.bytes[0] ^= 0x1;
+	link.bytes[0] ^= 0x1;
+	block.link_set (link);
 	ASSERT_EQ (hash, block.hash ());
 }
 
+TEST (state_block, hash_memoized)
+{
+	rai::keypair key;
+	rai::state_block block (key.pub, 0, 12345, key.pub, 0, 0, key.prv, key.pub, 0);
+	auto computations (rai::base_block::hash_computations.load ());
+	auto hash (block.hash ());
+	for (auto i (0); i < 10; ++i)
+	{
+		ASSERT_EQ (hash, block.hash ());
+	}
+	// Already computed when the block was signed
+	ASSERT_EQ (computations, rai::base_block::hash_computations.load ());
+	rai::state_block copy (block);
+	ASSERT_EQ (hash, copy.hash ());
+	ASSERT_EQ (computations, rai::base_block::hash_computations.load ());
+	block.work_set (1);
+	block.signature_set (rai::uint512_union (0));
+	ASSERT_EQ (hash, block.hash ());
+	ASSERT_EQ (computations, rai::base_block::hash_computations.load ());
+	block.balance_set (1);
+	ASSERT_NE (hash, block.hash ());
+	ASSERT_EQ (computations + 1, rai::base_block::hash_computations.load ());
+	std::vector<uint8_t> bytes;
+	{
+		rai::vectorstream stream (bytes);
+		copy.serialize (stream);
+	}
+	rai::bufferstream stream (bytes.data (), bytes.size ());
+	ASSERT_FALSE (block.deserialize (stream));
+	ASSERT_EQ (hash, block.hash ());
+	ASSERT_EQ (computations + 2, rai::base_block::hash_computations.load ());
+}
+
 TEST (state_block, subtype)
 {
 	bool init (false);
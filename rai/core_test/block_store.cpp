@@ -214,6 +214,62 @@ TEST (unchecked, double_put)
 	store.unchecked_put (transaction, block1->previous (), block1);
 	auto block3 (store.unchecked_get (transaction, block1->previous ()));
 	ASSERT_EQ (block3.size (), 1);
+	store.flush (transaction);
+	store.unchecked_put (transaction, block1->previous (), block1);
+	ASSERT_EQ (1, store.unchecked_count (transaction));
+}
+
+TEST (unchecked, del_dependency)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::keypair key;
+	auto block1 (std::make_shared<rai::state_block> (key.pub, 1, 0, key.pub, 2, 0, key.prv, key.pub, 5));
+	auto block2 (std::make_shared<rai::state_block> (key.pub, 1, 0, key.pub, 3, 0, key.prv, key.pub, 5));
+	auto block3 (std::make_shared<rai::state_block> (key.pub, 2, 0, key.pub, 3, 0, key.prv, key.pub, 5));
+	rai::transaction transaction (store.environment, nullptr, true);
+	store.unchecked_put (transaction, block1->previous (), block1);
+	store.flush (transaction);
+	store.unchecked_put (transaction, block2->previous (), block2);
+	store.unchecked_put (transaction, block3->previous (), block3);
+	ASSERT_EQ (2, store.unchecked_get (transaction, block1->previous ()).size ());
+	store.unchecked_del (transaction, block1->previous ());
+	ASSERT_TRUE (store.unchecked_get (transaction, block1->previous ()).empty ());
+	ASSERT_EQ (1, store.unchecked_get (transaction, block3->previous ()).size ());
+	ASSERT_EQ (1, store.unchecked_count (transaction));
+}
+
+TEST (unchecked, expire)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::keypair key;
+	auto block1 (std::make_shared<rai::state_block> (key.pub, 1, 0, key.pub, 2, 0, key.prv, key.pub, 5));
+	rai::transaction transaction (store.environment, nullptr, true);
+	store.unchecked_put (transaction, block1->previous (), block1);
+	store.flush (transaction);
+	ASSERT_EQ (0, store.unchecked_expire (transaction, 0, 16));
+	ASSERT_EQ (1, store.unchecked_count (transaction));
+	ASSERT_EQ (1, store.unchecked_expire (transaction, std::numeric_limits<uint64_t>::max (), 16));
+	ASSERT_EQ (0, store.unchecked_count (transaction));
+	ASSERT_TRUE (store.unchecked_get (transaction, block1->previous ()).empty ());
+}
+
+TEST (unchecked, cache_spill)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::keypair key;
+	rai::transaction transaction (store.environment, nullptr, true);
+	for (size_t i (0); i <= rai::block_store::unchecked_cache_max; ++i)
+	{
+		store.unchecked_put (transaction, i + 1, std::make_shared<rai::state_block> (key.pub, i + 1, 0, key.pub, 2, 0, key.prv, key.pub, 5));
+	}
+	ASSERT_TRUE (store.unchecked_cache.empty ());
+	ASSERT_EQ (rai::block_store::unchecked_cache_max + 1, store.unchecked_count (transaction));
 }
 
 TEST (checksum, simple)
@@ -279,10 +335,13 @@ TEST (block_store, one_bootstrap)
 	auto begin (store.unchecked_begin (transaction));
 	auto end (store.unchecked_end ());
 	ASSERT_NE (end, begin);
-	auto hash1 (begin->first.uint256 ());
-	ASSERT_EQ (block1->hash (), hash1);
-	auto block2 (rai::deserialize_block (begin->second));
-	ASSERT_EQ (*block1, *block2);
+	rai::unchecked_key key1 (begin->first);
+	ASSERT_EQ (block1->hash (), key1.dependency);
+	ASSERT_EQ (block1->hash (), key1.hash);
+	rai::bufferstream stream (reinterpret_cast<uint8_t const *> (begin->second.data ()), begin->second.size ());
+	rai::unchecked_info info;
+	ASSERT_FALSE (info.deserialize (stream));
+	ASSERT_EQ (*block1, *info.block);
 	++begin;
 	ASSERT_EQ (end, begin);
 }
@@ -548,6 +607,89 @@ TEST (block_store, account_count)
 	ASSERT_EQ (1, store.account_count (rai::transaction (store.environment, nullptr, false)));
 }
 
+TEST (block_store, account_cache)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path (), 128, rai::account_cache::shard_count);
+	ASSERT_TRUE (!init);
+	rai::stat stats;
+	store.account_cache.stats = &stats;
+	rai::account account1 (1);
+	rai::account account2 (2);
+	rai::account_info info1 (1, 2, 3, 4, 5, 6, 7);
+	rai::account_info info2 (8, 9, 10, 11, 12, 13, 14);
+	rai::account_info info;
+	{
+		rai::transaction transaction (store.environment, nullptr, true);
+		store.account_put (transaction, account1, info1);
+		ASSERT_FALSE (store.account_get (transaction, account1, info));
+		ASSERT_EQ (info1, info);
+	}
+	ASSERT_EQ (1, store.account_cache.size ());
+	{
+		// A reader started before a commit keeps seeing its own snapshot
+		rai::transaction old_transaction (store.environment, nullptr, false);
+		store.account_put (rai::transaction (store.environment, nullptr, true), account1, info2);
+		ASSERT_FALSE (store.account_get (old_transaction, account1, info));
+		ASSERT_EQ (info1, info);
+	}
+	ASSERT_FALSE (store.account_get (rai::transaction (store.environment, nullptr, false), account1, info));
+	ASSERT_EQ (info2, info);
+	store.account_cache.flush_stats ();
+	ASSERT_EQ (1, stats.count (rai::stat::type::account_cache, rai::stat::detail::hit, rai::stat::dir::in));
+	// Both accounts land in the same shard which holds a single entry
+	store.account_put (rai::transaction (store.environment, nullptr, true), account2, info1);
+	ASSERT_EQ (1, store.account_cache.size ());
+	ASSERT_EQ (1, stats.count (rai::stat::type::account_cache, rai::stat::detail::eviction, rai::stat::dir::in));
+	ASSERT_FALSE (store.account_get (rai::transaction (store.environment, nullptr, false), account1, info));
+	ASSERT_EQ (info2, info);
+	store.account_del (rai::transaction (store.environment, nullptr, true), account1);
+	ASSERT_TRUE (store.account_get (rai::transaction (store.environment, nullptr, false), account1, info));
+	ASSERT_FALSE (store.account_get (rai::transaction (store.environment, nullptr, false), account2, info));
+	ASSERT_EQ (info1, info);
+}
+
+TEST (block_store, rep_weights)
+{
+	auto path (rai::unique_path ());
+	rai::account rep1 (1);
+	rai::account rep2 (2);
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_TRUE (!init);
+		{
+			rai::transaction transaction (store.environment, nullptr, true);
+			store.representation_put (transaction, rep1, 100);
+			store.representation_put (transaction, rep2, 200);
+			ASSERT_EQ (100, store.representation_get (transaction, rep1));
+			ASSERT_EQ (200, store.representation_get (transaction, rep2));
+		}
+		ASSERT_EQ (2, store.rep_weights.size ());
+		auto top (store.rep_weights.top (1));
+		ASSERT_EQ (1, top.size ());
+		ASSERT_EQ (rep2, top[0].first);
+		ASSERT_EQ (200, top[0].second);
+		{
+			// A reader started before a commit keeps seeing its own snapshot
+			rai::transaction old_transaction (store.environment, nullptr, false);
+			store.representation_put (rai::transaction (store.environment, nullptr, true), rep1, 300);
+			ASSERT_EQ (100, store.representation_get (old_transaction, rep1));
+		}
+		ASSERT_EQ (300, store.representation_get (rai::transaction (store.environment, nullptr, false), rep1));
+		top = store.rep_weights.top (2);
+		ASSERT_EQ (2, top.size ());
+		ASSERT_EQ (rep1, top[0].first);
+		ASSERT_EQ (rep2, top[1].first);
+	}
+	// Weights are loaded from disk when the store is opened
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_TRUE (!init);
+	ASSERT_EQ (2, store.rep_weights.size ());
+	ASSERT_EQ (300, store.representation_get (rai::transaction (store.environment, nullptr, false), rep1));
+}
+
 TEST (block_store, sequence_increment)
 {
 	bool init (false);
@@ -609,6 +751,207 @@ TEST(block_store, upgrade_v11_v12)
 	ASSERT_TRUE (store.account_get (transaction, rai::genesis_account, info));
 }
 
+TEST (block_store, upgrade_v13_v14)
+{
+	auto path (rai::unique_path ());
+	rai::genesis genesis;
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_TRUE (!init);
+		rai::transaction transaction (store.environment, nullptr, true);
+		genesis.initialize (transaction, store);
+		store.delegator_del (transaction, genesis.block ().representative (), rai::genesis_account);
+		ASSERT_EQ (0, store.delegator_count (transaction, genesis.block ().representative ()));
+		store.version_put (transaction, 13);
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (13, store.version_get (transaction));
+	ASSERT_EQ (1, store.delegator_count (transaction, genesis.block ().representative ()));
+}
+
+TEST (block_store, block_sideband)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, true);
+	rai::genesis genesis;
+	genesis.initialize (transaction, store);
+	rai::stat stats;
+	rai::ledger ledger (store, stats);
+	rai::keypair key1;
+	rai::state_block send (rai::genesis_account, genesis.hash (), 0, rai::genesis_account, rai::genesis_amount - 100, key1.pub, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send).code);
+	rai::block_sideband sideband1;
+	ASSERT_FALSE (store.block_sideband_get (transaction, genesis.hash (), sideband1));
+	ASSERT_EQ (rai::block_sideband (rai::genesis_account, 1, rai::genesis_amount, genesis.block ().creation_time ().number ()), sideband1);
+	rai::block_sideband sideband2;
+	ASSERT_FALSE (store.block_sideband_get (transaction, send.hash (), sideband2));
+	ASSERT_EQ (rai::block_sideband (rai::genesis_account, 2, rai::genesis_amount - 100, send.creation_time ().number ()), sideband2);
+	ASSERT_EQ (rai::genesis_account, ledger.account (transaction, send.hash ()));
+	ASSERT_EQ (rai::genesis_amount - 100, store.block_balance (transaction, send.hash ()));
+	ASSERT_EQ (send.hash (), store.block_successor (transaction, genesis.hash ()));
+	rai::block_sideband sideband3;
+	ASSERT_TRUE (store.block_sideband_get (transaction, key1.pub, sideband3));
+	ASSERT_TRUE (ledger.account (transaction, key1.pub).is_zero ());
+}
+
+TEST (block_store, block_serialized_get)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, true);
+	rai::genesis genesis;
+	genesis.initialize (transaction, store);
+	rai::stat stats;
+	rai::ledger ledger (store, stats);
+	rai::keypair key1;
+	rai::state_block send (rai::genesis_account, genesis.hash (), 0, rai::genesis_account, rai::genesis_amount - 100, key1.pub, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send).code);
+	std::vector<uint8_t> expected;
+	{
+		rai::vectorstream stream (expected);
+		rai::serialize_block (stream, send);
+	}
+	std::vector<uint8_t> buffer;
+	rai::block_hash previous;
+	size_t size (0);
+	{
+		rai::vectorstream stream (buffer);
+		size = store.block_serialized_get (transaction, send.hash (), stream, previous);
+	}
+	ASSERT_EQ (expected.size (), size);
+	ASSERT_EQ (expected, buffer);
+	ASSERT_EQ (genesis.hash (), previous);
+	std::vector<uint8_t> missing;
+	{
+		rai::vectorstream stream (missing);
+		ASSERT_EQ (0, store.block_serialized_get (transaction, key1.pub, stream, previous));
+	}
+	ASSERT_TRUE (missing.empty ());
+}
+
+TEST (block_store, upgrade_v15_v16)
+{
+	auto path (rai::unique_path ());
+	rai::genesis genesis;
+	rai::keypair key1;
+	rai::state_block send (rai::genesis_account, genesis.hash (), 0, rai::genesis_account, rai::genesis_amount - 100, key1.pub, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_TRUE (!init);
+		rai::transaction transaction (store.environment, nullptr, true);
+		genesis.initialize (transaction, store);
+		rai::stat stats;
+		rai::ledger ledger (store, stats);
+		ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send).code);
+		// Rewrite both blocks in the version 15 layout, block followed by successor
+		auto put_v15 ([&store, &transaction](rai::block const & block_a, rai::block_hash const & successor_a) {
+			std::vector<uint8_t> vector;
+			{
+				rai::vectorstream stream (vector);
+				block_a.serialize (stream);
+				rai::write (stream, successor_a.bytes);
+			}
+			store.block_put_raw (transaction, store.block_database (block_a.type ()), block_a.hash (), { vector.size (), vector.data () });
+		});
+		put_v15 (genesis.block (), send.hash ());
+		put_v15 (send, 0);
+		store.version_put (transaction, 15);
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (15, store.version_get (transaction));
+	rai::block_sideband sideband1;
+	ASSERT_FALSE (store.block_sideband_get (transaction, genesis.hash (), sideband1));
+	ASSERT_EQ (1, sideband1.height);
+	ASSERT_EQ (rai::genesis_amount, sideband1.balance.number ());
+	rai::block_sideband sideband2;
+	ASSERT_FALSE (store.block_sideband_get (transaction, send.hash (), sideband2));
+	ASSERT_EQ (rai::genesis_account, sideband2.account);
+	ASSERT_EQ (2, sideband2.height);
+	ASSERT_EQ (rai::genesis_amount - 100, sideband2.balance.number ());
+	ASSERT_EQ (send.hash (), store.block_successor (transaction, genesis.hash ()));
+	ASSERT_EQ (send, *store.block_get (transaction, send.hash ()));
+}
+
+TEST (block_store, upgrade_v16_v17)
+{
+	auto path (rai::unique_path ());
+	rai::keypair key;
+	auto block1 (std::make_shared<rai::state_block> (key.pub, 1, 0, key.pub, 2, 0, key.prv, key.pub, 5));
+	auto block2 (std::make_shared<rai::state_block> (key.pub, 1, 0, key.pub, 3, 0, key.prv, key.pub, 5));
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_TRUE (!init);
+		rai::transaction transaction (store.environment, nullptr, true);
+		// Version 16 layout, blocks as duplicates under their dependency
+		MDB_dbi unchecked_v16;
+		ASSERT_EQ (0, mdb_dbi_open (transaction, "unchecked", MDB_CREATE | MDB_DUPSORT, &unchecked_v16));
+		for (auto block : { block1, block2 })
+		{
+			std::vector<uint8_t> vector;
+			{
+				rai::vectorstream stream (vector);
+				rai::serialize_block (stream, *block);
+			}
+			ASSERT_EQ (0, mdb_put (transaction, unchecked_v16, rai::mdb_val (block->previous ()), rai::mdb_val (vector.size (), vector.data ()), 0));
+		}
+		store.version_put (transaction, 16);
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (16, store.version_get (transaction));
+	ASSERT_EQ (2, store.unchecked_count (transaction));
+	ASSERT_EQ (2, store.unchecked_get (transaction, block1->previous ()).size ());
+	MDB_dbi unchecked_v16;
+	ASSERT_NE (0, mdb_dbi_open (transaction, "unchecked", 0, &unchecked_v16));
+}
+
+TEST (block_store, upgrade_v17_v18)
+{
+	auto path (rai::unique_path ());
+	rai::genesis genesis;
+	rai::comment_block comment1 (rai::genesis_account, genesis.hash (), rai::epoch::epoch_start_time (rai::epoch::epoch_num::epoch2) + 1000, rai::genesis_account, rai::genesis_amount, rai::comment_block_subtype::account, "First comment", rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	rai::keypair key1;
+	rai::state_block send (rai::genesis_account, comment1.hash (), comment1.creation_time ().number () + 1, rai::genesis_account, rai::genesis_amount - 100, key1.pub, rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	rai::comment_block comment2 (rai::genesis_account, send.hash (), send.creation_time ().number () + 1, rai::genesis_account, rai::genesis_amount - 100, rai::comment_block_subtype::account, "Second comment", rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	{
+		bool init (false);
+		rai::block_store store (init, path);
+		ASSERT_TRUE (!init);
+		rai::stat stats;
+		rai::ledger ledger (store, stats);
+		rai::transaction transaction (store.environment, nullptr, true);
+		genesis.initialize (transaction, store);
+		ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, comment1).code);
+		ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send).code);
+		ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, comment2).code);
+		// Version 17 had no comment_previous entries
+		store.comment_previous_del (transaction, comment1.hash ());
+		store.comment_previous_del (transaction, comment2.hash ());
+		store.version_put (transaction, 17);
+	}
+	bool init (false);
+	rai::block_store store (init, path);
+	ASSERT_TRUE (!init);
+	rai::transaction transaction (store.environment, nullptr, false);
+	ASSERT_LT (17, store.version_get (transaction));
+	ASSERT_EQ (comment1.hash (), store.comment_previous_get (transaction, comment2.hash ()));
+	ASSERT_EQ (rai::block_hash (0), store.comment_previous_get (transaction, comment1.hash ()));
+}
+
 /*
 TEST (block_store, upgrade_v2_v3)
 {
@@ -309,6 +309,75 @@ TEST (ledger, rollback_receiver)
 	ASSERT_TRUE (ledger.store.pending_get (transaction, rai::pending_key (key2.pub, info2.head), pending1));
 }
 
+TEST (ledger, delegators)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::stat stats;
+	rai::ledger ledger (store, stats);
+	rai::genesis genesis;
+	rai::transaction transaction (store.environment, nullptr, true);
+	genesis.initialize (transaction, store);
+	ASSERT_EQ (1, store.delegator_count (transaction, rai::genesis_account));
+	rai::keypair key2;
+	rai::keypair key3;
+	rai::state_block send (::ledger_create_send_state_block_helper (genesis.block (), key2.pub, 50, rai::test_genesis_key));
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send).code);
+	rai::state_block open (::ledger_create_open_state_block_helper (send, key3.pub, key2.pub, rai::genesis_amount - 50, key2));
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, open).code);
+	rai::state_block change (::ledger_create_change_state_block_helper (send, key3.pub, rai::test_genesis_key));
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, change).code);
+	ASSERT_EQ (0, store.delegator_count (transaction, rai::genesis_account));
+	ASSERT_EQ (2, store.delegator_count (transaction, key3.pub));
+	std::vector<rai::account> delegators;
+	for (auto i (store.delegators_begin (transaction, key3.pub)), n (store.delegators_end ()); i != n && rai::account (i->first.uint256 ()) == key3.pub; i.next_dup ())
+	{
+		delegators.push_back (i->second.uint256 ());
+	}
+	ASSERT_EQ (2, delegators.size ());
+	ASSERT_NE (delegators.end (), std::find (delegators.begin (), delegators.end (), key2.pub));
+	ASSERT_NE (delegators.end (), std::find (delegators.begin (), delegators.end (), rai::genesis_account));
+	ledger.rollback (transaction, change.hash ());
+	ASSERT_EQ (1, store.delegator_count (transaction, rai::genesis_account));
+	ASSERT_EQ (1, store.delegator_count (transaction, key3.pub));
+	ledger.rollback (transaction, open.hash ());
+	ASSERT_EQ (0, store.delegator_count (transaction, key3.pub));
+}
+
+TEST (ledger, account_height)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::stat stats;
+	rai::ledger ledger (store, stats);
+	rai::genesis genesis;
+	rai::transaction transaction (store.environment, nullptr, true);
+	genesis.initialize (transaction, store);
+	rai::keypair key2;
+	rai::state_block send1 (::ledger_create_send_state_block_helper (genesis.block (), key2.pub, rai::genesis_amount - 50, rai::test_genesis_key));
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send1).code);
+	ASSERT_FALSE (store.account_height_enabled ());
+	ASSERT_TRUE (store.account_height_get (transaction, rai::genesis_account, 2).is_zero ());
+	ASSERT_EQ (2, store.account_height_build (transaction));
+	ASSERT_TRUE (store.account_height_enabled ());
+	ASSERT_EQ (genesis.hash (), store.account_height_get (transaction, rai::genesis_account, 1));
+	ASSERT_EQ (send1.hash (), store.account_height_get (transaction, rai::genesis_account, 2));
+	rai::state_block send2 (::ledger_create_send_state_block_helper (send1, key2.pub, rai::genesis_amount - 100, rai::test_genesis_key));
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send2).code);
+	ASSERT_EQ (send2.hash (), store.account_height_get (transaction, rai::genesis_account, 3));
+	rai::state_block open (::ledger_create_open_state_block_helper (send1, key2.pub, key2.pub, 50, key2));
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, open).code);
+	ASSERT_EQ (open.hash (), store.account_height_get (transaction, key2.pub, 1));
+	ledger.rollback (transaction, send2.hash ());
+	ASSERT_TRUE (store.account_height_get (transaction, rai::genesis_account, 3).is_zero ());
+	ASSERT_EQ (send1.hash (), store.account_height_get (transaction, rai::genesis_account, 2));
+	ledger.rollback (transaction, send1.hash ());
+	ASSERT_TRUE (store.account_height_get (transaction, rai::genesis_account, 2).is_zero ());
+	ASSERT_TRUE (store.account_height_get (transaction, key2.pub, 1).is_zero ());
+}
+
 TEST (ledger, rollback_representation)
 {
 	bool init (false);
@@ -855,6 +924,37 @@ TEST (votes, check_signature)
 	ASSERT_EQ (rai::vote_code::replay, node1.vote_processor.vote_blocking (transaction, vote1, rai::endpoint (boost::asio::ip::address_v6 (), 0)));
 }
 
+TEST (votes, check_signature_batch)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	auto send1 (std::make_shared<rai::state_block> (::ledger_create_send_state_block_helper (genesis.block (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key)));
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		ASSERT_EQ (rai::process_result::progress, node1.ledger.process (transaction, *send1).code);
+	}
+	node1.active.start (send1);
+	// Enough votes to be split across the signature checker threads, the last one is forged
+	auto count (rai::signature_checker::batch_size * 2);
+	for (size_t i (1); i <= count; ++i)
+	{
+		auto vote (std::make_shared<rai::vote> (rai::test_genesis_key.pub, rai::test_genesis_key.prv, i, send1));
+		if (i == count)
+		{
+			vote->signature.bytes[0] ^= 1;
+		}
+		node1.vote_processor.vote (vote, rai::endpoint (boost::asio::ip::address_v6::loopback (), 24001));
+	}
+	node1.vote_processor.flush ();
+	ASSERT_EQ (count, node1.stats.count (rai::stat::type::vote, rai::stat::detail::batch_size));
+	ASSERT_EQ (1, node1.stats.count (rai::stat::type::vote, rai::stat::detail::batch_rejected));
+	rai::transaction transaction (node1.store.environment, nullptr, true);
+	auto max_vote (node1.store.vote_max (transaction, std::make_shared<rai::vote> (rai::test_genesis_key.pub, rai::test_genesis_key.prv, 0, send1)));
+	ASSERT_EQ (count - 1, max_vote->sequence);
+}
+
 TEST (votes, add_one)
 {
 	rai::system system (24000, 1);
@@ -1062,6 +1162,68 @@ TEST (ledger, successor)
 	ASSERT_EQ (nullptr, system.nodes[0]->ledger.successor (transaction, 0));
 }
 
+// 1000 representatives vote on a fork and then all switch sides, the running tally has to match a full recompute
+TEST (votes, tally_thousand_reps)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	rai::keypair key2;
+	auto send1 (std::make_shared<rai::state_block> (::ledger_create_send_state_block_helper (genesis.block (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key)));
+	auto send2 (std::make_shared<rai::state_block> (::ledger_create_send_state_block_helper (genesis.block (), key2.pub, rai::genesis_amount - 100, rai::test_genesis_key)));
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		ASSERT_EQ (rai::process_result::progress, node1.ledger.process (transaction, *send1).code);
+	}
+	node1.active.start (send1);
+	auto election (node1.active.roots.find (send1->root ())->election);
+	ASSERT_FALSE (election->publish (send2));
+	// Weights well below quorum and online_weight_minimum, so the election stays open
+	std::vector<rai::account> reps;
+	std::vector<std::pair<rai::account, rai::amount_t>> weights;
+	for (auto i (0); i < 1000; ++i)
+	{
+		rai::keypair rep;
+		reps.push_back (rep.pub);
+		weights.push_back (std::make_pair (rep.pub, 1 + i));
+	}
+	node1.ledger.bootstrap_weights.load (std::numeric_limits<uint64_t>::max (), weights);
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		node1.ledger.bootstrap_weights_enable (transaction);
+	}
+	rai::amount_t total (0);
+	rai::amount_t total1 (0);
+	std::lock_guard<std::mutex> lock (node1.active.mutex);
+	for (size_t i (0); i < reps.size (); ++i)
+	{
+		auto hash (i % 2 ? send1->hash () : send2->hash ());
+		ASSERT_TRUE (election->vote (reps[i], 1, hash).processed);
+		total += 1 + i;
+		total1 += i % 2 ? 1 + i : 0;
+	}
+	ASSERT_EQ (total1, election->last_tally[send1->hash ()]);
+	ASSERT_EQ (total - total1, election->last_tally[send2->hash ()]);
+	for (auto & rep : reps)
+	{
+		election->last_votes[rep].time = std::chrono::steady_clock::now () - std::chrono::seconds (20);
+	}
+	for (auto & rep : reps)
+	{
+		ASSERT_TRUE (election->vote (rep, 2, send2->hash ()).processed);
+	}
+	ASSERT_FALSE (election->confirmed);
+	ASSERT_EQ (0, election->last_tally[send1->hash ()]);
+	ASSERT_EQ (total, election->last_tally[send2->hash ()]);
+	auto running (election->last_tally);
+	rai::transaction transaction (node1.store.environment, nullptr, false);
+	auto winner (*election->tally (transaction).begin ());
+	ASSERT_EQ (*send2, *winner.second);
+	ASSERT_EQ (total, winner.first);
+	ASSERT_EQ (running[send2->hash ()], election->last_tally[send2->hash ()]);
+}
+
 TEST (ledger, fail_change_old)
 {
 	bool init (false);
@@ -1097,6 +1259,27 @@ TEST (ledger, fail_change_gap_previous)
 	ASSERT_EQ (rai::process_result::gap_previous, result1.code);
 }
 
+// A block whose signature has already been verified by the caller skips the ledger signature check
+TEST (ledger, process_signature_verified)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_FALSE (init);
+	rai::stat stats;
+	rai::ledger ledger (store, stats);
+	rai::genesis genesis;
+	rai::transaction transaction (store.environment, nullptr, true);
+	genesis.initialize (transaction, store);
+	rai::keypair key1;
+	rai::state_block send (::ledger_create_send_state_block_helper (genesis.block (), key1.pub, 50, rai::test_genesis_key));
+	auto signature (send.signature_get ());
+	signature.bytes[32] ^= 1;
+	send.signature_set (signature);
+	ASSERT_EQ (rai::process_result::bad_signature, ledger.process (transaction, send).code);
+	ASSERT_EQ (rai::process_result::bad_signature, ledger.process (transaction, send, rai::signature_verification::invalid).code);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, send, rai::signature_verification::valid).code);
+}
+
 TEST (ledger, fail_change_bad_signature)
 {
 	bool init (false);
@@ -1657,8 +1840,8 @@ TEST (ledger, bootstrap_rep_weight)
 	}
 	{
 		rai::transaction transaction (store.environment, nullptr, false);
-		ledger.bootstrap_weight_max_blocks = 3;
-		ledger.bootstrap_weights[key2.pub] = 1000;
+		ledger.bootstrap_weights.load (3, { { key2.pub, 1000 } });
+		ledger.bootstrap_weights_enable (transaction);
 		ASSERT_EQ (1000, ledger.weight (transaction, key2.pub));
 	}
 	{
@@ -1672,6 +1855,63 @@ TEST (ledger, bootstrap_rep_weight)
 	}
 }
 
+TEST (bootstrap_weights, load)
+{
+	rai::keypair key1;
+	rai::keypair key2;
+	rai::keypair key3;
+	// Serialized sorted by account, as the ledger would load them from rep_weights.bin
+	std::vector<uint8_t> buffer;
+	{
+		rai::vectorstream stream (buffer);
+		rai::bootstrap_weights::serialize (stream, 42, { { key1.pub, 100 }, { key2.pub, std::numeric_limits<rai::amount_t>::max () } });
+	}
+	ASSERT_EQ (rai::bootstrap_weights::header_size + 2 * rai::bootstrap_weights::record_size, buffer.size ());
+	rai::bootstrap_weights weights;
+	ASSERT_FALSE (weights.load (buffer.data (), buffer.size ()));
+	ASSERT_EQ (42, weights.max_blocks);
+	ASSERT_EQ (2, weights.size ());
+	rai::amount_t weight;
+	ASSERT_FALSE (weights.get (key1.pub, weight));
+	ASSERT_EQ (100, weight);
+	ASSERT_FALSE (weights.get (key2.pub, weight));
+	ASSERT_EQ (std::numeric_limits<rai::amount_t>::max (), weight);
+	ASSERT_TRUE (weights.get (key3.pub, weight));
+	// Swap the records, the loader sorts a copy
+	std::vector<uint8_t> unsorted (buffer.begin (), buffer.begin () + rai::bootstrap_weights::header_size);
+	unsorted.insert (unsorted.end (), buffer.begin () + rai::bootstrap_weights::header_size + rai::bootstrap_weights::record_size, buffer.end ());
+	unsorted.insert (unsorted.end (), buffer.begin () + rai::bootstrap_weights::header_size, buffer.begin () + rai::bootstrap_weights::header_size + rai::bootstrap_weights::record_size);
+	rai::bootstrap_weights weights2;
+	ASSERT_FALSE (weights2.load (unsorted.data (), unsorted.size ()));
+	ASSERT_FALSE (weights2.get (key1.pub, weight));
+	ASSERT_EQ (100, weight);
+	rai::bootstrap_weights weights3;
+	ASSERT_TRUE (weights3.load (buffer.data (), buffer.size () - 1));
+}
+
+TEST (bootstrap_weights, load_file)
+{
+	rai::keypair key1;
+	std::vector<uint8_t> buffer;
+	{
+		rai::vectorstream stream (buffer);
+		rai::bootstrap_weights::serialize (stream, 7, { { key1.pub, 1000 } });
+	}
+	auto path (rai::unique_path ());
+	{
+		std::ofstream file (path.string (), std::ios::binary);
+		file.write (reinterpret_cast<char const *> (buffer.data ()), buffer.size ());
+	}
+	rai::bootstrap_weights weights;
+	ASSERT_FALSE (weights.load (path));
+	ASSERT_EQ (7, weights.max_blocks);
+	rai::amount_t weight;
+	ASSERT_FALSE (weights.get (key1.pub, weight));
+	ASSERT_EQ (1000, weight);
+	rai::bootstrap_weights weights2;
+	ASSERT_TRUE (weights2.load (rai::unique_path ()));
+}
+
 TEST (ledger, block_destination_source)
 {
 	bool init (false);
@@ -2617,6 +2857,41 @@ TEST (ledger, comment_genesis_process)
 	ASSERT_EQ (rai::process_result::progress, return2.code);
 }
 
+TEST (ledger, comment_search_index)
+{
+	bool init (false);
+	rai::block_store store (init, rai::unique_path ());
+	ASSERT_TRUE (!init);
+	rai::stat stats;
+	rai::ledger ledger (store, stats);
+	rai::transaction transaction (store.environment, nullptr, true);
+	rai::genesis genesis;
+	genesis.initialize (transaction, store);
+	rai::comment_block comment_block1 (rai::genesis_account, genesis.hash (), cutoff_time_comment_epoch + 1000, rai::genesis_account, rai::genesis_amount, rai::comment_block_subtype::account, "First comment", rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, comment_block1).code);
+	ASSERT_EQ (1, ledger.comment_search (transaction, "first", 10).size ());
+	rai::comment_block comment_block2 (rai::genesis_account, comment_block1.hash (), comment_block1.creation_time ().number () + 1, rai::genesis_account, rai::genesis_amount, rai::comment_block_subtype::account, "Second comment", rai::test_genesis_key.prv, rai::test_genesis_key.pub, 0);
+	ASSERT_EQ (rai::process_result::progress, ledger.process (transaction, comment_block2).code);
+	ASSERT_EQ (0, ledger.comment_search (transaction, "first", 10).size ());
+	auto result1 (ledger.comment_search (transaction, "COMM", 10));
+	ASSERT_EQ (1, result1.size ());
+	ASSERT_EQ (rai::genesis_account, result1[0].first);
+	ASSERT_EQ ("Second comment", result1[0].second);
+	// Substring matches and repeated matches within one comment count once
+	ASSERT_EQ (1, ledger.comment_search (transaction, "m", 10).size ());
+	ASSERT_EQ (1, ledger.comment_search (transaction, "", 10).size ());
+	ASSERT_EQ (rai::block_hash (0), store.comment_previous_get (transaction, comment_block1.hash ()));
+	ASSERT_EQ (comment_block1.hash (), store.comment_previous_get (transaction, comment_block2.hash ()));
+	ledger.rollback (transaction, comment_block2.hash ());
+	ASSERT_EQ (0, ledger.comment_search (transaction, "second", 10).size ());
+	ASSERT_EQ (1, ledger.comment_search (transaction, "first", 10).size ());
+	ASSERT_EQ ("First comment", ledger.account_comment (transaction, rai::genesis_account));
+	ASSERT_EQ (rai::block_hash (0), store.comment_previous_get (transaction, comment_block2.hash ()));
+	ledger.rollback (transaction, comment_block1.hash ());
+	ASSERT_EQ (0, ledger.comment_search (transaction, "comment", 10).size ());
+	ASSERT_EQ (genesis.hash (), ledger.latest (transaction, rai::genesis_account));
+}
+
 TEST (ledger, comment_invalid_legacy)
 {
 	bool init (false);
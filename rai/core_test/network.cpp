@@ -111,6 +111,60 @@ TEST (network, send_node_id_handshake)
 	node1->stop ();
 }
 
+#ifdef SO_REUSEPORT
+TEST (network, receive_sockets)
+{
+	rai::system system (24000, 1);
+	rai::node_init init1;
+	rai::node_config config1 (24001, system.logging);
+	config1.receive_sockets = 4;
+	auto node1 (std::make_shared<rai::node> (init1, system.service, rai::unique_path (), system.alarm, config1, system.work));
+	node1->start ();
+	ASSERT_EQ (3, node1->network.receive_sockets.size ());
+	for (auto & i : node1->network.receive_sockets)
+	{
+		ASSERT_EQ (24001, i->socket.local_endpoint ().port ());
+	}
+	system.nodes[0]->network.send_keepalive (node1->network.endpoint ());
+	system.deadline_set (10s);
+	while (node1->stats.count (rai::stat::type::message, rai::stat::detail::keepalive, rai::stat::dir::in) == 0)
+	{
+		ASSERT_NO_ERROR (system.poll ());
+	}
+	uint64_t received (0);
+	for (auto i (0); i < 4; ++i)
+	{
+		received += node1->stats.count (rai::stat::type::receive_socket, static_cast<rai::stat::detail> (static_cast<uint8_t> (rai::stat::detail::socket_0) + i));
+	}
+	ASSERT_LE (1, received);
+	node1->stop ();
+}
+#endif
+
+#ifdef __linux__
+TEST (network, batch_io)
+{
+	rai::system system (24000, 1);
+	rai::node_init init1;
+	rai::node_config config1 (24001, system.logging);
+	config1.udp_batch_size = 16;
+	auto node1 (std::make_shared<rai::node> (init1, system.service, rai::unique_path (), system.alarm, config1, system.work));
+	node1->start ();
+	node1->network.send_keepalive (system.nodes[0]->network.endpoint ());
+	system.deadline_set (10s);
+	while (node1->stats.count (rai::stat::type::message, rai::stat::detail::node_id_handshake, rai::stat::dir::in) == 0)
+	{
+		ASSERT_NO_ERROR (system.poll ());
+	}
+	// Both the keepalive and the handshake reply went through sendmmsg / recvmmsg
+	ASSERT_LE (1, node1->stats.count (rai::stat::type::traffic, rai::stat::detail::batch, rai::stat::dir::out));
+	ASSERT_LE (1, node1->stats.count (rai::stat::type::traffic, rai::stat::detail::batch_size, rai::stat::dir::out));
+	ASSERT_LE (1, node1->stats.count (rai::stat::type::traffic, rai::stat::detail::batch, rai::stat::dir::in));
+	ASSERT_LE (1, node1->stats.count (rai::stat::type::traffic, rai::stat::detail::batch_size, rai::stat::dir::in));
+	node1->stop ();
+}
+#endif
+
 TEST (network, keepalive_ipv4)
 {
 	rai::system system (24000, 1);
@@ -804,6 +858,40 @@ TEST (frontier_req, time_bound)
 	ASSERT_TRUE (request->current.is_zero ());
 }
 
+TEST (frontier_req, iterate)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	std::set<rai::account> accounts;
+	accounts.insert (rai::test_genesis_key.pub);
+	{
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		for (auto i (0); i < 10; ++i)
+		{
+			rai::keypair key;
+			accounts.insert (key.pub);
+			node1.store.account_put (transaction, key.pub, rai::account_info (key.pub, key.pub, key.pub, 0, 0, 0, 1));
+		}
+	}
+	auto connection (std::make_shared<rai::bootstrap_server> (nullptr, system.nodes[0]));
+	std::unique_ptr<rai::frontier_req> req (new rai::frontier_req);
+	req->start.clear ();
+	req->age = std::numeric_limits<decltype (req->age)>::max ();
+	req->count = std::numeric_limits<decltype (req->count)>::max ();
+	connection->requests.push (std::unique_ptr<rai::message>{});
+	auto request (std::make_shared<rai::frontier_req_server> (connection, std::move (req)));
+	// The rest of the frontiers are read in the same batch as the first
+	ASSERT_EQ (accounts.size () - 1, request->accounts.size ());
+	std::vector<rai::account> sent;
+	while (!request->current.is_zero ())
+	{
+		sent.push_back (request->current);
+		request->next ();
+	}
+	ASSERT_TRUE (request->accounts.empty ());
+	ASSERT_EQ (std::vector<rai::account> (accounts.begin (), accounts.end ()), sent);
+}
+
 TEST (frontier_req, time_cutoff)
 {
 	rai::system system (24000, 1);
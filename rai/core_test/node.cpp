@@ -492,6 +492,20 @@ TEST (node_config, serialization)
 	config1.callback_port = 10;
 	config1.callback_target = "test";
 	config1.lmdb_max_dbs = 256;
+	config1.signature_checker_threads = 3;
+	config1.receive_sockets = 2;
+	config1.udp_batch_size = 32;
+	config1.udp_flush_interval = 5;
+	config1.account_cache_size = 1024;
+	config1.block_processor_live_weight = 32;
+	config1.block_processor_bootstrap_weight = 2;
+	config1.vote_generator_delay = 20;
+	config1.websocket.enable = true;
+	config1.websocket.port = 10;
+	config1.websocket.max_queue = 16;
+	config1.callback_connections = 8;
+	config1.callback_batch_size = 32;
+	config1.callback_queue_max = 100;
 	boost::property_tree::ptree tree;
 	config1.serialize_json (tree);
 	rai::logging logging2;
@@ -509,6 +523,20 @@ TEST (node_config, serialization)
 	ASSERT_NE (config2.callback_port, config1.callback_port);
 	ASSERT_NE (config2.callback_target, config1.callback_target);
 	ASSERT_NE (config2.lmdb_max_dbs, config1.lmdb_max_dbs);
+	ASSERT_NE (config2.signature_checker_threads, config1.signature_checker_threads);
+	ASSERT_NE (config2.receive_sockets, config1.receive_sockets);
+	ASSERT_NE (config2.udp_batch_size, config1.udp_batch_size);
+	ASSERT_NE (config2.udp_flush_interval, config1.udp_flush_interval);
+	ASSERT_NE (config2.account_cache_size, config1.account_cache_size);
+	ASSERT_NE (config2.block_processor_live_weight, config1.block_processor_live_weight);
+	ASSERT_NE (config2.block_processor_bootstrap_weight, config1.block_processor_bootstrap_weight);
+	ASSERT_NE (config2.vote_generator_delay, config1.vote_generator_delay);
+	ASSERT_NE (config2.websocket.enable, config1.websocket.enable);
+	ASSERT_NE (config2.websocket.port, config1.websocket.port);
+	ASSERT_NE (config2.websocket.max_queue, config1.websocket.max_queue);
+	ASSERT_NE (config2.callback_connections, config1.callback_connections);
+	ASSERT_NE (config2.callback_batch_size, config1.callback_batch_size);
+	ASSERT_NE (config2.callback_queue_max, config1.callback_queue_max);
 
 	bool upgraded (false);
 	ASSERT_FALSE (config2.deserialize_json (upgraded, tree));
@@ -524,6 +552,20 @@ TEST (node_config, serialization)
 	ASSERT_EQ (config2.callback_port, config1.callback_port);
 	ASSERT_EQ (config2.callback_target, config1.callback_target);
 	ASSERT_EQ (config2.lmdb_max_dbs, config1.lmdb_max_dbs);
+	ASSERT_EQ (config2.signature_checker_threads, config1.signature_checker_threads);
+	ASSERT_EQ (config2.receive_sockets, config1.receive_sockets);
+	ASSERT_EQ (config2.udp_batch_size, config1.udp_batch_size);
+	ASSERT_EQ (config2.udp_flush_interval, config1.udp_flush_interval);
+	ASSERT_EQ (config2.account_cache_size, config1.account_cache_size);
+	ASSERT_EQ (config2.block_processor_live_weight, config1.block_processor_live_weight);
+	ASSERT_EQ (config2.block_processor_bootstrap_weight, config1.block_processor_bootstrap_weight);
+	ASSERT_EQ (config2.vote_generator_delay, config1.vote_generator_delay);
+	ASSERT_EQ (config2.websocket.enable, config1.websocket.enable);
+	ASSERT_EQ (config2.websocket.port, config1.websocket.port);
+	ASSERT_EQ (config2.websocket.max_queue, config1.websocket.max_queue);
+	ASSERT_EQ (config2.callback_connections, config1.callback_connections);
+	ASSERT_EQ (config2.callback_batch_size, config1.callback_batch_size);
+	ASSERT_EQ (config2.callback_queue_max, config1.callback_queue_max);
 }
 
 TEST (node_config, v1_v2_upgrade)
@@ -653,6 +695,50 @@ TEST (node, fork_publish)
 	ASSERT_TRUE (node0.expired ());
 }
 
+// Count the hash digests computed per block going through the block processor
+TEST (node, block_hash_computations)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	std::vector<std::shared_ptr<rai::block>> blocks;
+	rai::block_hash previous (genesis.hash ());
+	rai::amount_t balance (rai::genesis_amount);
+	for (auto i (0); i < 20; ++i)
+	{
+		balance -= 100;
+		rai::state_block send (rai::test_genesis_key.pub, previous, 0, rai::test_genesis_key.pub, balance, key1.pub, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (previous));
+		// Round trip through the wire format, so the block arrives without a memoized hash like one received from the network
+		std::vector<uint8_t> bytes;
+		{
+			rai::vectorstream stream (bytes);
+			rai::serialize_block (stream, send);
+		}
+		rai::bufferstream stream (bytes.data (), bytes.size ());
+		blocks.push_back (rai::deserialize_block (stream));
+		previous = send.hash ();
+	}
+	// Repeated calls on the same block only hash it once
+	auto first (rai::base_block::hash_computations.load ());
+	for (auto i (0); i < 4; ++i)
+	{
+		blocks[0]->hash ();
+	}
+	ASSERT_EQ (first + 1, rai::base_block::hash_computations.load ());
+	auto before (rai::base_block::hash_computations.load ());
+	for (auto & block : blocks)
+	{
+		node1.process_active (block);
+	}
+	node1.block_processor.flush ();
+	auto after (rai::base_block::hash_computations.load ());
+	rai::transaction transaction (node1.store.environment, nullptr, false);
+	ASSERT_TRUE (node1.store.block_exists (transaction, previous));
+	// Without the memoized hash every lookup along the processing path rehashes the block
+	ASSERT_LE (after - before, 3 * blocks.size ());
+}
+
 TEST (node, fork_keep)
 {
 	rai::system system (24000, 2);
@@ -1389,22 +1475,262 @@ TEST (node, start_observer)
 	node->stop ();
 }
 
+namespace
+{
+// HTTP receiver for callback tests, answers every request with 200 and keeps the bodies
+class callback_listener : public std::enable_shared_from_this<callback_listener>
+{
+public:
+	callback_listener (boost::asio::io_service & service_a, uint16_t port_a) :
+	service (service_a),
+	acceptor (service_a, boost::asio::ip::tcp::endpoint (boost::asio::ip::address_v6::loopback (), port_a)),
+	connections (0),
+	close (false)
+	{
+	}
+	void accept ()
+	{
+		auto this_l (shared_from_this ());
+		auto socket (std::make_shared<boost::asio::ip::tcp::socket> (service));
+		acceptor.async_accept (*socket, [this_l, socket](boost::system::error_code const & ec) {
+			if (!ec)
+			{
+				++this_l->connections;
+				this_l->sockets.push_back (socket);
+				this_l->read (socket, std::make_shared<boost::beast::flat_buffer> ());
+				this_l->accept ();
+			}
+		});
+	}
+	void read (std::shared_ptr<boost::asio::ip::tcp::socket> socket_a, std::shared_ptr<boost::beast::flat_buffer> buffer_a)
+	{
+		auto this_l (shared_from_this ());
+		auto request (std::make_shared<boost::beast::http::request<boost::beast::http::string_body>> ());
+		boost::beast::http::async_read (*socket_a, *buffer_a, *request, [this_l, socket_a, buffer_a, request](boost::system::error_code const & ec, size_t) {
+			if (!ec)
+			{
+				this_l->bodies.push_back (request->body ());
+				auto response (std::make_shared<boost::beast::http::response<boost::beast::http::string_body>> (boost::beast::http::status::ok, request->version ()));
+				response->keep_alive (true);
+				response->prepare_payload ();
+				boost::beast::http::async_write (*socket_a, *response, [this_l, socket_a, buffer_a, response](boost::system::error_code const & ec, size_t) {
+					if (!ec && !this_l->close)
+					{
+						this_l->read (socket_a, buffer_a);
+					}
+					else
+					{
+						boost::system::error_code ignored;
+						socket_a->close (ignored);
+					}
+				});
+			}
+		});
+	}
+	void stop ()
+	{
+		boost::system::error_code ignored;
+		acceptor.close (ignored);
+		for (auto & i : sockets)
+		{
+			i->close (ignored);
+		}
+	}
+	boost::asio::io_service & service;
+	boost::asio::ip::tcp::acceptor acceptor;
+	std::vector<std::shared_ptr<boost::asio::ip::tcp::socket>> sockets;
+	std::vector<std::string> bodies;
+	size_t connections;
+	// Close each connection after answering, like a receiver timing out idle keep-alive connections
+	bool close;
+};
+}
+
 TEST (node, send_callback)
 {
 	rai::system system (24000, 1);
+	ASSERT_EQ (nullptr, system.nodes[0]->callback);
+	auto listener (std::make_shared<callback_listener> (system.service, 24090));
+	listener->accept ();
+	rai::node_init init1;
+	rai::node_config config1 (24001, system.logging);
+	config1.callback_address = "::1";
+	config1.callback_port = 24090;
+	config1.callback_target = "/";
+	auto node1 (std::make_shared<rai::node> (init1, system.service, rai::unique_path (), system.alarm, config1, system.work));
+	ASSERT_FALSE (init1.error ());
+	node1->start ();
+	ASSERT_NE (nullptr, node1->callback);
 	rai::keypair key2;
-	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
-	system.wallet (0)->insert_adhoc (key2.prv);
-	system.nodes[0]->config.callback_address = "localhost";
-	system.nodes[0]->config.callback_port = 8010;
-	system.nodes[0]->config.callback_target = "/";
-	ASSERT_NE (nullptr, system.wallet (0)->send_action (rai::test_genesis_key.pub, key2.pub, system.nodes[0]->config.receive_minimum.number ()));
+	auto wallet (node1->wallets.create (rai::uint256_union ()));
+	wallet->insert_adhoc (rai::test_genesis_key.prv);
+	wallet->insert_adhoc (key2.prv);
+	auto send (wallet->send_action (rai::test_genesis_key.pub, key2.pub, node1->config.receive_minimum.number ()));
+	ASSERT_NE (nullptr, send);
+	auto delivered ([&listener, &send]() {
+		auto result (false);
+		for (auto & i : listener->bodies)
+		{
+			boost::property_tree::ptree event;
+			std::stringstream istream (i);
+			boost::property_tree::read_json (istream, event);
+			result = result || event.get<std::string> ("hash") == send->hash ().to_string ();
+		}
+		return result;
+	});
 	system.deadline_set (10s);
-	while (system.nodes[0]->balance (key2.pub) == 0)
+	while (node1->balance (key2.pub) == 0 || !delivered ())
 	{
 		ASSERT_NO_ERROR (system.poll ());
 	}
-	ASSERT_EQ (std::numeric_limits<rai::amount_t>::max () - system.nodes[0]->config.receive_minimum.number (), system.nodes[0]->balance (rai::test_genesis_key.pub));
+	ASSERT_EQ (std::numeric_limits<rai::amount_t>::max () - node1->config.receive_minimum.number (), node1->balance (rai::test_genesis_key.pub));
+	ASSERT_LE (1, listener->connections);
+	ASSERT_EQ (0, node1->callback->size ());
+	ASSERT_EQ (0, node1->stats.count (rai::stat::type::http_callback, rai::stat::detail::failure, rai::stat::dir::out));
+	node1->stop ();
+	listener->stop ();
+}
+
+TEST (node, callback_batch)
+{
+	rai::system system (24000, 1);
+	auto listener (std::make_shared<callback_listener> (system.service, 24090));
+	listener->accept ();
+	rai::node_init init1;
+	rai::node_config config1 (24001, system.logging);
+	config1.callback_address = "::1";
+	config1.callback_port = 24090;
+	config1.callback_target = "/";
+	config1.callback_connections = 1;
+	config1.callback_batch_size = 4;
+	auto node1 (std::make_shared<rai::node> (init1, system.service, rai::unique_path (), system.alarm, config1, system.work));
+	ASSERT_FALSE (init1.error ());
+	node1->start ();
+	for (auto i (1); i <= 8; ++i)
+	{
+		node1->callback->add (boost::str (boost::format ("{\"a\":\"%1%\"}") % i));
+	}
+	system.deadline_set (10s);
+	while (listener->bodies.size () < 2)
+	{
+		ASSERT_NO_ERROR (system.poll ());
+	}
+	ASSERT_EQ (2, listener->bodies.size ());
+	ASSERT_EQ ("[{\"a\":\"1\"},{\"a\":\"2\"},{\"a\":\"3\"},{\"a\":\"4\"}]", listener->bodies[0]);
+	ASSERT_EQ ("[{\"a\":\"5\"},{\"a\":\"6\"},{\"a\":\"7\"},{\"a\":\"8\"}]", listener->bodies[1]);
+	// Both batches went over one keep-alive connection
+	ASSERT_EQ (1, listener->connections);
+	ASSERT_EQ (0, node1->callback->size ());
+	node1->stop ();
+	listener->stop ();
+}
+
+TEST (node, callback_reconnect)
+{
+	rai::system system (24000, 1);
+	auto listener (std::make_shared<callback_listener> (system.service, 24090));
+	listener->close = true;
+	listener->accept ();
+	rai::node_init init1;
+	rai::node_config config1 (24001, system.logging);
+	config1.callback_address = "::1";
+	config1.callback_port = 24090;
+	config1.callback_target = "/";
+	config1.callback_connections = 1;
+	auto node1 (std::make_shared<rai::node> (init1, system.service, rai::unique_path (), system.alarm, config1, system.work));
+	ASSERT_FALSE (init1.error ());
+	node1->start ();
+	node1->callback->add ("{\"a\":\"1\"}");
+	system.deadline_set (10s);
+	while (node1->stats.count (rai::stat::type::http_callback, rai::stat::detail::send, rai::stat::dir::out) < 1)
+	{
+		ASSERT_NO_ERROR (system.poll ());
+	}
+	// The idle connection was closed by the listener, the event is sent again on a new one instead of being queued
+	node1->callback->add ("{\"a\":\"2\"}");
+	while (node1->stats.count (rai::stat::type::http_callback, rai::stat::detail::send, rai::stat::dir::out) < 2)
+	{
+		ASSERT_NO_ERROR (system.poll ());
+	}
+	ASSERT_EQ (2, listener->bodies.size ());
+	ASSERT_EQ ("{\"a\":\"2\"}", listener->bodies[1]);
+	ASSERT_EQ (2, listener->connections);
+	ASSERT_EQ (1, node1->stats.count (rai::stat::type::http_callback, rai::stat::detail::reconnect, rai::stat::dir::out));
+	ASSERT_EQ (0, node1->stats.count (rai::stat::type::http_callback, rai::stat::detail::failure, rai::stat::dir::out));
+	ASSERT_EQ (0, node1->callback->size ());
+	node1->stop ();
+	listener->stop ();
+}
+
+TEST (node, callback_queue)
+{
+	auto path (rai::unique_path ());
+	{
+		rai::callback_queue queue (path, 3);
+		ASSERT_EQ (0, queue.size ());
+		ASSERT_FALSE (boost::filesystem::exists (path));
+		ASSERT_FALSE (queue.push ("{\"a\":\"1\"}"));
+		ASSERT_FALSE (queue.push ("{\"a\":\"2\"}"));
+		ASSERT_FALSE (queue.push ("{\"a\":\"3\"}"));
+		ASSERT_TRUE (queue.push ("{\"a\":\"4\"}"));
+		ASSERT_EQ (3, queue.size ());
+		auto front (queue.front (2));
+		ASSERT_EQ (2, front.size ());
+		ASSERT_EQ ("{\"a\":\"1\"}", front[0]);
+		ASSERT_EQ ("{\"a\":\"2\"}", front[1]);
+		queue.pop (1);
+		ASSERT_EQ (2, queue.size ());
+	}
+	// Entries left in the queue are loaded again
+	rai::callback_queue queue (path, 3);
+	ASSERT_EQ (2, queue.size ());
+	auto front (queue.front (5));
+	ASSERT_EQ (2, front.size ());
+	ASSERT_EQ ("{\"a\":\"2\"}", front[0]);
+	ASSERT_EQ ("{\"a\":\"3\"}", front[1]);
+	queue.pop (2);
+	ASSERT_EQ (0, queue.size ());
+	rai::callback_queue queue2 (path, 3);
+	ASSERT_EQ (0, queue2.size ());
+}
+
+TEST (node, callback_unreachable)
+{
+	rai::system system (24000, 1);
+	rai::node_init init1;
+	rai::node_config config1 (24001, system.logging);
+	// Nothing listens on the callback port, events go to the retry queue
+	config1.callback_address = "::1";
+	config1.callback_port = 24099;
+	config1.callback_target = "/";
+	auto node (std::make_shared<rai::node> (init1, system.service, rai::unique_path (), system.alarm, config1, system.work));
+	ASSERT_FALSE (init1.error ());
+	node->start ();
+	ASSERT_NE (nullptr, node->callback);
+	node->callback->add ("{\"a\":\"1\"}");
+	system.deadline_set (10s);
+	while (node->callback->size () == 0)
+	{
+		ASSERT_NO_ERROR (system.poll ());
+	}
+	ASSERT_EQ (1, node->callback->size ());
+	ASSERT_LE (1, node->stats.count (rai::stat::type::http_callback, rai::stat::detail::failure, rai::stat::dir::out));
+	ASSERT_EQ (1, node->stats.count (rai::stat::type::http_callback, rai::stat::detail::queue, rai::stat::dir::in));
+	ASSERT_EQ (1, node->stats.count (rai::stat::type::http_callback, rai::stat::detail::queue_size, rai::stat::dir::in));
+	// The retry timer delivers the queued event once the receiver is up
+	auto listener (std::make_shared<callback_listener> (system.service, 24099));
+	listener->accept ();
+	system.deadline_set (3 * rai::callback_dispatcher::retry_interval);
+	while (node->callback->size () != 0)
+	{
+		ASSERT_NO_ERROR (system.poll ());
+	}
+	ASSERT_EQ (1, listener->bodies.size ());
+	ASSERT_EQ ("{\"a\":\"1\"}", listener->bodies[0]);
+	ASSERT_EQ (1, node->stats.count (rai::stat::type::http_callback, rai::stat::detail::queue, rai::stat::dir::out));
+	ASSERT_EQ (0, node->stats.count (rai::stat::type::http_callback, rai::stat::detail::queue_size, rai::stat::dir::in));
+	node->stop ();
+	listener->stop ();
 }
 
 // Check that votes get replayed back to nodes if they sent an old sequence number.
@@ -1618,3 +1944,372 @@ TEST (node, confirm_quorum)
 	}
 	ASSERT_EQ (0, system.nodes[0]->balance (rai::test_genesis_key.pub));
 }
+
+TEST (signature_checker, verify)
+{
+	rai::signature_checker checker (4);
+	rai::keypair key;
+	// Large enough to be split into several chunks
+	size_t size (rai::signature_checker::batch_size * 3 + 7);
+	std::vector<rai::uint256_union> hashes (size);
+	std::vector<rai::signature> signatures_l (size);
+	std::vector<unsigned char const *> messages;
+	std::vector<size_t> lengths (size, sizeof (rai::uint256_union));
+	std::vector<unsigned char const *> pub_keys;
+	std::vector<unsigned char const *> signatures;
+	std::vector<int> verifications (size, -1);
+	for (size_t i (0); i < size; ++i)
+	{
+		hashes[i] = rai::uint256_union (i);
+		signatures_l[i] = rai::sign_message (key.prv, key.pub, hashes[i]);
+		if (i % 100 == 0)
+		{
+			signatures_l[i].bytes[32] ^= 1;
+		}
+		messages.push_back (hashes[i].bytes.data ());
+		pub_keys.push_back (key.pub.bytes.data ());
+		signatures.push_back (signatures_l[i].bytes.data ());
+	}
+	rai::signature_check_set check = { size, messages.data (), lengths.data (), pub_keys.data (), signatures.data (), verifications.data () };
+	checker.verify (check);
+	for (size_t i (0); i < size; ++i)
+	{
+		ASSERT_EQ (i % 100 == 0 ? 0 : 1, verifications[i]);
+	}
+}
+
+TEST (signature_checker, execute)
+{
+	rai::signature_checker checker (4);
+	size_t size (rai::signature_checker::batch_size * 5 + 3);
+	std::vector<std::atomic<unsigned>> visits (size);
+	checker.execute (size, rai::signature_checker::batch_size, [&visits](size_t start_a, size_t size_a) {
+		for (auto i (start_a); i < start_a + size_a; ++i)
+		{
+			++visits[i];
+		}
+	});
+	for (auto & visit : visits)
+	{
+		ASSERT_EQ (1, visit);
+	}
+	ASSERT_TRUE (checker.parallel ());
+	checker.stop ();
+	ASSERT_FALSE (checker.parallel ());
+}
+
+TEST (block_processor, reject_bad_signature)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	auto send1 (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (genesis.hash ()))));
+	auto signature (send1->signature_get ());
+	signature.bytes[32] ^= 1;
+	send1->signature_set (signature);
+	node1.block_processor.add (send1, std::chrono::steady_clock::now ());
+	node1.block_processor.flush ();
+	ASSERT_FALSE (node1.ledger.block_exists (send1->hash ()));
+	ASSERT_EQ (1, node1.stats.count (rai::stat::type::signature, rai::stat::detail::batch_rejected));
+	auto send2 (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (genesis.hash ()))));
+	node1.block_processor.add (send2, std::chrono::steady_clock::now ());
+	node1.block_processor.flush ();
+	ASSERT_TRUE (node1.ledger.block_exists (send2->hash ()));
+	ASSERT_EQ (2, node1.stats.count (rai::stat::type::signature, rai::stat::detail::batch_size));
+	ASSERT_EQ (1, node1.stats.count (rai::stat::type::signature, rai::stat::detail::batch_rejected));
+}
+
+TEST (block_processor, queues)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	auto send1 (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (genesis.hash ()))));
+	auto send2 (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (send1->hash (), key1.pub, rai::genesis_amount - 200, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (send1->hash ()))));
+	auto send3 (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (send2->hash (), key1.pub, rai::genesis_amount - 300, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (send2->hash ()))));
+	node1.process_active (send1);
+	node1.block_processor.flush ();
+	node1.block_processor.add (send2, std::chrono::steady_clock::time_point (), rai::block_queue::bootstrap);
+	node1.block_processor.flush ();
+	node1.block_processor.force (send3);
+	node1.block_processor.flush ();
+	ASSERT_TRUE (node1.ledger.block_exists (send3->hash ()));
+	ASSERT_EQ (1, node1.stats.count (rai::stat::type::block_processor, rai::stat::detail::live, rai::stat::dir::in));
+	ASSERT_EQ (1, node1.stats.count (rai::stat::type::block_processor, rai::stat::detail::live, rai::stat::dir::out));
+	ASSERT_EQ (1, node1.stats.count (rai::stat::type::block_processor, rai::stat::detail::bootstrap, rai::stat::dir::out));
+	ASSERT_EQ (1, node1.stats.count (rai::stat::type::block_processor, rai::stat::detail::forced, rai::stat::dir::out));
+	ASSERT_EQ (0, node1.stats.count (rai::stat::type::block_processor, rai::stat::detail::local, rai::stat::dir::in));
+	ASSERT_EQ (0, node1.block_processor.size (rai::block_queue::bootstrap));
+	ASSERT_FALSE (node1.block_processor.full (rai::block_queue::bootstrap));
+}
+
+namespace
+{
+// Waits without polling the io_service, its handlers could need the write transaction the caller holds
+bool block_processor_taken (rai::block_processor & processor_a, rai::block_queue queue_a)
+{
+	auto deadline (std::chrono::steady_clock::now () + 5s);
+	while (processor_a.size (queue_a) != 0 && std::chrono::steady_clock::now () < deadline)
+	{
+		std::this_thread::sleep_for (1ms);
+	}
+	return processor_a.size (queue_a) == 0;
+}
+}
+
+TEST (block_processor, live_ahead_of_bootstrap)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	rai::keypair key2;
+	// Competing sends, whichever is written first wins
+	auto work (system.work.generate (genesis.hash ()));
+	auto live (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, work)));
+	auto bootstrap (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), key2.pub, rai::genesis_amount - 200, rai::test_genesis_key.prv, rai::test_genesis_key.pub, work)));
+	std::vector<std::shared_ptr<rai::block>> flood;
+	for (auto i (0); i < 16; ++i)
+	{
+		rai::keypair key;
+		flood.push_back (std::make_shared<rai::state_block> (::node_create_open_state_block_helper (key.pub, key.pub, key.pub, 1, key.prv, key.pub, system.work.generate (key.pub))));
+	}
+	{
+		// The processor takes the first block then waits on this transaction, everything after it stays queued
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		node1.block_processor.add (flood[0], std::chrono::steady_clock::time_point (), rai::block_queue::bootstrap);
+		ASSERT_TRUE (block_processor_taken (node1.block_processor, rai::block_queue::bootstrap));
+		for (auto i (flood.begin () + 1), n (flood.end ()); i != n; ++i)
+		{
+			node1.block_processor.add (*i, std::chrono::steady_clock::time_point (), rai::block_queue::bootstrap);
+		}
+		node1.block_processor.add (bootstrap, std::chrono::steady_clock::time_point (), rai::block_queue::bootstrap);
+		node1.block_processor.add (live, std::chrono::steady_clock::now (), rai::block_queue::live);
+	}
+	node1.block_processor.flush ();
+	ASSERT_TRUE (node1.ledger.block_exists (live->hash ()));
+	ASSERT_FALSE (node1.ledger.block_exists (bootstrap->hash ()));
+}
+
+TEST (block_processor, forced_ahead_of_verified)
+{
+	rai::system system (24000, 1);
+	auto & node1 (*system.nodes[0]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	rai::keypair key2;
+	auto work (system.work.generate (genesis.hash ()));
+	auto send1 (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, work)));
+	auto send2 (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (send1->hash (), key1.pub, rai::genesis_amount - 200, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (send1->hash ()))));
+	auto fork (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), key2.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, work)));
+	{
+		// send1 and send2 are verified and waiting for this transaction when the fork is forced
+		rai::transaction transaction (node1.store.environment, nullptr, true);
+		node1.block_processor.add (send1, std::chrono::steady_clock::time_point (), rai::block_queue::bootstrap);
+		node1.block_processor.add (send2, std::chrono::steady_clock::time_point (), rai::block_queue::bootstrap);
+		ASSERT_TRUE (block_processor_taken (node1.block_processor, rai::block_queue::bootstrap));
+		node1.block_processor.force (fork);
+	}
+	node1.block_processor.flush ();
+	ASSERT_TRUE (node1.ledger.block_exists (fork->hash ()));
+	ASSERT_FALSE (node1.ledger.block_exists (send1->hash ()));
+	ASSERT_FALSE (node1.ledger.block_exists (send2->hash ()));
+	// send1 was rejected as a fork rather than written and rolled back, so send2 waits on it in unchecked
+	rai::transaction transaction (node1.store.environment, nullptr, false);
+	ASSERT_EQ (1, node1.store.unchecked_get (transaction, send1->hash ()).size ());
+}
+
+TEST (block_processor, prefetch)
+{
+	rai::system system (24000, 1);
+	auto & node0 (*system.nodes[0]);
+	rai::node_init init1;
+	rai::node_config config1 (24001, system.logging);
+	// Prefetch only runs with signature checker threads to run it on
+	config1.signature_checker_threads = 2;
+	auto node1 (std::make_shared<rai::node> (init1, system.service, rai::unique_path (), system.alarm, config1, system.work));
+	ASSERT_FALSE (init1.error ());
+	ASSERT_TRUE (node1->signature_checker.parallel ());
+	rai::genesis genesis;
+	// Sends from genesis interleaved with the opens receiving them, so prefetch covers both the send and the receive reads
+	std::vector<std::shared_ptr<rai::block>> blocks;
+	std::vector<rai::keypair> keys (rai::block_processor::prefetch_min / 2 + 8);
+	auto previous (genesis.hash ());
+	auto balance (rai::genesis_amount);
+	for (auto & key : keys)
+	{
+		balance -= 100;
+		auto send (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (previous, key.pub, balance, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (previous))));
+		previous = send->hash ();
+		blocks.push_back (send);
+		blocks.push_back (std::make_shared<rai::state_block> (::node_create_open_state_block_helper (send->hash (), key.pub, key.pub, 100, key.prv, key.pub, system.work.generate (key.pub))));
+	}
+	ASSERT_GT (blocks.size (), rai::block_processor::prefetch_min);
+	for (auto & block : blocks)
+	{
+		ASSERT_EQ (rai::process_result::progress, node0.process (*block).code);
+	}
+	{
+		// Queue everything behind this transaction so it is verified and prefetched as one batch
+		rai::transaction transaction (node1->store.environment, nullptr, true);
+		node1->block_processor.add (blocks[0], std::chrono::steady_clock::time_point (), rai::block_queue::bootstrap);
+		ASSERT_TRUE (block_processor_taken (node1->block_processor, rai::block_queue::bootstrap));
+		for (auto i (blocks.begin () + 1), n (blocks.end ()); i != n; ++i)
+		{
+			node1->block_processor.add (*i, std::chrono::steady_clock::time_point (), rai::block_queue::bootstrap);
+		}
+	}
+	node1->block_processor.flush ();
+	ASSERT_EQ (blocks.size (), node1->stats.count (rai::stat::type::block_processor, rai::stat::detail::bootstrap, rai::stat::dir::out));
+	rai::transaction transaction0 (node0.store.environment, nullptr, false);
+	rai::transaction transaction1 (node1->store.environment, nullptr, false);
+	for (auto & block : blocks)
+	{
+		ASSERT_TRUE (node1->store.block_exists (transaction1, block->hash ()));
+	}
+	for (auto & key : keys)
+	{
+		ASSERT_EQ (node0.ledger.account_balance (transaction0, key.pub), node1->ledger.account_balance (transaction1, key.pub));
+		ASSERT_EQ (node0.ledger.account_pending (transaction0, key.pub), node1->ledger.account_pending (transaction1, key.pub));
+		ASSERT_EQ (node0.ledger.weight (transaction0, key.pub), node1->ledger.weight (transaction1, key.pub));
+	}
+	ASSERT_EQ (node0.ledger.latest (transaction0, rai::test_genesis_key.pub), node1->ledger.latest (transaction1, rai::test_genesis_key.pub));
+	ASSERT_EQ (node0.ledger.account_balance (transaction0, rai::test_genesis_key.pub), node1->ledger.account_balance (transaction1, rai::test_genesis_key.pub));
+	ASSERT_EQ (node0.ledger.checksum (transaction0, 0, std::numeric_limits<rai::uint256_t>::max ()), node1->ledger.checksum (transaction1, 0, std::numeric_limits<rai::uint256_t>::max ()));
+	node1->stop ();
+}
+
+TEST (block_processor, bootstrap_backpressure)
+{
+	rai::system system (24000, 1);
+	auto node1 (system.nodes[0]);
+	rai::genesis genesis;
+	// Forks of one root share its work
+	auto work (system.work.generate (genesis.hash ()));
+	std::vector<std::shared_ptr<rai::block>> blocks;
+	for (size_t i (0); i < rai::block_processor::queue_max + 2; ++i)
+	{
+		blocks.push_back (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), rai::test_genesis_key.pub, rai::genesis_amount - i - 1, rai::test_genesis_key.prv, rai::test_genesis_key.pub, work)));
+	}
+	{
+		rai::transaction transaction (node1->store.environment, nullptr, true);
+		node1->block_processor.add (blocks[0], std::chrono::steady_clock::now (), rai::block_queue::bootstrap);
+		ASSERT_TRUE (block_processor_taken (node1->block_processor, rai::block_queue::bootstrap));
+		for (auto i (blocks.begin () + 1), n (blocks.end ()); i != n; ++i)
+		{
+			node1->block_processor.add (*i, std::chrono::steady_clock::now (), rai::block_queue::bootstrap);
+		}
+		ASSERT_TRUE (node1->block_processor.full (rai::block_queue::bootstrap));
+		auto attempt (std::make_shared<rai::bootstrap_attempt> (node1));
+		auto connection (std::make_shared<rai::bootstrap_client> (node1, attempt, rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), 24001)));
+		rai::pull_info pull (rai::test_genesis_key.pub, genesis.hash (), genesis.hash ());
+		auto client (std::make_shared<rai::bulk_pull_client> (connection, pull));
+		client->expected = pull.end;
+		// A full queue defers the read to the alarm instead of reading from the socket
+		client->throttled_receive_block ();
+		ASSERT_EQ (1, node1->stats.count (rai::stat::type::bootstrap, rai::stat::detail::backpressure, rai::stat::dir::in));
+		connection->stop (true);
+	}
+	node1->block_processor.flush ();
+	ASSERT_FALSE (node1->block_processor.full (rai::block_queue::bootstrap));
+}
+
+TEST (vote_generator, bundle)
+{
+	rai::system system (24000, 1);
+	auto & node (*system.nodes[0]);
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	// One full vote straight away, the remaining hash after the window
+	for (size_t i (0); i < rai::vote_generator::max_hashes + 1; ++i)
+	{
+		node.vote_generator.add (rai::block_hash (i + 1));
+	}
+	system.deadline_set (10s);
+	while (node.stats.count (rai::stat::type::vote_generator, rai::stat::detail::batch) < 2)
+	{
+		ASSERT_NO_ERROR (system.poll ());
+	}
+	ASSERT_EQ (rai::vote_generator::max_hashes + 1, node.stats.count (rai::stat::type::vote_generator, rai::stat::detail::batch_size));
+	ASSERT_EQ (2, node.stats.count (rai::stat::type::vote_generator, rai::stat::detail::vote_signed));
+}
+
+TEST (vote_generator, confirm_req)
+{
+	rai::system system (24000, 2);
+	auto & node0 (*system.nodes[0]);
+	auto & node1 (*system.nodes[1]);
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	rai::genesis genesis;
+	rai::keypair key1;
+	auto send1 (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (genesis.hash ()))));
+	ASSERT_EQ (rai::process_result::progress, node0.process (*send1).code);
+	ASSERT_EQ (rai::process_result::progress, node1.process (*send1).code);
+	auto open (std::make_shared<rai::state_block> (genesis.block ()));
+	// Both requests land in one window and are answered with one vote
+	node1.network.send_confirm_req (node0.network.endpoint (), open);
+	node1.network.send_confirm_req (node0.network.endpoint (), send1);
+	std::shared_ptr<rai::vote> vote;
+	system.deadline_set (10s);
+	while (vote == nullptr || vote->blocks.size () < 2)
+	{
+		ASSERT_NO_ERROR (system.poll ());
+		rai::transaction transaction (node1.store.environment, nullptr, false);
+		std::lock_guard<std::mutex> lock (node1.store.cache_mutex);
+		vote = node1.store.vote_current (transaction, rai::test_genesis_key.pub);
+	}
+	std::vector<rai::block_hash> hashes (vote->begin (), vote->end ());
+	ASSERT_EQ (2, hashes.size ());
+	ASSERT_NE (hashes.end (), std::find (hashes.begin (), hashes.end (), genesis.hash ()));
+	ASSERT_NE (hashes.end (), std::find (hashes.begin (), hashes.end (), send1->hash ()));
+	ASSERT_EQ (2, node0.stats.count (rai::stat::type::vote_generator, rai::stat::detail::confirm_req));
+}
+
+TEST (vote_generator, confirm_req_successor)
+{
+	rai::system system (24000, 2);
+	auto & node0 (*system.nodes[0]);
+	auto & node1 (*system.nodes[1]);
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	rai::genesis genesis;
+	rai::keypair key1;
+	rai::keypair key2;
+	auto work (system.work.generate (genesis.hash ()));
+	auto send1 (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, work)));
+	auto fork (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), key2.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, work)));
+	ASSERT_EQ (rai::process_result::progress, node0.process (*send1).code);
+	ASSERT_EQ (rai::process_result::progress, node1.process (*fork).code);
+	// node1 asks about its fork, node0 answers with its own block so the vote by hash can be used
+	node1.network.send_confirm_req (node0.network.endpoint (), fork);
+	system.deadline_set (10s);
+	while (!node1.block_arrival.recent (send1->hash ()))
+	{
+		ASSERT_NO_ERROR (system.poll ());
+	}
+	ASSERT_EQ (1, node0.stats.count (rai::stat::type::vote_generator, rai::stat::detail::confirm_req));
+}
+
+TEST (vote_generator, confirm_req_no_reps)
+{
+	rai::system system (24000, 2);
+	auto & node0 (*system.nodes[0]);
+	auto & node1 (*system.nodes[1]);
+	rai::genesis genesis;
+	rai::keypair key1;
+	rai::keypair key2;
+	auto work (system.work.generate (genesis.hash ()));
+	auto send1 (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), key1.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, work)));
+	auto fork (std::make_shared<rai::state_block> (::node_create_send_state_block_helper (genesis.hash (), key2.pub, rai::genesis_amount - 100, rai::test_genesis_key.prv, rai::test_genesis_key.pub, work)));
+	ASSERT_EQ (rai::process_result::progress, node0.process (*send1).code);
+	ASSERT_EQ (rai::process_result::progress, node1.process (*fork).code);
+	node1.network.send_confirm_req (node0.network.endpoint (), fork);
+	system.deadline_set (10s);
+	while (node0.stats.count (rai::stat::type::message, rai::stat::detail::confirm_req, rai::stat::dir::in) == 0)
+	{
+		ASSERT_NO_ERROR (system.poll ());
+	}
+	// Without a voting representative node0 neither votes nor sends its successor
+	ASSERT_EQ (0, node0.stats.count (rai::stat::type::vote_generator, rai::stat::detail::confirm_req));
+	ASSERT_FALSE (node1.block_arrival.recent (send1->hash ()));
+}
@@ -145,6 +145,40 @@ TEST (peer_container, rep_weight)
 	ASSERT_EQ (endpoint0, reps[0].endpoint);
 }
 
+TEST (peer_container, snapshot)
+{
+	rai::peer_container peers (rai::endpoint{});
+	rai::endpoint endpoint0 (boost::asio::ip::address_v6::loopback (), 24000);
+	rai::endpoint endpoint1 (boost::asio::ip::address_v6::loopback (), 24001);
+	rai::endpoint endpoint2 (boost::asio::ip::address_v6::loopback (), 24002);
+	auto snapshot0 (peers.snapshot ());
+	ASSERT_TRUE (snapshot0->endpoints.empty ());
+	peers.insert (endpoint0, rai::protocol_information (), rai::account ());
+	peers.insert (endpoint1, rai::protocol_information (), rai::account ());
+	peers.insert (endpoint2, rai::protocol_information (), rai::account ());
+	// Published snapshots never change
+	ASSERT_TRUE (snapshot0->endpoints.empty ());
+	auto snapshot1 (peers.snapshot ());
+	ASSERT_EQ (3, snapshot1->endpoints.size ());
+	ASSERT_TRUE (snapshot1->representatives.empty ());
+	rai::keypair key1;
+	rai::keypair key2;
+	peers.rep_response (endpoint0, key1.pub, rai::amount (100));
+	peers.rep_response (endpoint1, key2.pub, rai::amount (200));
+	// Same representative behind a second address is only counted once
+	peers.rep_response (endpoint2, key2.pub, rai::amount (200));
+	auto snapshot2 (peers.snapshot ());
+	ASSERT_EQ (3, snapshot2->representatives.size ());
+	ASSERT_EQ (200, snapshot2->representatives[0].rep_weight.number ());
+	ASSERT_EQ (100, snapshot2->representatives[2].rep_weight.number ());
+	ASSERT_EQ (300, snapshot2->total_weight);
+	ASSERT_EQ (300, peers.total_weight ());
+	peers.purge_list (std::chrono::steady_clock::now () + std::chrono::seconds (5));
+	ASSERT_EQ (3, snapshot2->endpoints.size ());
+	ASSERT_TRUE (peers.snapshot ()->endpoints.empty ());
+	ASSERT_EQ (0, peers.total_weight ());
+}
+
 // Test to make sure we don't repeatedly send keepalive messages to nodes that aren't responding
 TEST (peer_container, reachout)
 {
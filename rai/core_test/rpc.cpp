@@ -2097,6 +2097,35 @@ TEST (rpc, account_remove)
 	ASSERT_FALSE (system0.wallet (0)->exists (key1));
 }
 
+TEST (rpc, account_remove_representative)
+{
+	rai::system system0 (24000, 1);
+	system0.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	auto & node (*system0.nodes[0]);
+	{
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		auto reps (node.wallets.reps_list (transaction));
+		ASSERT_EQ (1, reps.size ());
+		ASSERT_EQ (rai::test_genesis_key.pub, reps[0].first);
+	}
+	rai::rpc rpc (system0.service, node, rai::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request;
+	request.put ("action", "account_remove");
+	request.put ("wallet", node.wallets.items.begin ()->first.to_string ());
+	request.put ("account", rai::test_genesis_key.pub.to_account ());
+	test_response response (request, rpc, system0.service);
+	system0.deadline_set (5s);
+	while (response.status == 0)
+	{
+		ASSERT_NO_ERROR (system0.poll ());
+	}
+	ASSERT_EQ (200, response.status);
+	ASSERT_EQ ("1", response.json.get<std::string> ("removed"));
+	rai::transaction transaction (node.store.environment, nullptr, false);
+	ASSERT_EQ (0, node.wallets.reps_list (transaction).size ());
+}
+
 TEST (rpc, representatives)
 {
 	rai::system system0 (24000, 1);
@@ -3654,6 +3683,27 @@ TEST (rpc, wallet_lock)
 	ASSERT_FALSE (system.wallet (0)->valid_password ());
 }
 
+TEST (rpc, representatives_voting)
+{
+	rai::system system (24000, 1);
+	system.wallet (0)->insert_adhoc (rai::test_genesis_key.prv);
+	rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request;
+	request.put ("action", "representatives_voting");
+	test_response response (request, rpc, system.service);
+	while (response.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response.status);
+	auto & representatives (response.json.get_child ("representatives"));
+	ASSERT_EQ (1, representatives.size ());
+	ASSERT_EQ (rai::test_genesis_key.pub.to_account (), representatives.begin ()->first);
+	ASSERT_EQ (std::to_string (rai::genesis_amount), representatives.begin ()->second.get<std::string> (""));
+	ASSERT_EQ ("0", response.json.get<std::string> ("locked"));
+}
+
 TEST (rpc, wallet_locked)
 {
 	rai::system system (24000, 1);
@@ -4343,3 +4393,172 @@ TEST (rpc, add_comment_account_on_acc_fails)
 	std::string error (response.json.get<std::string> ("error"));
 	ASSERT_EQ ("Account not found", error);
 }
+
+TEST (rpc, keepalive_pipeline)
+{
+	rai::system system (24000, 1);
+	rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+	rpc.start ();
+	boost::asio::ip::tcp::socket sock (system.service);
+	auto connected (false);
+	sock.async_connect (rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), rpc.config.port), [&connected](boost::system::error_code const & ec) {
+		ASSERT_FALSE (ec);
+		connected = true;
+	});
+	while (!connected)
+	{
+		system.poll ();
+	}
+	// Both requests are written before either response is read
+	std::array<boost::beast::http::request<boost::beast::http::string_body>, 2> requests;
+	std::array<std::string, 2> actions{ { "block_count", "account_count" } };
+	std::string buffer;
+	for (auto i (0); i < 2; ++i)
+	{
+		requests[i].method (boost::beast::http::verb::post);
+		requests[i].target ("/");
+		requests[i].version (11);
+		requests[i].body () = "{\"action\": \"" + actions[i] + "\"}";
+		requests[i].prepare_payload ();
+		std::stringstream stream;
+		stream << requests[i];
+		buffer += stream.str ();
+	}
+	auto written (false);
+	boost::asio::async_write (sock, boost::asio::buffer (buffer), [&written](boost::system::error_code const & ec, size_t) {
+		ASSERT_FALSE (ec);
+		written = true;
+	});
+	while (!written)
+	{
+		system.poll ();
+	}
+	boost::beast::flat_buffer sb;
+	for (auto i (0); i < 2; ++i)
+	{
+		boost::beast::http::response<boost::beast::http::string_body> resp;
+		auto done (false);
+		boost::beast::http::async_read (sock, sb, resp, [&done](boost::system::error_code const & ec, size_t) {
+			ASSERT_FALSE (ec);
+			done = true;
+		});
+		while (!done)
+		{
+			system.poll ();
+		}
+		ASSERT_EQ (boost::beast::http::status::ok, resp.result ());
+		ASSERT_TRUE (resp.keep_alive ());
+		boost::property_tree::ptree json;
+		std::stringstream body (resp.body ());
+		boost::property_tree::read_json (body, json);
+		// Responses arrive in request order, only block_count reports unchecked blocks
+		ASSERT_EQ ("1", json.get<std::string> ("count"));
+		ASSERT_EQ (i == 0, !!json.get_optional<std::string> ("unchecked"));
+	}
+}
+
+TEST (rpc, overload)
+{
+	rai::system system (24000, 1);
+	rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+	rpc.config.max_requests = 1;
+	rpc.start ();
+	auto slot (rpc.request_slot ());
+	ASSERT_NE (nullptr, slot);
+	ASSERT_EQ (nullptr, rpc.request_slot ());
+	boost::property_tree::ptree request;
+	request.put ("action", "block_count");
+	{
+		test_response response (request, rpc, system.service);
+		while (response.status == 0)
+		{
+			system.poll ();
+		}
+		ASSERT_EQ (200, response.status);
+		ASSERT_EQ (boost::beast::http::status::service_unavailable, response.resp.result ());
+		ASSERT_EQ ("Too many requests in progress", response.json.get<std::string> ("error"));
+	}
+	ASSERT_EQ (2, rpc.rejected);
+	slot.reset ();
+	ASSERT_EQ (0, rpc.requests);
+	test_response response (request, rpc, system.service);
+	while (response.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response.status);
+	ASSERT_EQ (boost::beast::http::status::ok, response.resp.result ());
+	ASSERT_EQ ("1", response.json.get<std::string> ("count"));
+}
+
+TEST (rpc, rpc_stats)
+{
+	rai::system system (24000, 1);
+	rai::rpc rpc (system.service, *system.nodes[0], rai::rpc_config (true));
+	rpc.start ();
+	boost::property_tree::ptree request1;
+	request1.put ("action", "block_count");
+	test_response response1 (request1, rpc, system.service);
+	while (response1.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response1.status);
+	boost::property_tree::ptree request2;
+	request2.put ("action", "rpc_stats");
+	test_response response2 (request2, rpc, system.service);
+	while (response2.status == 0)
+	{
+		system.poll ();
+	}
+	ASSERT_EQ (200, response2.status);
+	ASSERT_EQ ("1", response2.json.get<std::string> ("requests"));
+	ASSERT_EQ ("0", response2.json.get<std::string> ("rejected"));
+	auto & block_count (response2.json.get_child ("latency.block_count"));
+	ASSERT_EQ ("1", block_count.get<std::string> ("count"));
+	uint64_t buckets (0);
+	for (auto & i : block_count.get_child ("buckets"))
+	{
+		buckets += std::stoull (i.second.get<std::string> (""));
+	}
+	ASSERT_EQ (1, buckets);
+}
+
+TEST (rpc, json_writer)
+{
+	boost::property_tree::ptree tree;
+	boost::property_tree::ptree accounts;
+	boost::property_tree::ptree entry;
+	entry.put ("balance", "100");
+	entry.put ("comment", "quote \" slash / back \\ tab \t bell \a");
+	accounts.add_child ("xrb_1", entry);
+	accounts.add_child ("xrb_2", boost::property_tree::ptree ());
+	boost::property_tree::ptree hashes;
+	for (auto i : { "A", "B" })
+	{
+		boost::property_tree::ptree hash;
+		hash.put ("", i);
+		hashes.push_back (std::make_pair ("", hash));
+	}
+	accounts.add_child ("xrb_3", hashes);
+	tree.add_child ("accounts", accounts);
+	tree.add_child ("empty", boost::property_tree::ptree ());
+	std::stringstream expected;
+	boost::property_tree::write_json (expected, tree);
+	rai::json_writer writer;
+	writer.object_begin ();
+	writer.object_begin ("accounts");
+	writer.object_begin ("xrb_1");
+	writer.put ("balance", "100");
+	writer.put ("comment", "quote \" slash / back \\ tab \t bell \a");
+	writer.object_end ();
+	writer.object_begin ("xrb_2");
+	writer.object_end ();
+	writer.array_begin ("xrb_3");
+	writer.put ("", "A");
+	writer.put ("", "B");
+	writer.array_end ();
+	writer.object_end ();
+	writer.array_begin ("empty");
+	ASSERT_EQ (expected.str (), writer.finish ());
+}
@@ -95,3 +95,70 @@ TEST (wallets, DISABLED_wallet_create_max)
 	auto existing = wallets.items.find (key.pub);
 	ASSERT_TRUE (existing == wallets.items.end ());
 }
+
+TEST (wallets, reps_cache)
+{
+	rai::system system (24000, 1);
+	auto & node (*system.nodes[0]);
+	auto wallet (system.wallet (0));
+	rai::keypair key1;
+	wallet->insert_adhoc (key1.prv);
+	{
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		ASSERT_EQ (0, node.wallets.reps_list (transaction).size ());
+	}
+	wallet->insert_adhoc (rai::test_genesis_key.prv);
+	{
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		auto reps (node.wallets.reps_list (transaction));
+		ASSERT_EQ (1, reps.size ());
+		ASSERT_EQ (rai::test_genesis_key.pub, reps[0].first);
+	}
+	rai::raw_key empty;
+	empty.data.clear ();
+	wallet->store.password.value_set (empty);
+	node.wallets.compute_reps ();
+	{
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		ASSERT_EQ (0, node.wallets.reps_list (transaction).size ());
+		ASSERT_EQ (1, node.wallets.reps_locked ());
+	}
+	ASSERT_FALSE (wallet->enter_password (""));
+	{
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		ASSERT_EQ (1, node.wallets.reps_list (transaction).size ());
+		ASSERT_EQ (0, node.wallets.reps_locked ());
+	}
+	// Delegating the genesis weight to key1 replaces it in the cache
+	ASSERT_FALSE (wallet->change_sync (rai::test_genesis_key.pub, key1.pub));
+	{
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		auto reps (node.wallets.reps_list (transaction));
+		ASSERT_EQ (1, reps.size ());
+		ASSERT_EQ (key1.pub, reps[0].first);
+	}
+}
+
+TEST (wallets, reps_cache_change_seed)
+{
+	rai::system system (24000, 1);
+	auto & node (*system.nodes[0]);
+	auto wallet (system.wallet (0));
+	wallet->insert_adhoc (rai::test_genesis_key.prv);
+	auto key1 (wallet->deterministic_insert ());
+	ASSERT_FALSE (wallet->change_sync (rai::test_genesis_key.pub, key1));
+	{
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		auto reps (node.wallets.reps_list (transaction));
+		ASSERT_EQ (1, reps.size ());
+		ASSERT_EQ (key1, reps[0].first);
+	}
+	rai::keypair seed;
+	{
+		rai::transaction transaction (node.store.environment, nullptr, true);
+		wallet->change_seed (transaction, seed.prv);
+	}
+	ASSERT_FALSE (wallet->exists (key1));
+	rai::transaction transaction (node.store.environment, nullptr, false);
+	ASSERT_EQ (0, node.wallets.reps_list (transaction).size ());
+}
@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+
+#include <boost/beast/websocket.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <rai/core_test/testutil.hpp>
+#include <rai/node/testing.hpp>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+using websocket_client = boost::beast::websocket::stream<boost::asio::ip::tcp::socket>;
+
+void websocket_connect (rai::system & system_a, websocket_client & ws_a, uint16_t port_a)
+{
+	auto connected (false);
+	ws_a.next_layer ().async_connect (rai::tcp_endpoint (boost::asio::ip::address_v6::loopback (), port_a), [&ws_a, &connected](boost::system::error_code const & ec) {
+		ASSERT_FALSE (ec);
+		ws_a.async_handshake ("localhost", "/", [&connected](boost::system::error_code const & ec) {
+			ASSERT_FALSE (ec);
+			connected = true;
+		});
+	});
+	system_a.deadline_set (5s);
+	while (!connected)
+	{
+		ASSERT_NO_ERROR (system_a.poll ());
+	}
+}
+
+void websocket_write (rai::system & system_a, websocket_client & ws_a, std::string const & text_a)
+{
+	auto done (false);
+	ws_a.async_write (boost::asio::buffer (text_a), [&done](boost::system::error_code const & ec, size_t) {
+		ASSERT_FALSE (ec);
+		done = true;
+	});
+	system_a.deadline_set (5s);
+	while (!done)
+	{
+		ASSERT_NO_ERROR (system_a.poll ());
+	}
+}
+
+void websocket_read (rai::system & system_a, websocket_client & ws_a, boost::property_tree::ptree & message_a)
+{
+	boost::beast::flat_buffer buffer;
+	auto done (false);
+	ws_a.async_read (buffer, [&done](boost::system::error_code const & ec, size_t) {
+		ASSERT_FALSE (ec);
+		done = true;
+	});
+	system_a.deadline_set (5s);
+	while (!done)
+	{
+		ASSERT_NO_ERROR (system_a.poll ());
+	}
+	std::stringstream stream (boost::beast::buffers_to_string (buffer.data ()));
+	boost::property_tree::read_json (stream, message_a);
+}
+}
+
+TEST (websocket, confirmation)
+{
+	rai::system system (24000, 1);
+	rai::node_init init1;
+	rai::node_config config1 (24001, system.logging);
+	config1.websocket.enable = true;
+	config1.websocket.port = 24078;
+	auto node1 (std::make_shared<rai::node> (init1, system.service, rai::unique_path (), system.alarm, config1, system.work));
+	ASSERT_FALSE (init1.error ());
+	node1->start ();
+	ASSERT_NE (nullptr, node1->websocket);
+	websocket_client ws (system.service);
+	ASSERT_NO_FATAL_FAILURE (websocket_connect (system, ws, config1.websocket.port));
+	rai::keypair key1;
+	rai::keypair key2;
+	ASSERT_NO_FATAL_FAILURE (websocket_write (system, ws, "{\"action\": \"subscribe\", \"topic\": \"confirmation\", \"options\": {\"accounts\": [\"" + key1.pub.to_account () + "\"]}}"));
+	boost::property_tree::ptree ack;
+	ASSERT_NO_FATAL_FAILURE (websocket_read (system, ws, ack));
+	ASSERT_EQ ("subscribe", ack.get<std::string> ("ack"));
+	ASSERT_FALSE (ack.get_optional<std::string> ("error"));
+	ASSERT_EQ (1, node1->websocket->size ());
+	rai::genesis genesis;
+	std::vector<std::shared_ptr<rai::block>> blocks;
+	rai::block_hash previous (genesis.hash ());
+	rai::amount_t balance (rai::genesis_amount);
+	// Only sends to key1 match the subscription
+	for (auto destination : { key1.pub, key2.pub, key1.pub })
+	{
+		balance -= 100;
+		auto send (std::make_shared<rai::state_block> (rai::test_genesis_key.pub, previous, 0, rai::test_genesis_key.pub, balance, destination, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (previous)));
+		previous = send->hash ();
+		blocks.push_back (send);
+		node1->process_confirmed (send);
+	}
+	boost::property_tree::ptree message1;
+	ASSERT_NO_FATAL_FAILURE (websocket_read (system, ws, message1));
+	ASSERT_EQ ("confirmation", message1.get<std::string> ("topic"));
+	ASSERT_EQ (blocks[0]->hash ().to_string (), message1.get<std::string> ("message.hash"));
+	ASSERT_EQ (rai::test_genesis_key.pub.to_account (), message1.get<std::string> ("message.account"));
+	boost::property_tree::ptree message2;
+	ASSERT_NO_FATAL_FAILURE (websocket_read (system, ws, message2));
+	ASSERT_EQ (blocks[2]->hash ().to_string (), message2.get<std::string> ("message.hash"));
+	node1->stop ();
+}
+
+TEST (websocket, vote)
+{
+	rai::system system (24000, 1);
+	rai::node_init init1;
+	rai::node_config config1 (24001, system.logging);
+	config1.websocket.enable = true;
+	config1.websocket.port = 24078;
+	auto node1 (std::make_shared<rai::node> (init1, system.service, rai::unique_path (), system.alarm, config1, system.work));
+	ASSERT_FALSE (init1.error ());
+	node1->start ();
+	websocket_client ws (system.service);
+	ASSERT_NO_FATAL_FAILURE (websocket_connect (system, ws, config1.websocket.port));
+	ASSERT_NO_FATAL_FAILURE (websocket_write (system, ws, "{\"action\": \"subscribe\", \"topic\": \"vote\", \"options\": {\"accounts\": [\"" + rai::test_genesis_key.pub.to_account () + "\"]}}"));
+	boost::property_tree::ptree ack;
+	ASSERT_NO_FATAL_FAILURE (websocket_read (system, ws, ack));
+	ASSERT_EQ ("subscribe", ack.get<std::string> ("ack"));
+	ASSERT_FALSE (ack.get_optional<std::string> ("error"));
+	rai::genesis genesis;
+	rai::keypair key1;
+	// Only the vote by the subscribed representative is pushed
+	auto vote1 (std::make_shared<rai::vote> (key1.pub, key1.prv, 1, std::vector<rai::block_hash> ({ genesis.hash () })));
+	auto vote2 (std::make_shared<rai::vote> (rai::test_genesis_key.pub, rai::test_genesis_key.prv, 2, std::vector<rai::block_hash> ({ genesis.hash () })));
+	node1->observers.vote.notify (vote1, node1->network.endpoint ());
+	node1->observers.vote.notify (vote2, node1->network.endpoint ());
+	boost::property_tree::ptree message1;
+	ASSERT_NO_FATAL_FAILURE (websocket_read (system, ws, message1));
+	ASSERT_EQ ("vote", message1.get<std::string> ("topic"));
+	ASSERT_EQ (rai::test_genesis_key.pub.to_account (), message1.get<std::string> ("message.account"));
+	ASSERT_EQ ("2", message1.get<std::string> ("message.sequence"));
+	auto & blocks (message1.get_child ("message.blocks"));
+	ASSERT_EQ (1, blocks.size ());
+	ASSERT_EQ (genesis.hash ().to_string (), blocks.begin ()->second.get<std::string> (""));
+	node1->stop ();
+}
+
+TEST (websocket, stats)
+{
+	rai::system system (24000, 1);
+	rai::node_init init1;
+	rai::node_config config1 (24001, system.logging);
+	config1.websocket.enable = true;
+	config1.websocket.port = 24078;
+	config1.websocket.stats_interval = 1;
+	auto node1 (std::make_shared<rai::node> (init1, system.service, rai::unique_path (), system.alarm, config1, system.work));
+	ASSERT_FALSE (init1.error ());
+	node1->start ();
+	websocket_client ws (system.service);
+	ASSERT_NO_FATAL_FAILURE (websocket_connect (system, ws, config1.websocket.port));
+	ASSERT_NO_FATAL_FAILURE (websocket_write (system, ws, "{\"action\": \"subscribe\", \"topic\": \"stats\"}"));
+	boost::property_tree::ptree ack;
+	ASSERT_NO_FATAL_FAILURE (websocket_read (system, ws, ack));
+	ASSERT_EQ ("subscribe", ack.get<std::string> ("ack"));
+	ASSERT_FALSE (ack.get_optional<std::string> ("error"));
+	boost::property_tree::ptree message1;
+	ASSERT_NO_FATAL_FAILURE (websocket_read (system, ws, message1));
+	ASSERT_EQ ("stats", message1.get<std::string> ("topic"));
+	ASSERT_EQ ("counters", message1.get<std::string> ("message.type"));
+	// The counters include the bytes already sent to this client
+	auto & entries (message1.get_child ("message.entries"));
+	ASSERT_TRUE (std::any_of (entries.begin (), entries.end (), [](boost::property_tree::ptree::value_type const & entry_a) { return entry_a.second.get<std::string> ("type") == "websocket"; }));
+	node1->stop ();
+}
+
+TEST (websocket, slow_consumer)
+{
+	rai::system system (24000, 1);
+	rai::node_init init1;
+	rai::node_config config1 (24001, system.logging);
+	config1.websocket.enable = true;
+	config1.websocket.port = 24078;
+	config1.websocket.max_queue = 2;
+	auto node1 (std::make_shared<rai::node> (init1, system.service, rai::unique_path (), system.alarm, config1, system.work));
+	ASSERT_FALSE (init1.error ());
+	node1->start ();
+	websocket_client ws (system.service);
+	ASSERT_NO_FATAL_FAILURE (websocket_connect (system, ws, config1.websocket.port));
+	ASSERT_NO_FATAL_FAILURE (websocket_write (system, ws, "{\"action\": \"subscribe\", \"topic\": \"confirmation\"}"));
+	boost::property_tree::ptree ack;
+	ASSERT_NO_FATAL_FAILURE (websocket_read (system, ws, ack));
+	ASSERT_EQ ("subscribe", ack.get<std::string> ("ack"));
+	ASSERT_EQ (1, node1->websocket->size ());
+	rai::genesis genesis;
+	rai::keypair key1;
+	rai::block_hash previous (genesis.hash ());
+	rai::amount_t balance (rai::genesis_amount);
+	// Nothing is written until the service is polled, so the third message finds the queue full
+	for (size_t i (0); i < config1.websocket.max_queue + 1; ++i)
+	{
+		balance -= 100;
+		auto send (std::make_shared<rai::state_block> (rai::test_genesis_key.pub, previous, 0, rai::test_genesis_key.pub, balance, key1.pub, rai::test_genesis_key.prv, rai::test_genesis_key.pub, system.work.generate (previous)));
+		previous = send->hash ();
+		node1->process_confirmed (send);
+	}
+	ASSERT_EQ (1, node1->stats.count (rai::stat::type::websocket, rai::stat::detail::overflow, rai::stat::dir::out));
+	// The client sees the connection closed, at most after what was written before the disconnect
+	boost::beast::flat_buffer buffer;
+	boost::system::error_code error;
+	auto done (false);
+	std::function<void()> read;
+	read = [&ws, &buffer, &error, &done, &read]() {
+		ws.async_read (buffer, [&buffer, &error, &done, &read](boost::system::error_code const & ec, size_t) {
+			if (!ec)
+			{
+				buffer.consume (buffer.size ());
+				read ();
+			}
+			else
+			{
+				error = ec;
+				done = true;
+			}
+		});
+	};
+	read ();
+	system.deadline_set (5s);
+	while (!done || node1->websocket->size () != 0)
+	{
+		ASSERT_NO_ERROR (system.poll ());
+	}
+	ASSERT_TRUE (!!error);
+	ASSERT_EQ (1, node1->stats.count (rai::stat::type::websocket, rai::stat::detail::overflow, rai::stat::dir::out));
+	node1->stop ();
+}
@@ -242,22 +242,58 @@ void rai::base_hashables::hash (blake2b_state & hash_a) const
 	blake2b_update (&hash_a, &balance_big_endian, sizeof (balance_big_endian));
 }
 
+std::atomic<uint64_t> rai::base_block::hash_computations (0);
+
 rai::base_block::base_block () :
 base_hashables (),
 signature (),
-work ()
+work (),
+hash_state (0)
 {
 }
 
 rai::base_block::base_block (rai::account const & account_a, rai::block_hash const & previous_a, rai::timestamp_t creation_time_a, rai::account const & representative_a, rai::amount const & balance_a, rai::signature const & signature_a, uint64_t work_a) :
 base_hashables (account_a, previous_a, creation_time_a, representative_a, balance_a),
 signature (signature_a),
-work (work_a)
+work (work_a),
+hash_state (0)
+{
+}
+
+rai::base_block::base_block (rai::base_block const & other_a) :
+base_hashables (other_a.base_hashables),
+signature (other_a.signature),
+work (other_a.work),
+hash_state (0)
 {
+	if (other_a.hash_state.load (std::memory_order_acquire) == 2)
+	{
+		hash_cached = other_a.hash_cached;
+		hash_state.store (2, std::memory_order_release);
+	}
+}
+
+rai::base_block & rai::base_block::operator= (rai::base_block const & other_a)
+{
+	base_hashables = other_a.base_hashables;
+	signature = other_a.signature;
+	work = other_a.work;
+	hash_invalidate ();
+	if (other_a.hash_state.load (std::memory_order_acquire) == 2)
+	{
+		hash_cached = other_a.hash_cached;
+		hash_state.store (2, std::memory_order_release);
+	}
+	return *this;
 }
 
 rai::block_hash rai::base_block::hash () const
 {
+	// Blocks are shared between threads, only the thread winning the 0 -> 1 transition stores the result
+	if (hash_state.load (std::memory_order_acquire) == 2)
+	{
+		return hash_cached;
+	}
 	rai::uint256_union result;
 	blake2b_state hash_l;
 	auto status (blake2b_init (&hash_l, sizeof (result.bytes)));
@@ -265,9 +301,21 @@ rai::block_hash rai::base_block::hash () const
 	hash (hash_l);
 	status = blake2b_final (&hash_l, result.bytes.data (), sizeof (result.bytes));
 	assert (status == 0);
+	hash_computations.fetch_add (1, std::memory_order_relaxed);
+	uint8_t expected (0);
+	if (hash_state.compare_exchange_strong (expected, 1, std::memory_order_acquire))
+	{
+		hash_cached = result;
+		hash_state.store (2, std::memory_order_release);
+	}
 	return result;
 }
 
+void rai::base_block::hash_invalidate ()
+{
+	hash_state.store (0, std::memory_order_release);
+}
+
 rai::short_timestamp rai::base_block::creation_time () const
 {
 	return base_hashables.creation_time;
@@ -316,21 +364,25 @@ bool rai::base_block::has_representative () const
 void rai::base_block::previous_set (rai::block_hash const & previous_a)
 {
 	base_hashables.previous = previous_a;
+	hash_invalidate ();
 }
 
 void rai::base_block::account_set (rai::account const & account_a)
 {
 	base_hashables.account = account_a;
+	hash_invalidate ();
 }
 
 void rai::base_block::representative_set (rai::account const & representative_a)
 {
 	base_hashables.representative = representative_a;
+	hash_invalidate ();
 }
 
 void rai::base_block::balance_set (rai::amount const & balance_a)
 {
 	base_hashables.balance = balance_a;
+	hash_invalidate ();
 }
 
 std::string rai::base_block::to_json () const
@@ -375,6 +427,7 @@ void rai::state_hashables::hash (blake2b_state & hash_a) const
 	blake2b_update (&hash_a, link.bytes.data (), sizeof (link.bytes));
 }
 
+size_t constexpr rai::block::previous_offset;
 size_t constexpr rai::state_block::size;
 
 // if time is 0, current time is taken
@@ -416,6 +469,12 @@ rai::uint256_union rai::state_block::link () const
 	return hashables.link;
 }
 
+void rai::state_block::link_set (rai::uint256_union const & link_a)
+{
+	hashables.link = link_a;
+	hash_invalidate ();
+}
+
 void rai::state_block::serialize (rai::stream & stream_a) const
 {
 	write (stream_a, base_hashables.account);
@@ -451,6 +510,7 @@ void rai::state_block::serialize_json (std::string & string_a) const
 
 bool rai::state_block::deserialize (rai::stream & stream_a)
 {
+	hash_invalidate ();
 	auto error (read (stream_a, base_hashables.account));
 	if (error)
 		return error;
@@ -478,6 +538,7 @@ bool rai::state_block::deserialize (rai::stream & stream_a)
 
 bool rai::state_block::deserialize_json (boost::property_tree::ptree const & tree_a)
 {
+	hash_invalidate ();
 	auto error (false);
 	try
 	{
@@ -722,6 +783,7 @@ std::string rai::comment_block::comment () const
 
 bool rai::comment_block::deserialize (rai::stream & stream_a)
 {
+	hash_invalidate ();
 	auto error (read (stream_a, base_hashables.account));
 	if (error)
 		return error;
@@ -752,6 +814,7 @@ bool rai::comment_block::deserialize (rai::stream & stream_a)
 
 bool rai::comment_block::deserialize_json (boost::property_tree::ptree const & tree_a)
 {
+	hash_invalidate ();
 	auto error (false);
 	try
 	{
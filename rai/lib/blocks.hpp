@@ -3,6 +3,7 @@
 #include <rai/lib/numbers.hpp>
 
 #include <assert.h>
+#include <atomic>
 #include <blake2/blake2.h>
 #include <boost/property_tree/json_parser.hpp>
 #include <streambuf>
@@ -130,6 +131,8 @@ public:
 	virtual rai::signature const & signature_get () const = 0;
 	virtual void signature_set (rai::uint512_union const &) = 0;
 	virtual ~block () = default;
+	// Offset of previous in the serialized form, the same for all block types
+	static size_t constexpr previous_offset = sizeof (rai::account) + sizeof (rai::short_timestamp);
 };
 
 // Non-final base class for block hashables, with some common fields
@@ -161,7 +164,9 @@ class base_block : public block
 public:
 	base_block ();
 	base_block (rai::account const &, rai::block_hash const &, rai::timestamp_t, rai::account const &, rai::amount const &, rai::signature const &, uint64_t);
-	// Return a digest of the hashables in this block.
+	base_block (rai::base_block const &);
+	rai::base_block & operator= (rai::base_block const &);
+	// Return a digest of the hashables in this block.  Computed once and memoized until a hashable changes.
 	rai::block_hash hash () const override;
 	virtual void hash (blake2b_state &) const = 0;
 	virtual bool deserialize (rai::stream &) = 0;
@@ -184,11 +189,20 @@ public:
 	virtual void signature_set (rai::uint512_union const &) override;
 	virtual uint64_t work_get () const override;
 	virtual void work_set (uint64_t) override;
+	// Number of hash digests actually computed, memoized hash () calls are not counted
+	static std::atomic<uint64_t> hash_computations;
 
 protected:
+	// Drop the memoized hash, must be called whenever a hashable changes
+	void hash_invalidate ();
 	rai::base_hashables base_hashables;
 	rai::signature signature;
 	rai::work work;
+
+private:
+	// 0: not computed, 1: being stored, 2: hash_cached is valid
+	mutable std::atomic<uint8_t> hash_state;
+	mutable rai::block_hash hash_cached;
 };
 
 enum class state_block_subtype : uint8_t
@@ -221,6 +235,7 @@ public:
 	using rai::block::hash;
 	void hash (blake2b_state &) const override;
 	rai::uint256_union link () const;
+	void link_set (rai::uint256_union const &);
 	virtual bool deserialize (rai::stream &) override;
 	virtual bool deserialize_json (boost::property_tree::ptree const &) override;
 	void serialize (rai::stream &) const override;
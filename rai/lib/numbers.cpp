@@ -530,6 +530,12 @@ bool rai::validate_message (rai::public_key const & public_key, rai::uint256_uni
 	return result;
 }
 
+void rai::validate_message_batch (unsigned char const ** m, size_t * mlen, unsigned char const ** pk, unsigned char const ** RS, size_t num, int * valid)
+{
+	// Return value only tells whether the whole batch is valid, individual results are in valid
+	ed25519_sign_open_batch (m, mlen, pk, RS, num, valid);
+}
+
 rai::uint128_struct::uint128_struct (rai::uint128_t const & value_a)
 {
 	rai::uint128_t number_l (value_a);
@@ -231,6 +231,8 @@ using short_string = uint512_union;
 
 rai::uint512_union sign_message (rai::raw_key const &, rai::public_key const &, rai::uint256_union const &);
 bool validate_message (rai::public_key const &, rai::uint256_union const &, rai::uint512_union const &);
+// Verifies a set of signatures at once, valid[i] is set to 1 if signature i is correct, 0 otherwise
+void validate_message_batch (unsigned char const **, size_t *, unsigned char const **, unsigned char const **, size_t, int *);
 void deterministic_key (rai::uint256_union const &, uint32_t, rai::uint256_union &);
 rai::public_key pub_key (rai::private_key const &);
 }
@@ -14,6 +14,11 @@ constexpr unsigned bootstrap_frontier_retry_limit = 16;
 constexpr double bootstrap_minimum_termination_time_sec = 30.0;
 constexpr unsigned bootstrap_max_new_connections = 10;
 constexpr unsigned bulk_push_cost_limit = 200;
+constexpr size_t frontier_req_send_buffer_size = 64 * 1024;
+constexpr size_t frontier_req_batch_max = frontier_req_send_buffer_size / (2 * sizeof (rai::uint256_union));
+constexpr size_t bulk_pull_send_buffer_size = 64 * 1024;
+constexpr size_t bulk_pull_blocks_batch_max = 4096;
+constexpr unsigned bulk_pull_backpressure_delay_ms = 10;
 
 rai::socket::socket (std::shared_ptr<rai::node> node_a) :
 socket_m (node_a->service),
@@ -572,11 +577,32 @@ void rai::bulk_pull_client::received_block (boost::system::error_code const & ec
 		connection->start_time = std::chrono::steady_clock::now ();
 	}
 	connection->attempt->total_blocks++;
-	connection->attempt->node->block_processor.add (block, std::chrono::steady_clock::time_point ());
+	connection->attempt->node->block_processor.add (block, std::chrono::steady_clock::time_point (), rai::block_queue::bootstrap);
 	if (!connection->hard_stop.load ())
+	{
+		throttled_receive_block ();
+	}
+}
+
+void rai::bulk_pull_client::throttled_receive_block ()
+{
+	auto node (connection->node);
+	if (!node->block_processor.full (rai::block_queue::bootstrap))
 	{
 		receive_block ();
 	}
+	else
+	{
+		// Leave the rest in the socket, TCP flow control slows the server down until the block processor catches up
+		node->stats.inc (rai::stat::type::bootstrap, rai::stat::detail::backpressure, rai::stat::dir::in);
+		auto this_l (shared_from_this ());
+		node->alarm.add (std::chrono::steady_clock::now () + std::chrono::milliseconds (bulk_pull_backpressure_delay_ms), [this_l]() {
+			if (!this_l->connection->pending_stop && !this_l->connection->hard_stop.load ())
+			{
+				this_l->throttled_receive_block ();
+			}
+		});
+	}
 }
 
 rai::bulk_push_client::bulk_push_client (std::shared_ptr<rai::bootstrap_client> const & connection_a) :
@@ -1656,18 +1682,32 @@ void rai::bulk_pull_server::set_current_end ()
 
 void rai::bulk_pull_server::send_next ()
 {
-	std::unique_ptr<rai::block> block (get_next ());
-	if (block != nullptr)
+	send_buffer->clear ();
+	size_t blocks (0);
 	{
+		// Fill the buffer with as many blocks as fit, copied from the stored values without deserializing them
+		rai::vectorstream stream (*send_buffer);
+		rai::transaction transaction (connection->node->store.environment, nullptr, false);
+		size_t size (0);
+		while (size < bulk_pull_send_buffer_size)
 		{
-			send_buffer->clear ();
-			rai::vectorstream stream (*send_buffer);
-			rai::serialize_block (stream, *block);
+			auto block_size (get_next_serialized (transaction, stream));
+			if (block_size == 0)
+			{
+				break;
+			}
+			size += block_size;
+			++blocks;
 		}
+	}
+	if (blocks != 0)
+	{
+		sent_count += blocks;
+		connection->node->stats.add (rai::stat::type::bootstrap, rai::stat::detail::blocks_sent, rai::stat::dir::out, blocks);
 		auto this_l (shared_from_this ());
 		if (connection->node->config.logging.bulk_pull_logging ())
 		{
-			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending block: %1%") % block->hash ().to_string ());
+			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending %1% blocks") % blocks);
 		}
 		connection->socket->async_write (send_buffer, [this_l](boost::system::error_code const & ec, size_t size_a) {
 			this_l->sent_action (ec, size_a);
@@ -1682,6 +1722,25 @@ void rai::bulk_pull_server::send_next ()
 std::unique_ptr<rai::block> rai::bulk_pull_server::get_next ()
 {
 	std::unique_ptr<rai::block> result;
+	std::vector<uint8_t> buffer;
+	size_t size (0);
+	{
+		rai::vectorstream stream (buffer);
+		rai::transaction transaction (connection->node->store.environment, nullptr, false);
+		size = get_next_serialized (transaction, stream);
+	}
+	if (size != 0)
+	{
+		rai::bufferstream stream (buffer.data (), buffer.size ());
+		result = rai::deserialize_block (stream);
+		assert (result != nullptr);
+	}
+	return result;
+}
+
+size_t rai::bulk_pull_server::get_next_serialized (MDB_txn * transaction_a, rai::stream & stream_a)
+{
+	size_t result (0);
 	bool send_current = false, set_current_to_end = false;
 
 	/*
@@ -1710,11 +1769,10 @@ std::unique_ptr<rai::block> rai::bulk_pull_server::get_next ()
 
 	if (send_current)
 	{
-		rai::transaction transaction (connection->node->store.environment, nullptr, false);
-		result = connection->node->store.block_get (transaction, current);
-		if (result != nullptr && set_current_to_end == false)
+		rai::block_hash previous (0);
+		result = connection->node->store.block_serialized_get (transaction_a, current, stream_a, previous);
+		if (result != 0 && set_current_to_end == false)
 		{
-			auto previous (result->previous ());
 			if (!previous.is_zero ())
 			{
 				current = previous;
@@ -1759,9 +1817,14 @@ void rai::bulk_pull_server::send_finished ()
 	send_buffer->clear ();
 	send_buffer->push_back (static_cast<uint8_t> (rai::block_type::not_a_block));
 	auto this_l (shared_from_this ());
+	auto elapsed (std::chrono::steady_clock::now () - start_time);
+	// A rate doesn't add up across sessions, the session time does, and blocks_sent over it gives the average rate
+	connection->node->stats.add (rai::stat::type::bootstrap, rai::stat::detail::send_time_ms, rai::stat::dir::out, std::chrono::duration_cast<std::chrono::milliseconds> (elapsed).count ());
+	auto seconds (std::chrono::duration_cast<std::chrono::duration<double>> (elapsed).count ());
+	auto blocks_per_sec (seconds > 0 ? static_cast<uint64_t> (sent_count / seconds) : sent_count);
 	if (connection->node->config.logging.bulk_pull_logging ())
 	{
-		BOOST_LOG (connection->node->log) << "Bulk sending finished";
+		BOOST_LOG (connection->node->log) << boost::str (boost::format ("Bulk sending finished, %1% blocks, %2% blocks/sec") % sent_count % blocks_per_sec);
 	}
 	connection->socket->async_write (send_buffer, [this_l](boost::system::error_code const & ec, size_t size_a) {
 		this_l->no_block_sent (ec, size_a);
@@ -1787,7 +1850,9 @@ void rai::bulk_pull_server::no_block_sent (boost::system::error_code const & ec,
 rai::bulk_pull_server::bulk_pull_server (std::shared_ptr<rai::bootstrap_server> const & connection_a, std::unique_ptr<rai::bulk_pull> request_a) :
 connection (connection_a),
 request (std::move (request_a)),
-send_buffer (std::make_shared<std::vector<uint8_t>> ())
+send_buffer (std::make_shared<std::vector<uint8_t>> ()),
+sent_count (0),
+start_time (std::chrono::steady_clock::now ())
 {
 	set_current_end ();
 }
@@ -2138,27 +2203,35 @@ void rai::bulk_pull_blocks_server::set_params ()
 
 void rai::bulk_pull_blocks_server::send_next ()
 {
-	std::unique_ptr<rai::block> block (get_next ());
-	if (block != nullptr)
+	send_buffer->clear ();
+	size_t blocks (0);
 	{
-		if (connection->node->config.logging.bulk_pull_logging ())
+		rai::vectorstream stream (*send_buffer);
+		size_t size (0);
+		rai::block_hash hash;
+		while (size < bulk_pull_send_buffer_size && blocks < bulk_pull_blocks_batch_max && !get_next_hash (hash))
 		{
-			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending block: %1%") % block->hash ().to_string ());
+			if (connection->node->config.logging.bulk_pull_logging ())
+			{
+				BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending block: %1%") % hash.to_string ());
+			}
+			if (request->mode == rai::bulk_pull_blocks_mode::list_blocks)
+			{
+				rai::block_hash previous;
+				size += connection->node->store.block_serialized_get (stream_transaction, hash, stream, previous);
+			}
+			else if (request->mode == rai::bulk_pull_blocks_mode::checksum_blocks)
+			{
+				checksum ^= hash;
+			}
+			++blocks;
 		}
-
-		send_buffer->clear ();
+	}
+	if (blocks != 0)
+	{
+		blocks_sent += blocks;
+		connection->node->stats.add (rai::stat::type::bootstrap, rai::stat::detail::blocks_sent, rai::stat::dir::out, blocks);
 		auto this_l (shared_from_this ());
-
-		if (request->mode == rai::bulk_pull_blocks_mode::list_blocks)
-		{
-			rai::vectorstream stream (*send_buffer);
-			rai::serialize_block (stream, *block);
-		}
-		else if (request->mode == rai::bulk_pull_blocks_mode::checksum_blocks)
-		{
-			checksum ^= block->hash ();
-		}
-
 		connection->socket->async_write (send_buffer, [this_l](boost::system::error_code const & ec, size_t size_a) {
 			this_l->sent_action (ec, size_a);
 		});
@@ -2199,6 +2272,18 @@ void rai::bulk_pull_blocks_server::send_next ()
 std::unique_ptr<rai::block> rai::bulk_pull_blocks_server::get_next ()
 {
 	std::unique_ptr<rai::block> result;
+	rai::block_hash hash;
+	if (!get_next_hash (hash))
+	{
+		rai::transaction transaction (connection->node->store.environment, nullptr, false);
+		result = connection->node->store.block_get (transaction, hash);
+	}
+	return result;
+}
+
+bool rai::bulk_pull_blocks_server::get_next_hash (rai::block_hash & hash_a)
+{
+	auto result (true);
 	bool out_of_bounds (false);
 
 	if (request->max_count != 0)
@@ -2218,8 +2303,8 @@ std::unique_ptr<rai::block> rai::bulk_pull_blocks_server::get_next ()
 			auto current = stream->first.uint256 ();
 			if (current < request->max_hash)
 			{
-				rai::transaction transaction (connection->node->store.environment, nullptr, false);
-				result = connection->node->store.block_get (transaction, current);
+				hash_a = current;
+				result = false;
 
 				++stream;
 			}
@@ -2248,9 +2333,14 @@ void rai::bulk_pull_blocks_server::send_finished ()
 	send_buffer->clear ();
 	send_buffer->push_back (static_cast<uint8_t> (rai::block_type::not_a_block));
 	auto this_l (shared_from_this ());
+	auto elapsed (std::chrono::steady_clock::now () - start_time);
+	// A rate doesn't add up across sessions, the session time does, and blocks_sent over it gives the average rate
+	connection->node->stats.add (rai::stat::type::bootstrap, rai::stat::detail::send_time_ms, rai::stat::dir::out, std::chrono::duration_cast<std::chrono::milliseconds> (elapsed).count ());
+	auto seconds (std::chrono::duration_cast<std::chrono::duration<double>> (elapsed).count ());
+	auto blocks_per_sec (seconds > 0 ? static_cast<uint64_t> (blocks_sent / seconds) : blocks_sent);
 	if (connection->node->config.logging.bulk_pull_logging ())
 	{
-		BOOST_LOG (connection->node->log) << "Bulk sending finished";
+		BOOST_LOG (connection->node->log) << boost::str (boost::format ("Bulk sending finished, %1% blocks, %2% blocks/sec") % blocks_sent % blocks_per_sec);
 	}
 	connection->socket->async_write (send_buffer, [this_l](boost::system::error_code const & ec, size_t size_a) {
 		this_l->no_block_sent (ec, size_a);
@@ -2280,7 +2370,9 @@ send_buffer (std::make_shared<std::vector<uint8_t>> ()),
 stream (nullptr),
 stream_transaction (connection_a->node->store.environment, nullptr, false),
 sent_count (0),
-checksum (0)
+checksum (0),
+blocks_sent (0),
+start_time (std::chrono::steady_clock::now ())
 {
 	set_params ();
 }
@@ -2433,15 +2525,19 @@ void rai::frontier_req_server::send_next ()
 		{
 			send_buffer->clear ();
 			rai::vectorstream stream (*send_buffer);
-			write (stream, current.bytes);
-			write (stream, info.head.bytes);
+			// Pack as many frontiers as fit, one write per buffer rather than per account
+			while (!current.is_zero () && send_buffer->size () < frontier_req_send_buffer_size)
+			{
+				write (stream, current.bytes);
+				write (stream, info.head.bytes);
+				if (connection->node->config.logging.bulk_pull_logging ())
+				{
+					BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending frontier for %1% %2%") % current.to_account () % info.head.to_string ());
+				}
+				next ();
+			}
 		}
 		auto this_l (shared_from_this ());
-		if (connection->node->config.logging.bulk_pull_logging ())
-		{
-			BOOST_LOG (connection->node->log) << boost::str (boost::format ("Sending frontier for %1% %2%") % current.to_account () % info.head.to_string ());
-		}
-		next ();
 		connection->socket->async_write (send_buffer, [this_l](boost::system::error_code const & ec, size_t size_a) {
 			this_l->sent_action (ec, size_a);
 		});
@@ -2503,12 +2599,21 @@ void rai::frontier_req_server::sent_action (boost::system::error_code const & ec
 
 void rai::frontier_req_server::next ()
 {
-	rai::transaction transaction (connection->node->store.environment, nullptr, false);
-	auto iterator (connection->node->store.latest_begin (transaction, current.number () + 1));
-	if (iterator != connection->node->store.latest_end ())
+	if (accounts.empty ())
 	{
-		current = rai::uint256_union (iterator->first.uint256 ());
-		info = rai::account_info (iterator->second);
+		// A short lived transaction per batch, a slow peer doesn't pin a reader between writes
+		auto & store (connection->node->store);
+		rai::transaction transaction (store.environment, nullptr, false);
+		for (auto i (store.latest_begin (transaction, current.number () + 1)), n (store.latest_end ()); i != n && accounts.size () < frontier_req_batch_max; ++i)
+		{
+			accounts.push_back (std::make_pair (rai::account (i->first.uint256 ()), rai::account_info (i->second)));
+		}
+	}
+	if (!accounts.empty ())
+	{
+		current = accounts.front ().first;
+		info = accounts.front ().second;
+		accounts.pop_front ();
 	}
 	else
 	{
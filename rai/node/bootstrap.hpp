@@ -128,6 +128,8 @@ public:
 	~bulk_pull_client ();
 	void request ();
 	void receive_block ();
+	// Receive the next block once the bootstrap queue of the block processor has room
+	void throttled_receive_block ();
 	void received_type ();
 	void received_block (boost::system::error_code const &, size_t, rai::block_type);
 	rai::block_hash first ();
@@ -238,6 +240,8 @@ public:
 	bulk_pull_server (std::shared_ptr<rai::bootstrap_server> const &, std::unique_ptr<rai::bulk_pull>);
 	void set_current_end ();
 	std::unique_ptr<rai::block> get_next ();
+	// Write the next block in wire format, returns the bytes written, 0 when done
+	size_t get_next_serialized (MDB_txn *, rai::stream &);
 	void send_next ();
 	void sent_action (boost::system::error_code const &, size_t);
 	void send_finished ();
@@ -247,6 +251,8 @@ public:
 	std::shared_ptr<std::vector<uint8_t>> send_buffer;
 	rai::block_hash current;
 	bool include_start;
+	uint64_t sent_count;
+	std::chrono::steady_clock::time_point start_time;
 };
 class bulk_pull_account;
 class bulk_pull_account_server : public std::enable_shared_from_this<rai::bulk_pull_account_server>
@@ -275,6 +281,8 @@ public:
 	bulk_pull_blocks_server (std::shared_ptr<rai::bootstrap_server> const &, std::unique_ptr<rai::bulk_pull_blocks>);
 	void set_params ();
 	std::unique_ptr<rai::block> get_next ();
+	// Advance to the next hash in range, returns true when done
+	bool get_next_hash (rai::block_hash &);
 	void send_next ();
 	void sent_action (boost::system::error_code const &, size_t);
 	void send_finished ();
@@ -286,6 +294,8 @@ public:
 	rai::transaction stream_transaction;
 	uint32_t sent_count;
 	rai::block_hash checksum;
+	uint64_t blocks_sent;
+	std::chrono::steady_clock::time_point start_time;
 };
 class bulk_push_server : public std::enable_shared_from_this<rai::bulk_push_server>
 {
@@ -315,5 +325,7 @@ public:
 	std::unique_ptr<rai::frontier_req> request;
 	std::shared_ptr<std::vector<uint8_t>> send_buffer;
 	size_t count;
+	// Frontiers after current, read a batch at a time so no transaction is held while writing to the peer
+	std::deque<std::pair<rai::account, rai::account_info>> accounts;
 };
 }
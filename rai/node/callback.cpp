@@ -0,0 +1,442 @@
+#include <rai/node/callback.hpp>
+
+#include <rai/node/node.hpp>
+
+#include <boost/filesystem.hpp>
+
+size_t constexpr rai::callback_dispatcher::pending_max;
+std::chrono::seconds constexpr rai::callback_dispatcher::retry_interval;
+
+rai::callback_queue::callback_queue (boost::filesystem::path const & path_a, size_t max_a) :
+max (max_a),
+path (path_a),
+popped (0)
+{
+	// The file is only created once something needs to be retried
+	if (boost::filesystem::exists (path))
+	{
+		std::ifstream existing (path.string ());
+		std::string line;
+		while (std::getline (existing, line))
+		{
+			if (!line.empty () && entries.size () < max)
+			{
+				entries.push_back (line);
+			}
+		}
+		existing.close ();
+		rewrite ();
+	}
+}
+
+bool rai::callback_queue::push (std::string const & entry_a)
+{
+	auto result (entries.size () >= max);
+	if (!result)
+	{
+		assert (entry_a.find ('\n') == std::string::npos);
+		entries.push_back (entry_a);
+		if (!file.is_open ())
+		{
+			file.open (path.string (), std::ios::out | std::ios::app);
+		}
+		file << entry_a << '\n';
+		file.flush ();
+	}
+	return result;
+}
+
+std::vector<std::string> rai::callback_queue::front (size_t count_a) const
+{
+	std::vector<std::string> result;
+	for (auto i (entries.begin ()), n (entries.end ()); i != n && result.size () < count_a; ++i)
+	{
+		result.push_back (*i);
+	}
+	return result;
+}
+
+void rai::callback_queue::pop (size_t count_a)
+{
+	count_a = std::min (count_a, entries.size ());
+	entries.erase (entries.begin (), entries.begin () + count_a);
+	popped += count_a;
+	// Rewriting drops popped entries from the file, amortized over as many pops as there are remaining entries
+	if (entries.empty () || popped >= entries.size ())
+	{
+		rewrite ();
+	}
+}
+
+size_t rai::callback_queue::size () const
+{
+	return entries.size ();
+}
+
+void rai::callback_queue::rewrite ()
+{
+	if (file.is_open ())
+	{
+		file.close ();
+	}
+	file.open (path.string (), std::ios::out | std::ios::trunc);
+	for (auto & i : entries)
+	{
+		file << i << '\n';
+	}
+	file.flush ();
+	popped = 0;
+}
+
+rai::callback_connection::callback_connection (boost::asio::io_service & service_a) :
+socket (service_a)
+{
+}
+
+rai::callback_dispatcher::callback_dispatcher (rai::node & node_a, boost::filesystem::path const & path_a) :
+node (node_a),
+connections (0),
+queue (path_a, node_a.config.callback_queue_max),
+resolving (false),
+retrying (false),
+retry_ready (true),
+stopped (false)
+{
+}
+
+void rai::callback_dispatcher::start ()
+{
+	{
+		std::unique_lock<std::mutex> lock (mutex);
+		// Entries reloaded from the file
+		node.stats.set (rai::stat::type::http_callback, rai::stat::detail::queue_size, rai::stat::dir::in, queue.size ());
+		dispatch (lock);
+	}
+	ongoing_retry ();
+}
+
+void rai::callback_dispatcher::stop ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	stopped = true;
+	for (auto & i : idle)
+	{
+		boost::system::error_code ec;
+		i->socket.close (ec);
+	}
+	assert (connections >= idle.size ());
+	connections -= idle.size ();
+	idle.clear ();
+	// Undelivered events are kept for the next start
+	while (!pending.empty ())
+	{
+		queue_push (pending.front ());
+		pending.pop_front ();
+	}
+}
+
+void rai::callback_dispatcher::add (std::string const & event_a)
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	if (!stopped)
+	{
+		if (pending.size () < pending_max)
+		{
+			pending.push_back (event_a);
+		}
+		else
+		{
+			queue_push (event_a);
+		}
+		dispatch (lock);
+	}
+}
+
+size_t rai::callback_dispatcher::size ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return queue.size ();
+}
+
+void rai::callback_dispatcher::queue_push (std::string const & event_a)
+{
+	if (!queue.push (event_a))
+	{
+		node.stats.inc (rai::stat::type::http_callback, rai::stat::detail::queue, rai::stat::dir::in);
+	}
+	else
+	{
+		node.stats.inc (rai::stat::type::http_callback, rai::stat::detail::overflow, rai::stat::dir::out);
+	}
+	node.stats.set (rai::stat::type::http_callback, rai::stat::detail::queue_size, rai::stat::dir::in, queue.size ());
+}
+
+void rai::callback_dispatcher::resolve ()
+{
+	auto this_l (shared_from_this ());
+	auto resolver (std::make_shared<boost::asio::ip::tcp::resolver> (node.service));
+	auto address (node.config.callback_address);
+	auto port (node.config.callback_port);
+	resolver->async_resolve (boost::asio::ip::tcp::resolver::query (address, std::to_string (port)), [this_l, resolver, address, port](boost::system::error_code const & ec, boost::asio::ip::tcp::resolver::iterator i_a) {
+		std::unique_lock<std::mutex> lock (this_l->mutex);
+		this_l->resolving = false;
+		if (!ec)
+		{
+			this_l->endpoints = std::make_shared<std::vector<boost::asio::ip::tcp::endpoint>> (i_a, boost::asio::ip::tcp::resolver::iterator{});
+			this_l->dispatch (lock);
+		}
+		else
+		{
+			if (this_l->node.config.logging.callback_logging ())
+			{
+				BOOST_LOG (this_l->node.log) << boost::str (boost::format ("Error resolving callback: %1%:%2%: %3%") % address % port % ec.message ());
+			}
+			this_l->node.stats.inc (rai::stat::type::http_callback, rai::stat::detail::failure, rai::stat::dir::out);
+			// The retry timer resolves again
+			while (!this_l->pending.empty ())
+			{
+				this_l->queue_push (this_l->pending.front ());
+				this_l->pending.pop_front ();
+			}
+		}
+	});
+}
+
+std::shared_ptr<rai::callback_connection> rai::callback_dispatcher::connection_get ()
+{
+	std::shared_ptr<rai::callback_connection> result;
+	if (!idle.empty ())
+	{
+		result = idle.back ();
+		idle.pop_back ();
+	}
+	else if (connections < node.config.callback_connections)
+	{
+		result = std::make_shared<rai::callback_connection> (node.service);
+		++connections;
+	}
+	return result;
+}
+
+void rai::callback_dispatcher::dispatch (std::unique_lock<std::mutex> & lock_a)
+{
+	assert (lock_a.owns_lock ());
+	if (!stopped)
+	{
+		if (endpoints != nullptr)
+		{
+			auto batch_size (node.config.callback_batch_size);
+			auto more (true);
+			while (more && !pending.empty ())
+			{
+				auto connection (connection_get ());
+				if (connection != nullptr)
+				{
+					std::vector<std::string> events;
+					while (!pending.empty () && events.size () < batch_size)
+					{
+						events.push_back (std::move (pending.front ()));
+						pending.pop_front ();
+					}
+					send (connection, events, false);
+				}
+				else
+				{
+					more = false;
+				}
+			}
+			if (retry_ready && !retrying && queue.size () > 0)
+			{
+				auto connection (connection_get ());
+				if (connection != nullptr)
+				{
+					retrying = true;
+					auto events (queue.front (batch_size));
+					node.stats.add (rai::stat::type::http_callback, rai::stat::detail::retry, rai::stat::dir::out, events.size ());
+					send (connection, events, true);
+				}
+			}
+		}
+		else if (!resolving && (!pending.empty () || queue.size () > 0))
+		{
+			resolving = true;
+			resolve ();
+		}
+	}
+}
+
+void rai::callback_dispatcher::send (std::shared_ptr<rai::callback_connection> connection_a, std::vector<std::string> const & events_a, bool retry_a)
+{
+	assert (!events_a.empty ());
+	std::string body;
+	if (node.config.callback_batch_size > 1)
+	{
+		body += '[';
+		for (auto i (events_a.begin ()), n (events_a.end ()); i != n; ++i)
+		{
+			if (i != events_a.begin ())
+			{
+				body += ',';
+			}
+			body += *i;
+		}
+		body += ']';
+	}
+	else
+	{
+		body = events_a.front ();
+	}
+	auto & request (connection_a->request);
+	request = boost::beast::http::request<boost::beast::http::string_body> ();
+	request.method (boost::beast::http::verb::post);
+	request.target (node.config.callback_target);
+	request.version (11);
+	request.insert (boost::beast::http::field::host, node.config.callback_address);
+	request.insert (boost::beast::http::field::content_type, "application/json");
+	request.keep_alive (true);
+	request.body () = std::move (body);
+	request.prepare_payload ();
+	auto this_l (shared_from_this ());
+	auto start (std::chrono::steady_clock::now ());
+	auto reused (connection_a->socket.is_open ());
+	auto write ([this_l, connection_a, events_a, retry_a, reused, start]() {
+		boost::beast::http::async_write (connection_a->socket, connection_a->request, [this_l, connection_a, events_a, retry_a, reused, start](boost::system::error_code const & ec, size_t bytes_transferred) {
+			if (!ec)
+			{
+				connection_a->response = boost::beast::http::response<boost::beast::http::string_body> ();
+				boost::beast::http::async_read (connection_a->socket, connection_a->buffer, connection_a->response, [this_l, connection_a, events_a, retry_a, reused, start](boost::system::error_code const & ec, size_t bytes_transferred) {
+					this_l->completed (connection_a, events_a, retry_a, reused, ec, start);
+				});
+			}
+			else
+			{
+				this_l->completed (connection_a, events_a, retry_a, reused, ec, start);
+			}
+		});
+	});
+	if (reused)
+	{
+		write ();
+	}
+	else
+	{
+		auto endpoints_l (endpoints);
+		boost::asio::async_connect (connection_a->socket, endpoints_l->begin (), endpoints_l->end (), [this_l, connection_a, events_a, retry_a, reused, start, endpoints_l, write](boost::system::error_code const & ec, std::vector<boost::asio::ip::tcp::endpoint>::iterator) {
+			if (!ec)
+			{
+				write ();
+			}
+			else
+			{
+				{
+					// The address may have moved, resolve it again before the next attempt
+					std::lock_guard<std::mutex> lock (this_l->mutex);
+					if (this_l->endpoints == endpoints_l)
+					{
+						this_l->endpoints = nullptr;
+					}
+				}
+				this_l->completed (connection_a, events_a, retry_a, reused, ec, start);
+			}
+		});
+	}
+}
+
+void rai::callback_dispatcher::completed (std::shared_ptr<rai::callback_connection> connection_a, std::vector<std::string> const & events_a, bool retry_a, bool reused_a, boost::system::error_code const & ec, std::chrono::steady_clock::time_point start_a)
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	if (ec && reused_a && !stopped && endpoints != nullptr)
+	{
+		// The receiver may have closed the connection while it was idle, send once more on a new connection before counting a failure
+		node.stats.inc (rai::stat::type::http_callback, rai::stat::detail::reconnect, rai::stat::dir::out);
+		boost::system::error_code ignored;
+		connection_a->socket.close (ignored);
+		connection_a->buffer.consume (connection_a->buffer.size ());
+		send (connection_a, events_a, retry_a);
+	}
+	else
+	{
+		auto keep (false);
+		if (!ec)
+		{
+			auto status (connection_a->response.result ());
+			if (status == boost::beast::http::status::ok)
+			{
+				node.stats.add (rai::stat::type::http_callback, rai::stat::detail::send, rai::stat::dir::out, events_a.size ());
+				node.stats.add (rai::stat::type::http_callback_latency, rai::stat::detail::send, rai::stat::dir::out, std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start_a).count ());
+			}
+			else
+			{
+				// The receiver has seen the events, resending them wouldn't change its answer
+				node.stats.inc (rai::stat::type::http_callback, rai::stat::detail::failure, rai::stat::dir::out);
+				if (node.config.logging.callback_logging ())
+				{
+					BOOST_LOG (node.log) << boost::str (boost::format ("Callback to %1%:%2% failed with status: %3%") % node.config.callback_address % node.config.callback_port % status);
+				}
+			}
+			node.stats.inc (rai::stat::type::http_callback, rai::stat::detail::batch, rai::stat::dir::out);
+			if (retry_a)
+			{
+				queue.pop (events_a.size ());
+				node.stats.add (rai::stat::type::http_callback, rai::stat::detail::queue, rai::stat::dir::out, events_a.size ());
+				node.stats.set (rai::stat::type::http_callback, rai::stat::detail::queue_size, rai::stat::dir::in, queue.size ());
+			}
+			keep = connection_a->response.keep_alive ();
+		}
+		else
+		{
+			node.stats.inc (rai::stat::type::http_callback, rai::stat::detail::failure, rai::stat::dir::out);
+			if (node.config.logging.callback_logging ())
+			{
+				BOOST_LOG (node.log) << boost::str (boost::format ("Unable to complete callback: %1%:%2%: %3%") % node.config.callback_address % node.config.callback_port % ec.message ());
+			}
+			if (retry_a)
+			{
+				retry_ready = false;
+			}
+			else
+			{
+				for (auto & i : events_a)
+				{
+					queue_push (i);
+				}
+			}
+		}
+		if (retry_a)
+		{
+			retrying = false;
+		}
+		if (keep && !stopped)
+		{
+			idle.push_back (connection_a);
+		}
+		else
+		{
+			boost::system::error_code ignored;
+			connection_a->socket.close (ignored);
+			connection_a->buffer.consume (connection_a->buffer.size ());
+			--connections;
+		}
+		dispatch (lock);
+	}
+}
+
+void rai::callback_dispatcher::ongoing_retry ()
+{
+	{
+		std::unique_lock<std::mutex> lock (mutex);
+		if (stopped)
+		{
+			return;
+		}
+		retry_ready = true;
+		dispatch (lock);
+	}
+	std::weak_ptr<rai::callback_dispatcher> dispatcher_w (shared_from_this ());
+	node.alarm.add (std::chrono::steady_clock::now () + retry_interval, [dispatcher_w]() {
+		if (auto dispatcher_l = dispatcher_w.lock ())
+		{
+			dispatcher_l->ongoing_retry ();
+		}
+	});
+}
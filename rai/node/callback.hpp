@@ -0,0 +1,93 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rai
+{
+class node;
+/**
+ * Bounded FIFO of strings persisted to a file, one per line, so undelivered callbacks survive a restart.
+ * Entries are appended as they are pushed and the file is rewritten once enough have been popped.
+ */
+class callback_queue
+{
+public:
+	callback_queue (boost::filesystem::path const &, size_t);
+	// Returns true if the queue is full and the entry was dropped
+	bool push (std::string const &);
+	// Copies up to count entries from the front without removing them
+	std::vector<std::string> front (size_t) const;
+	void pop (size_t);
+	size_t size () const;
+	size_t max;
+
+private:
+	void rewrite ();
+	boost::filesystem::path path;
+	std::deque<std::string> entries;
+	std::ofstream file;
+	// Entries popped since the file was last rewritten
+	size_t popped;
+};
+class callback_connection
+{
+public:
+	callback_connection (boost::asio::io_service &);
+	boost::asio::ip::tcp::socket socket;
+	boost::beast::flat_buffer buffer;
+	boost::beast::http::request<boost::beast::http::string_body> request;
+	boost::beast::http::response<boost::beast::http::string_body> response;
+};
+/**
+ * Delivers block events to the HTTP callback. The address is resolved once and up to callback_connections keep-alive connections are reused.
+ * With a callback_batch_size above 1, events are POSTed as a JSON array. Events that fail to deliver go to a callback_queue and are retried.
+ */
+class callback_dispatcher : public std::enable_shared_from_this<rai::callback_dispatcher>
+{
+public:
+	callback_dispatcher (rai::node &, boost::filesystem::path const &);
+	void start ();
+	void stop ();
+	// Queues the JSON text of one event
+	void add (std::string const &);
+	// Events waiting for retry
+	size_t size ();
+	rai::node & node;
+	// Events waiting for a connection, beyond this new events go straight to the retry queue
+	static size_t constexpr pending_max = 4096;
+	static std::chrono::seconds constexpr retry_interval = std::chrono::seconds (5);
+
+private:
+	void resolve ();
+	void dispatch (std::unique_lock<std::mutex> &);
+	std::shared_ptr<rai::callback_connection> connection_get ();
+	void send (std::shared_ptr<rai::callback_connection>, std::vector<std::string> const &, bool);
+	// reused is whether the connection was taken from idle, a failure on it is retried once on a new connection
+	void completed (std::shared_ptr<rai::callback_connection>, std::vector<std::string> const &, bool, bool, boost::system::error_code const &, std::chrono::steady_clock::time_point);
+	void queue_push (std::string const &);
+	void ongoing_retry ();
+	std::mutex mutex;
+	std::deque<std::string> pending;
+	std::shared_ptr<std::vector<boost::asio::ip::tcp::endpoint>> endpoints;
+	std::vector<std::shared_ptr<rai::callback_connection>> idle;
+	// Connections open or in use
+	size_t connections;
+	rai::callback_queue queue;
+	bool resolving;
+	// A batch from the retry queue is being sent
+	bool retrying;
+	// Set by the retry timer, cleared when a retry fails so a dead receiver is only tried once per interval
+	bool retry_ready;
+	bool stopped;
+};
+}
@@ -31,6 +31,8 @@ void rai::add_node_options (boost::program_options::options_description & descri
 	("vacuum", "Compact database. If data_path is missing, the database in data directory is compacted.")
 	("snapshot", "Compact database and create snapshot, functions similar to vacuum but does not replace the existing database")
 	("unchecked_clear", "Clear unchecked blocks")
+	("account_height_build", "Build the account height index used to page through account history, it is maintained from then on")
+	("rep_weights_generate", "Write the bootstrap representative weights of the current ledger to <file>, in the rep_weights.bin format")
 	("data_path", boost::program_options::value<std::string> (), "Use the supplied path as the data directory")
 	("delete_node_id", "Delete the node ID in the database")
 	("set_node_id", "Sets the node ID, to the first account within the specified <wallet> (with <password>).  Privacy warning: the Node ID is publicly visible by all peers!")
@@ -233,6 +235,59 @@ std::error_code rai::handle_node_options (boost::program_options::variables_map
 		node.node->store.unchecked_clear (transaction);
 		std::cerr << "Unchecked blocks deleted" << std::endl;
 	}
+	else if (vm.count ("account_height_build"))
+	{
+		inactive_node node (data_path);
+		rai::transaction transaction (node.node->store.environment, nullptr, true);
+		auto count (node.node->store.account_height_build (transaction));
+		std::cerr << boost::str (boost::format ("Account height index built, %1% blocks\n") % count);
+	}
+	else if (vm.count ("rep_weights_generate"))
+	{
+		if (vm.count ("file") == 1)
+		{
+			// Largest representatives covering 99% of the delegated weight, used until 250000 blocks before the current count
+			auto const cutoff_blocks (250000);
+			inactive_node node (data_path);
+			rai::transaction transaction (node.node->store.environment, nullptr, false);
+			auto reps (node.node->store.rep_weights.top (std::numeric_limits<size_t>::max ()));
+			rai::uint128_t delegated (0);
+			for (auto & rep : reps)
+			{
+				delegated += rep.second;
+			}
+			std::vector<std::pair<rai::account, rai::amount_t>> weights;
+			rai::uint128_t total (0);
+			for (auto i (reps.begin ()), n (reps.end ()); i != n && i->second != 0 && total < delegated / 100 * 99; ++i)
+			{
+				weights.push_back (*i);
+				total += i->second;
+			}
+			auto block_count (node.node->store.block_count (transaction).sum ());
+			uint64_t max_blocks (block_count > cutoff_blocks ? block_count - cutoff_blocks : 0);
+			std::vector<uint8_t> buffer;
+			{
+				rai::vectorstream stream (buffer);
+				rai::bootstrap_weights::serialize (stream, max_blocks, weights);
+			}
+			std::ofstream file (vm["file"].as<std::string> (), std::ios::binary | std::ios::trunc);
+			file.write (reinterpret_cast<char const *> (buffer.data ()), buffer.size ());
+			if (!file.fail ())
+			{
+				std::cout << boost::str (boost::format ("Wrote %1% representatives, used until the ledger holds %2% blocks\n") % weights.size () % max_blocks);
+			}
+			else
+			{
+				std::cerr << "Could not write <file>\n";
+				ec = rai::error_cli::generic;
+			}
+		}
+		else
+		{
+			std::cerr << "rep_weights_generate command requires one <file> option\n";
+			ec = rai::error_cli::invalid_arguments;
+		}
+	}
 	else if (vm.count ("delete_node_id"))
 	{
 		inactive_node node (data_path);
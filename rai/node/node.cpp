@@ -29,10 +29,22 @@ std::chrono::seconds constexpr rai::node::period;
 std::chrono::seconds constexpr rai::node::cutoff;
 std::chrono::seconds constexpr rai::node::syn_cookie_cutoff;
 std::chrono::minutes constexpr rai::node::backup_interval;
+std::chrono::hours constexpr rai::node::unchecked_cutoff;
+std::chrono::minutes constexpr rai::node::unchecked_cleanup_interval;
+size_t constexpr rai::node::unchecked_expire_batch;
 int constexpr rai::port_mapping::mapping_timeout;
 int constexpr rai::port_mapping::check_timeout;
 unsigned constexpr rai::active_transactions::announce_interval_ms;
 size_t constexpr rai::block_arrival::arrival_size_min;
+size_t constexpr rai::signature_checker::batch_size;
+size_t constexpr rai::vote_generator::max_hashes;
+size_t constexpr rai::vote_generator::max_queue;
+size_t constexpr rai::block_processor::process_batch_max;
+size_t constexpr rai::block_processor::prefetch_min;
+size_t constexpr rai::block_processor::verification_batch_max;
+size_t constexpr rai::block_processor::queue_count;
+size_t constexpr rai::block_processor::queue_max;
+unsigned constexpr rai::network::receive_sockets_max;
 std::chrono::seconds constexpr rai::block_arrival::arrival_time_min;
 
 rai::endpoint rai::map_endpoint_to_v6 (rai::endpoint const & endpoint_a)
@@ -45,12 +57,167 @@ rai::endpoint rai::map_endpoint_to_v6 (rai::endpoint const & endpoint_a)
 	return endpoint_l;
 }
 
+#ifdef SO_REUSEPORT
+namespace
+{
+using reuse_port = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+}
+#endif
+
+rai::datagram_batch::datagram_batch (size_t size_a) :
+buffers (size_a),
+remotes (size_a),
+sizes (size_a, 0)
+{
+#ifdef __linux__
+	messages.resize (size_a);
+	iovecs.resize (size_a);
+	for (size_t i (0); i < size_a; ++i)
+	{
+		iovecs[i].iov_base = buffers[i].data ();
+		iovecs[i].iov_len = buffers[i].size ();
+		messages[i].msg_hdr = msghdr ();
+		messages[i].msg_hdr.msg_name = remotes[i].data ();
+		messages[i].msg_hdr.msg_iov = &iovecs[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+#endif
+}
+
+int rai::datagram_batch::receive (int socket_a)
+{
+	auto result (-1);
+#ifdef __linux__
+	// Only the lengths written by the previous call need resetting
+	for (size_t i (0), n (messages.size ()); i < n; ++i)
+	{
+		messages[i].msg_hdr.msg_namelen = remotes[i].capacity ();
+		messages[i].msg_len = 0;
+	}
+	result = recvmmsg (socket_a, messages.data (), messages.size (), MSG_DONTWAIT, nullptr);
+	for (auto i (0); i < result; ++i)
+	{
+		remotes[i].resize (messages[i].msg_hdr.msg_namelen);
+		sizes[i] = messages[i].msg_len;
+	}
+#else
+	errno = ENOSYS;
+#endif
+	return result;
+}
+
+rai::receive_socket::receive_socket (rai::network & network_a, uint16_t port_a, unsigned index_a) :
+batch (network_a.batch_io () ? network_a.node.config.udp_batch_size : 0),
+socket (network_a.node.service),
+network (network_a),
+index (index_a)
+{
+	rai::endpoint endpoint_l (boost::asio::ip::address_v6::any (), port_a);
+	socket.open (endpoint_l.protocol ());
+#ifdef SO_REUSEPORT
+	socket.set_option (reuse_port (true));
+#endif
+	socket.bind (endpoint_l);
+}
+
+void rai::receive_socket::receive ()
+{
+	if (network.batch_io ())
+	{
+		socket.async_wait (boost::asio::ip::udp::socket::wait_read, [this](boost::system::error_code const & error) {
+			receive_batch_action (error);
+		});
+		return;
+	}
+	socket.async_receive_from (boost::asio::buffer (buffer.data (), buffer.size ()), remote, [this](boost::system::error_code const & error, size_t size_a) {
+		receive_action (error, size_a);
+	});
+}
+
+void rai::receive_socket::receive_action (boost::system::error_code const & error, size_t size_a)
+{
+	if (!error && network.on)
+	{
+		network.process_packet (buffer.data (), size_a, remote, index);
+		receive ();
+	}
+	else
+	{
+		if (error && network.node.config.logging.network_logging ())
+		{
+			BOOST_LOG (network.node.log) << boost::str (boost::format ("UDP Receive error on socket %1%: %2%") % index % error.message ());
+		}
+		if (network.on)
+		{
+			network.node.alarm.add (std::chrono::steady_clock::now () + std::chrono::seconds (5), [this]() { receive (); });
+		}
+	}
+}
+
+void rai::receive_socket::receive_batch_action (boost::system::error_code const & error)
+{
+	if (!error && network.on)
+	{
+		network.process_batch (batch, batch.receive (socket.native_handle ()), index);
+		receive ();
+	}
+	else
+	{
+		receive_action (error, 0);
+	}
+}
+
+void rai::receive_socket::stop ()
+{
+	boost::system::error_code ignored;
+	socket.close (ignored);
+}
+
 rai::network::network (rai::node & node_a, uint16_t port) :
-socket (node_a.service, rai::endpoint (boost::asio::ip::address_v6::any (), port)),
+batch (node_a.config.udp_batch_size > 1 ? node_a.config.udp_batch_size : 0),
+socket (node_a.service),
+send_flush_scheduled (false),
 resolver (node_a.service),
 node (node_a),
 on (true)
 {
+	rai::endpoint endpoint_l (boost::asio::ip::address_v6::any (), port);
+	socket.open (endpoint_l.protocol ());
+	auto receive_sockets_l (std::min (node.config.receive_sockets, receive_sockets_max));
+#ifdef SO_REUSEPORT
+	if (receive_sockets_l > 1)
+	{
+		socket.set_option (reuse_port (true));
+	}
+#else
+	// Without SO_REUSEPORT the port can only be bound once
+	receive_sockets_l = 1;
+#endif
+	socket.bind (endpoint_l);
+	// Bind to the actual port in case an ephemeral port was requested
+	auto port_l (socket.local_endpoint ().port ());
+	for (auto i (1u); i < receive_sockets_l; ++i)
+	{
+		receive_sockets.push_back (std::unique_ptr<rai::receive_socket> (new rai::receive_socket (*this, port_l, i)));
+	}
+}
+
+void rai::network::start ()
+{
+	receive ();
+	for (auto & i : receive_sockets)
+	{
+		i->receive ();
+	}
+}
+
+bool rai::network::batch_io () const
+{
+#ifdef __linux__
+	return node.config.udp_batch_size > 1;
+#else
+	return false;
+#endif
 }
 
 void rai::network::receive ()
@@ -60,6 +227,14 @@ void rai::network::receive ()
 		BOOST_LOG (node.log) << "Receiving packet";
 	}
 	std::unique_lock<std::mutex> lock (socket_mutex);
+	if (batch_io ())
+	{
+		// Wait for the socket to become readable then drain it with recvmmsg
+		socket.async_wait (boost::asio::ip::udp::socket::wait_read, [this](boost::system::error_code const & error) {
+			receive_batch_action (error);
+		});
+		return;
+	}
 	socket.async_receive_from (boost::asio::buffer (buffer.data (), buffer.size ()), remote, [this](boost::system::error_code const & error, size_t size_a) {
 		receive_action (error, size_a);
 	});
@@ -69,6 +244,10 @@ void rai::network::stop ()
 {
 	on = false;
 	socket.close ();
+	for (auto & i : receive_sockets)
+	{
+		i->stop ();
+	}
 	resolver.cancel ();
 }
 
@@ -263,8 +442,9 @@ void rai::network::republish_vote (std::shared_ptr<rai::vote> vote_a)
 
 void rai::network::broadcast_confirm_req (std::shared_ptr<rai::block> block_a)
 {
-	auto list (std::make_shared<std::vector<rai::peer_information>> (node.peers.representatives (std::numeric_limits<size_t>::max ())));
-	if (list->empty () || node.peers.total_weight () < node.config.online_weight_minimum.number ())
+	auto peers_l (node.peers.snapshot ());
+	auto list (std::make_shared<std::vector<rai::peer_information>> (peers_l->representatives));
+	if (list->empty () || peers_l->total_weight < node.config.online_weight_minimum.number ())
 	{
 		// broadcast request to all peers
 		list = std::make_shared<std::vector<rai::peer_information>> (node.peers.list_vector ());
@@ -403,10 +583,30 @@ public:
 		node.process_active (message_a.block);
 		node.active.publish (message_a.block);
 		rai::transaction transaction_a (node.store.environment, nullptr, false);
-		auto successor (node.ledger.successor (transaction_a, message_a.block->root ()));
+		std::shared_ptr<rai::block> successor (node.ledger.successor (transaction_a, message_a.block->root ()));
 		if (successor != nullptr)
 		{
-			confirm_block (transaction_a, node, sender, std::move (successor));
+			// Nodes without voting representatives have no vote to send, so they don't send the successor either
+			if (node.config.enable_voting && node.wallets.have_reps () && std::chrono::system_clock::now () >= node.config.generate_hash_votes_at)
+			{
+				auto hash (successor->hash ());
+				// The peer can only use a vote by hash if it has the block, send ours if it asked about a different one
+				if (hash != message_a.block->hash ())
+				{
+					rai::publish publish (successor);
+					std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
+					{
+						rai::vectorstream stream (*bytes);
+						publish.serialize (stream);
+					}
+					node.network.republish (hash, bytes, sender);
+				}
+				node.vote_generator.add (hash, sender);
+			}
+			else
+			{
+				confirm_block (transaction_a, node, sender, std::move (successor));
+			}
 		}
 	}
 	void confirm_ack (rai::confirm_ack const & message_a) override
@@ -501,115 +701,155 @@ void rai::network::receive_action (boost::system::error_code const & error, size
 {
 	if (!error && on)
 	{
-		if (!rai::reserved_address (remote, false) && remote != endpoint ())
+		process_packet (buffer.data (), size_a, remote, 0);
+		receive ();
+	}
+	else
+	{
+		if (error)
 		{
-			network_message_visitor visitor (node, remote);
-			rai::message_parser parser (visitor, node.work);
-			parser.deserialize_buffer (buffer.data (), size_a);
-			if (parser.status != rai::message_parser::parse_status::success)
+			if (node.config.logging.network_logging ())
 			{
-				node.stats.inc (rai::stat::type::error);
+				BOOST_LOG (node.log) << boost::str (boost::format ("UDP Receive error: %1%") % error.message ());
+			}
+		}
+		if (on)
+		{
+			node.alarm.add (std::chrono::steady_clock::now () + std::chrono::seconds (5), [this]() { receive (); });
+		}
+	}
+}
 
-				if (parser.status == rai::message_parser::parse_status::insufficient_work)
-				{
-					if (node.config.logging.insufficient_work_logging ())
-					{
-						BOOST_LOG (node.log) << "Insufficient work in message"; // << (int)buffer.data()[5];
-					}
+void rai::network::receive_batch_action (boost::system::error_code const & error)
+{
+	if (!error && on)
+	{
+		process_batch (batch, batch.receive (socket.native_handle ()), 0);
+		receive ();
+	}
+	else
+	{
+		receive_action (error, 0);
+	}
+}
 
-					// We've already increment error count, update detail only
-					node.stats.inc_detail_only (rai::stat::type::error, rai::stat::detail::insufficient_work);
-				}
-				else if (parser.status == rai::message_parser::parse_status::invalid_message_type)
+void rai::network::process_batch (rai::datagram_batch & batch_a, int count_a, unsigned socket_index_a)
+{
+	if (count_a > 0)
+	{
+		// Detail level only, the traffic type counter is in bytes
+		node.stats.add (rai::stat::type::traffic, rai::stat::detail::batch, rai::stat::dir::in, 1, true);
+		node.stats.add (rai::stat::type::traffic, rai::stat::detail::batch_size, rai::stat::dir::in, count_a, true);
+		for (auto i (0); i < count_a; ++i)
+		{
+			process_packet (batch_a.buffers[i].data (), batch_a.sizes[i], batch_a.remotes[i], socket_index_a);
+		}
+	}
+	else if (count_a < 0 && errno != EAGAIN && errno != EWOULDBLOCK && node.config.logging.network_logging ())
+	{
+		BOOST_LOG (node.log) << boost::str (boost::format ("recvmmsg error: %1%") % strerror (errno));
+	}
+}
+
+void rai::network::process_packet (uint8_t const * data_a, size_t size_a, rai::endpoint const & sender_a, unsigned socket_index_a)
+{
+	if (!receive_sockets.empty ())
+	{
+		node.stats.inc (rai::stat::type::receive_socket, static_cast<rai::stat::detail> (static_cast<uint8_t> (rai::stat::detail::socket_0) + socket_index_a));
+	}
+	if (!rai::reserved_address (sender_a, false) && sender_a != endpoint ())
+	{
+		network_message_visitor visitor (node, sender_a);
+		rai::message_parser parser (visitor, node.work);
+		parser.deserialize_buffer (data_a, size_a);
+		if (parser.status != rai::message_parser::parse_status::success)
+		{
+			node.stats.inc (rai::stat::type::error);
+
+			if (parser.status == rai::message_parser::parse_status::insufficient_work)
+			{
+				if (node.config.logging.insufficient_work_logging ())
 				{
-					if (node.config.logging.network_logging ())
-					{
-						BOOST_LOG (node.log) << "Invalid message type in message";
-					}
+					BOOST_LOG (node.log) << "Insufficient work in message"; // << (int)buffer.data()[5];
 				}
-				else if (parser.status == rai::message_parser::parse_status::invalid_header)
+
+				// We've already increment error count, update detail only
+				node.stats.inc_detail_only (rai::stat::type::error, rai::stat::detail::insufficient_work);
+			}
+			else if (parser.status == rai::message_parser::parse_status::invalid_message_type)
+			{
+				if (node.config.logging.network_logging ())
 				{
-					if (node.config.logging.network_logging ())
-					{
-						BOOST_LOG (node.log) << "Invalid header in message";
-					}
+					BOOST_LOG (node.log) << "Invalid message type in message";
 				}
-				else if (parser.status == rai::message_parser::parse_status::invalid_keepalive_message)
+			}
+			else if (parser.status == rai::message_parser::parse_status::invalid_header)
+			{
+				if (node.config.logging.network_logging ())
 				{
-					if (node.config.logging.network_logging ())
-					{
-						BOOST_LOG (node.log) << "Invalid keepalive message";
-					}
+					BOOST_LOG (node.log) << "Invalid header in message";
 				}
-				else if (parser.status == rai::message_parser::parse_status::invalid_publish_message)
+			}
+			else if (parser.status == rai::message_parser::parse_status::invalid_keepalive_message)
+			{
+				if (node.config.logging.network_logging ())
 				{
-					if (node.config.logging.network_logging ())
-					{
-						BOOST_LOG (node.log) << "Invalid publish message";
-					}
+					BOOST_LOG (node.log) << "Invalid keepalive message";
 				}
-				else if (parser.status == rai::message_parser::parse_status::invalid_confirm_req_message)
+			}
+			else if (parser.status == rai::message_parser::parse_status::invalid_publish_message)
+			{
+				if (node.config.logging.network_logging ())
 				{
-					if (node.config.logging.network_logging ())
-					{
-						BOOST_LOG (node.log) << "Invalid confirm_req message";
-					}
+					BOOST_LOG (node.log) << "Invalid publish message";
 				}
-				else if (parser.status == rai::message_parser::parse_status::invalid_confirm_ack_message)
+			}
+			else if (parser.status == rai::message_parser::parse_status::invalid_confirm_req_message)
+			{
+				if (node.config.logging.network_logging ())
 				{
-					if (node.config.logging.network_logging ())
-					{
-						BOOST_LOG (node.log) << "Invalid confirm_ack message";
-					}
+					BOOST_LOG (node.log) << "Invalid confirm_req message";
 				}
-				else if (parser.status == rai::message_parser::parse_status::invalid_node_id_handshake_message)
+			}
+			else if (parser.status == rai::message_parser::parse_status::invalid_confirm_ack_message)
+			{
+				if (node.config.logging.network_logging ())
 				{
-					if (node.config.logging.network_logging ())
-					{
-						BOOST_LOG (node.log) << "Invalid node_id_handshake message";
-					}
+					BOOST_LOG (node.log) << "Invalid confirm_ack message";
 				}
-				else if (parser.status == rai::message_parser::parse_status::outdated_version)
+			}
+			else if (parser.status == rai::message_parser::parse_status::invalid_node_id_handshake_message)
+			{
+				if (node.config.logging.network_logging ())
 				{
-					if (node.config.logging.network_logging())
-					{
-						BOOST_LOG(node.log) << boost::str (boost::format ("Outdated version, from %1%") % remote);
-					}
+					BOOST_LOG (node.log) << "Invalid node_id_handshake message";
 				}
-				else
+			}
+			else if (parser.status == rai::message_parser::parse_status::outdated_version)
+			{
+				if (node.config.logging.network_logging())
 				{
-					BOOST_LOG (node.log) << "Could not deserialize buffer " << (int)parser.status;
+					BOOST_LOG(node.log) << boost::str (boost::format ("Outdated version, from %1%") % sender_a);
 				}
 			}
 			else
 			{
-				node.stats.add (rai::stat::type::traffic, rai::stat::dir::in, size_a);
+				BOOST_LOG (node.log) << "Could not deserialize buffer " << (int)parser.status;
 			}
 		}
 		else
 		{
-			if (node.config.logging.network_logging ())
-			{
-				BOOST_LOG (node.log) << boost::str (boost::format ("Reserved sender %1%") % remote.address ().to_string ());
-			}
-
-			node.stats.inc_detail_only (rai::stat::type::error, rai::stat::detail::bad_sender);
+			node.stats.add (rai::stat::type::traffic, rai::stat::dir::in, size_a);
 		}
-		receive ();
 	}
 	else
 	{
-		if (error)
-		{
-			if (node.config.logging.network_logging ())
-			{
-				BOOST_LOG (node.log) << boost::str (boost::format ("UDP Receive error: %1%") % error.message ());
-			}
-		}
-		if (on)
+		if (node.config.logging.network_logging ())
 		{
-			node.alarm.add (std::chrono::steady_clock::now () + std::chrono::seconds (5), [this]() { receive (); });
+			BOOST_LOG (node.log) << boost::str (boost::format ("Reserved sender %1%") % sender_a.address ().to_string ());
 		}
+
+		node.stats.inc_detail_only (rai::stat::type::error, rai::stat::detail::bad_sender);
 	}
 }
 
@@ -919,12 +1159,24 @@ online_weight_minimum (60000 * rai::Gxrb_ratio),
 online_weight_quorum (50),
 password_fanout (1024),
 io_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
+receive_sockets (1),
+udp_batch_size (1),
+udp_flush_interval (1),
 work_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
+signature_checker_threads (std::thread::hardware_concurrency () / 2),
 enable_voting (true),
 bootstrap_connections (4),
 bootstrap_connections_max (64),
 callback_port (0),
-lmdb_max_dbs (128)
+callback_connections (4),
+callback_batch_size (1),
+callback_queue_max (16384),
+lmdb_max_dbs (128),
+account_cache_size (rai::account_cache::default_size),
+block_processor_live_weight (8),
+block_processor_local_weight (4),
+block_processor_bootstrap_weight (1),
+vote_generator_delay (50)
 {
 	switch (rai::rai_network)
 	{
@@ -958,7 +1210,7 @@ lmdb_max_dbs (128)
 
 void rai::node_config::serialize_json (boost::property_tree::ptree & tree_a) const
 {
-	tree_a.put ("version", "14");
+	tree_a.put ("version", "22");
 	tree_a.put ("peering_port", std::to_string (peering_port));
 	tree_a.put ("bootstrap_fraction_numerator", std::to_string (bootstrap_fraction_numerator));
 	tree_a.put ("receive_minimum", receive_minimum.to_string_dec ());
@@ -993,14 +1245,29 @@ void rai::node_config::serialize_json (boost::property_tree::ptree & tree_a) con
 	tree_a.put ("online_weight_quorum", std::to_string (online_weight_quorum));
 	tree_a.put ("password_fanout", std::to_string (password_fanout));
 	tree_a.put ("io_threads", std::to_string (io_threads));
+	tree_a.put ("receive_sockets", std::to_string (receive_sockets));
+	tree_a.put ("udp_batch_size", std::to_string (udp_batch_size));
+	tree_a.put ("udp_flush_interval", std::to_string (udp_flush_interval));
 	tree_a.put ("work_threads", std::to_string (work_threads));
+	tree_a.put ("signature_checker_threads", std::to_string (signature_checker_threads));
 	tree_a.put ("enable_voting", enable_voting);
 	tree_a.put ("bootstrap_connections", bootstrap_connections);
 	tree_a.put ("bootstrap_connections_max", bootstrap_connections_max);
 	tree_a.put ("callback_address", callback_address);
 	tree_a.put ("callback_port", std::to_string (callback_port));
 	tree_a.put ("callback_target", callback_target);
+	tree_a.put ("callback_connections", std::to_string (callback_connections));
+	tree_a.put ("callback_batch_size", std::to_string (callback_batch_size));
+	tree_a.put ("callback_queue_max", std::to_string (callback_queue_max));
 	tree_a.put ("lmdb_max_dbs", lmdb_max_dbs);
+	tree_a.put ("account_cache_size", std::to_string (account_cache_size));
+	tree_a.put ("block_processor_live_weight", std::to_string (block_processor_live_weight));
+	tree_a.put ("block_processor_local_weight", std::to_string (block_processor_local_weight));
+	tree_a.put ("block_processor_bootstrap_weight", std::to_string (block_processor_bootstrap_weight));
+	tree_a.put ("vote_generator_delay", std::to_string (vote_generator_delay));
+	boost::property_tree::ptree websocket_l;
+	websocket.serialize_json (websocket_l);
+	tree_a.add_child ("websocket", websocket_l);
 	tree_a.put ("generate_hash_votes_at", std::chrono::system_clock::to_time_t (generate_hash_votes_at));
 }
 
@@ -1109,6 +1376,55 @@ bool rai::node_config::upgrade_json (unsigned version, boost::property_tree::ptr
 			tree_a.put ("version", "14");
 			result = true;
 		case 14:
+			tree_a.put ("signature_checker_threads", std::to_string (signature_checker_threads));
+			tree_a.erase ("version");
+			tree_a.put ("version", "15");
+			result = true;
+		case 15:
+			tree_a.put ("receive_sockets", std::to_string (receive_sockets));
+			tree_a.erase ("version");
+			tree_a.put ("version", "16");
+			result = true;
+		case 16:
+			tree_a.put ("udp_batch_size", std::to_string (udp_batch_size));
+			tree_a.put ("udp_flush_interval", std::to_string (udp_flush_interval));
+			tree_a.erase ("version");
+			tree_a.put ("version", "17");
+			result = true;
+		case 17:
+			tree_a.put ("account_cache_size", std::to_string (account_cache_size));
+			tree_a.erase ("version");
+			tree_a.put ("version", "18");
+			result = true;
+		case 18:
+			tree_a.put ("block_processor_live_weight", std::to_string (block_processor_live_weight));
+			tree_a.put ("block_processor_local_weight", std::to_string (block_processor_local_weight));
+			tree_a.put ("block_processor_bootstrap_weight", std::to_string (block_processor_bootstrap_weight));
+			tree_a.erase ("version");
+			tree_a.put ("version", "19");
+			result = true;
+		case 19:
+			tree_a.put ("vote_generator_delay", std::to_string (vote_generator_delay));
+			tree_a.erase ("version");
+			tree_a.put ("version", "20");
+			result = true;
+		case 20:
+		{
+			boost::property_tree::ptree websocket_l;
+			websocket.serialize_json (websocket_l);
+			tree_a.add_child ("websocket", websocket_l);
+			tree_a.erase ("version");
+			tree_a.put ("version", "21");
+			result = true;
+		}
+		case 21:
+			tree_a.put ("callback_connections", std::to_string (callback_connections));
+			tree_a.put ("callback_batch_size", std::to_string (callback_batch_size));
+			tree_a.put ("callback_queue_max", std::to_string (callback_queue_max));
+			tree_a.erase ("version");
+			tree_a.put ("version", "22");
+			result = true;
+		case 22:
 			break;
 		default:
 			throw std::runtime_error ("Unknown node_config version");
@@ -1185,14 +1501,28 @@ bool rai::node_config::deserialize_json (bool & upgraded_a, boost::property_tree
 		auto online_weight_quorum_l (tree_a.get<std::string> ("online_weight_quorum"));
 		auto password_fanout_l (tree_a.get<std::string> ("password_fanout"));
 		auto io_threads_l (tree_a.get<std::string> ("io_threads"));
+		auto receive_sockets_l (tree_a.get<std::string> ("receive_sockets"));
+		auto udp_batch_size_l (tree_a.get<std::string> ("udp_batch_size"));
+		auto udp_flush_interval_l (tree_a.get<std::string> ("udp_flush_interval"));
 		auto work_threads_l (tree_a.get<std::string> ("work_threads"));
+		auto signature_checker_threads_l (tree_a.get<std::string> ("signature_checker_threads"));
 		enable_voting = tree_a.get<bool> ("enable_voting");
 		auto bootstrap_connections_l (tree_a.get<std::string> ("bootstrap_connections"));
 		auto bootstrap_connections_max_l (tree_a.get<std::string> ("bootstrap_connections_max"));
 		callback_address = tree_a.get<std::string> ("callback_address");
 		auto callback_port_l (tree_a.get<std::string> ("callback_port"));
 		callback_target = tree_a.get<std::string> ("callback_target");
+		auto callback_connections_l (tree_a.get<std::string> ("callback_connections"));
+		auto callback_batch_size_l (tree_a.get<std::string> ("callback_batch_size"));
+		auto callback_queue_max_l (tree_a.get<std::string> ("callback_queue_max"));
 		auto lmdb_max_dbs_l = tree_a.get<std::string> ("lmdb_max_dbs");
+		auto account_cache_size_l (tree_a.get<std::string> ("account_cache_size"));
+		auto block_processor_live_weight_l (tree_a.get<std::string> ("block_processor_live_weight"));
+		auto block_processor_local_weight_l (tree_a.get<std::string> ("block_processor_local_weight"));
+		auto block_processor_bootstrap_weight_l (tree_a.get<std::string> ("block_processor_bootstrap_weight"));
+		auto vote_generator_delay_l (tree_a.get<std::string> ("vote_generator_delay"));
+		auto & websocket_l (tree_a.get_child ("websocket"));
+		result |= websocket.deserialize_json (websocket_l);
 		result |= parse_port (callback_port_l, callback_port);
 		auto generate_hash_votes_at_l = tree_a.get<time_t> ("generate_hash_votes_at");
 		generate_hash_votes_at = std::chrono::system_clock::from_time_t (generate_hash_votes_at_l);
@@ -1202,10 +1532,22 @@ bool rai::node_config::deserialize_json (bool & upgraded_a, boost::property_tree
 			bootstrap_fraction_numerator = std::stoul (bootstrap_fraction_numerator_l);
 			password_fanout = std::stoul (password_fanout_l);
 			io_threads = std::stoul (io_threads_l);
+			receive_sockets = std::stoul (receive_sockets_l);
+			udp_batch_size = std::stoul (udp_batch_size_l);
+			udp_flush_interval = std::stoul (udp_flush_interval_l);
 			work_threads = std::stoul (work_threads_l);
+			signature_checker_threads = std::stoul (signature_checker_threads_l);
 			bootstrap_connections = std::stoul (bootstrap_connections_l);
 			bootstrap_connections_max = std::stoul (bootstrap_connections_max_l);
+			callback_connections = std::stoul (callback_connections_l);
+			callback_batch_size = std::stoul (callback_batch_size_l);
+			callback_queue_max = std::stoul (callback_queue_max_l);
 			lmdb_max_dbs = std::stoi (lmdb_max_dbs_l);
+			account_cache_size = std::stoul (account_cache_size_l);
+			block_processor_live_weight = std::stoul (block_processor_live_weight_l);
+			block_processor_local_weight = std::stoul (block_processor_local_weight_l);
+			block_processor_bootstrap_weight = std::stoul (block_processor_bootstrap_weight_l);
+			vote_generator_delay = std::stoul (vote_generator_delay_l);
 			online_weight_quorum = std::stoul (online_weight_quorum_l);
 			result |= peering_port > std::numeric_limits<uint16_t>::max ();
 			result |= logging.deserialize_json (upgraded_a, logging_l);
@@ -1215,6 +1557,18 @@ bool rai::node_config::deserialize_json (bool & upgraded_a, boost::property_tree
 			result |= password_fanout < 16;
 			result |= password_fanout > 1024 * 1024;
 			result |= io_threads == 0;
+			result |= receive_sockets == 0;
+			result |= receive_sockets > rai::network::receive_sockets_max;
+			result |= udp_batch_size == 0;
+			result |= udp_batch_size > 1024;
+			// A zero weight would starve its queue
+			result |= block_processor_live_weight == 0;
+			result |= block_processor_local_weight == 0;
+			result |= block_processor_bootstrap_weight == 0;
+			// Votes are held back for the whole window
+			result |= vote_generator_delay > 1000;
+			result |= callback_connections == 0;
+			result |= callback_batch_size == 0;
 		}
 		catch (std::logic_error const &)
 		{
@@ -1263,11 +1617,14 @@ void rai::vote_processor::process_loop ()
 			votes_l.swap (votes);
 			active = true;
 			lock.unlock ();
+			// Signatures are checked in parallel, votes are then applied one at a time in arrival order
+			std::vector<int> verifications;
+			verify_votes (votes_l, verifications);
 			{
 				rai::transaction transaction (node.store.environment, nullptr, false);
-				for (auto & i : votes_l)
+				for (size_t i (0), n (votes_l.size ()); i < n; ++i)
 				{
-					vote_blocking (transaction, i.first, i.second);
+					vote_blocking (transaction, votes_l[i].first, votes_l[i].second, verifications[i] == 1 ? rai::signature_verification::valid : rai::signature_verification::invalid);
 				}
 			}
 			lock.lock ();
@@ -1281,6 +1638,34 @@ void rai::vote_processor::process_loop ()
 	}
 }
 
+void rai::vote_processor::verify_votes (std::deque<std::pair<std::shared_ptr<rai::vote>, rai::endpoint>> const & votes_a, std::vector<int> & verifications_a)
+{
+	auto size (votes_a.size ());
+	std::vector<rai::uint256_union> hashes;
+	hashes.reserve (size);
+	std::vector<unsigned char const *> messages;
+	messages.reserve (size);
+	std::vector<size_t> lengths (size, sizeof (rai::uint256_union));
+	std::vector<unsigned char const *> pub_keys;
+	pub_keys.reserve (size);
+	std::vector<unsigned char const *> signatures;
+	signatures.reserve (size);
+	verifications_a.assign (size, 0);
+	for (auto & vote : votes_a)
+	{
+		hashes.push_back (vote.first->hash ());
+		messages.push_back (hashes.back ().bytes.data ());
+		pub_keys.push_back (vote.first->account.bytes.data ());
+		signatures.push_back (vote.first->signature.bytes.data ());
+	}
+	rai::signature_check_set check = { size, messages.data (), lengths.data (), pub_keys.data (), signatures.data (), verifications_a.data () };
+	node.signature_checker.verify (check);
+	// Detail level only, the vote type counter keeps counting processed votes
+	node.stats.add (rai::stat::type::vote, rai::stat::detail::batch, rai::stat::dir::in, 1, true);
+	node.stats.add (rai::stat::type::vote, rai::stat::detail::batch_size, rai::stat::dir::in, size, true);
+	node.stats.add (rai::stat::type::vote, rai::stat::detail::batch_rejected, rai::stat::dir::in, std::count (verifications_a.begin (), verifications_a.end (), 0), true);
+}
+
 void rai::vote_processor::vote (std::shared_ptr<rai::vote> vote_a, rai::endpoint endpoint_a)
 {
 	assert (endpoint_a.address ().is_v6 ());
@@ -1292,11 +1677,12 @@ void rai::vote_processor::vote (std::shared_ptr<rai::vote> vote_a, rai::endpoint
 	}
 }
 
-rai::vote_code rai::vote_processor::vote_blocking (MDB_txn * transaction_a, std::shared_ptr<rai::vote> vote_a, rai::endpoint endpoint_a)
+rai::vote_code rai::vote_processor::vote_blocking (MDB_txn * transaction_a, std::shared_ptr<rai::vote> vote_a, rai::endpoint endpoint_a, rai::signature_verification verification_a)
 {
 	assert (endpoint_a.address ().is_v6 ());
 	auto result (rai::vote_code::invalid);
-	if (!vote_a->validate ())
+	auto valid (verification_a == rai::signature_verification::valid || (verification_a == rai::signature_verification::unknown && !vote_a->validate ()));
+	if (valid)
 	{
 		result = rai::vote_code::replay;
 		auto max_vote (node.store.vote_max (transaction_a, vote_a));
@@ -1371,6 +1757,157 @@ void rai::vote_processor::flush ()
 	}
 }
 
+rai::vote_generator::vote_generator (rai::node & node_a, std::chrono::milliseconds wait_a) :
+node (node_a),
+wait (wait_a),
+started (false),
+stopped (false),
+thread ([this]() { run (); })
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!started)
+	{
+		condition.wait (lock);
+	}
+}
+
+void rai::vote_generator::add (rai::block_hash const & hash_a, rai::endpoint const & endpoint_a)
+{
+	add (hash_a, boost::optional<rai::endpoint> (endpoint_a));
+}
+
+void rai::vote_generator::add (rai::block_hash const & hash_a)
+{
+	add (hash_a, boost::none);
+}
+
+void rai::vote_generator::add (rai::block_hash const & hash_a, boost::optional<rai::endpoint> const & endpoint_a)
+{
+	node.stats.inc (rai::stat::type::vote_generator, endpoint_a ? rai::stat::detail::confirm_req : rai::stat::detail::local);
+	std::lock_guard<std::mutex> lock (mutex);
+	auto existing (requests.find (hash_a));
+	if (existing == requests.end ())
+	{
+		if (hashes.size () < max_queue)
+		{
+			existing = requests.insert (std::make_pair (hash_a, rai::vote_generator::request{ {}, false })).first;
+			hashes.push_back (hash_a);
+			// Wake the generator to open a window, or to sign straight away once a vote is full
+			if (hashes.size () == 1 || hashes.size () == max_hashes)
+			{
+				condition.notify_all ();
+			}
+		}
+		else
+		{
+			node.stats.inc (rai::stat::type::vote_generator, rai::stat::detail::overflow);
+		}
+	}
+	if (existing != requests.end ())
+	{
+		auto & request (existing->second);
+		if (endpoint_a)
+		{
+			if (std::find (request.endpoints.begin (), request.endpoints.end (), *endpoint_a) == request.endpoints.end ())
+			{
+				request.endpoints.push_back (*endpoint_a);
+			}
+		}
+		else
+		{
+			request.local = true;
+		}
+	}
+}
+
+void rai::vote_generator::stop ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		stopped = true;
+		condition.notify_all ();
+	}
+	if (thread.joinable ())
+	{
+		thread.join ();
+	}
+}
+
+void rai::vote_generator::run ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	started = true;
+	condition.notify_all ();
+	while (!stopped)
+	{
+		if (!hashes.empty ())
+		{
+			// Give more hashes a chance to arrive unless a full vote is ready
+			auto cutoff (std::chrono::steady_clock::now () + wait);
+			while (!stopped && hashes.size () < max_hashes && std::chrono::steady_clock::now () < cutoff)
+			{
+				condition.wait_until (lock, cutoff);
+			}
+			if (!stopped)
+			{
+				send (lock);
+			}
+		}
+		else
+		{
+			condition.wait (lock);
+		}
+	}
+}
+
+void rai::vote_generator::send (std::unique_lock<std::mutex> & lock_a)
+{
+	std::vector<rai::block_hash> hashes_l;
+	std::unordered_set<rai::endpoint> endpoints_l;
+	auto local_l (false);
+	hashes_l.reserve (max_hashes);
+	while (!hashes.empty () && hashes_l.size () < max_hashes)
+	{
+		auto hash (hashes.front ());
+		hashes.pop_front ();
+		auto existing (requests.find (hash));
+		assert (existing != requests.end ());
+		endpoints_l.insert (existing->second.endpoints.begin (), existing->second.endpoints.end ());
+		local_l = local_l || existing->second.local;
+		requests.erase (existing);
+		hashes_l.push_back (hash);
+	}
+	lock_a.unlock ();
+	node.stats.inc (rai::stat::type::vote_generator, rai::stat::detail::batch);
+	node.stats.add (rai::stat::type::vote_generator, rai::stat::detail::batch_size, rai::stat::dir::in, hashes_l.size ());
+	{
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		node.wallets.foreach_representative (transaction, [this, &transaction, &hashes_l, &endpoints_l, local_l](rai::public_key const & pub_a, rai::raw_key const & prv_a) {
+			auto vote (node.store.vote_generate (transaction, pub_a, prv_a, hashes_l));
+			node.stats.inc (rai::stat::type::vote_generator, rai::stat::detail::vote_signed);
+			if (!endpoints_l.empty ())
+			{
+				rai::confirm_ack confirm (vote);
+				std::shared_ptr<std::vector<uint8_t>> bytes (new std::vector<uint8_t>);
+				{
+					rai::vectorstream stream (*bytes);
+					confirm.serialize (stream);
+				}
+				for (auto & endpoint : endpoints_l)
+				{
+					node.network.confirm_send (confirm, bytes, endpoint);
+				}
+				node.stats.add (rai::stat::type::vote_generator, rai::stat::detail::bytes_sent, rai::stat::dir::out, bytes->size () * endpoints_l.size ());
+			}
+			if (local_l)
+			{
+				node.vote_processor.vote (vote, node.network.endpoint ());
+			}
+		});
+	}
+	lock_a.lock ();
+}
+
 void rai::rep_crawler::add (rai::block_hash const & hash_a)
 {
 	std::lock_guard<std::mutex> lock (mutex);
@@ -1389,9 +1926,145 @@ bool rai::rep_crawler::exists (rai::block_hash const & hash_a)
 	return active.count (hash_a) != 0;
 }
 
+rai::signature_checker::signature_checker (unsigned threads_a) :
+stopped (false)
+{
+	for (auto i (0u); i < threads_a; ++i)
+	{
+		threads.push_back (std::thread ([this]() { run (); }));
+	}
+}
+
+rai::signature_checker::~signature_checker ()
+{
+	stop ();
+}
+
+void rai::signature_checker::stop ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		stopped = true;
+		condition.notify_all ();
+	}
+	for (auto & thread : threads)
+	{
+		if (thread.joinable ())
+		{
+			thread.join ();
+		}
+	}
+}
+
+void rai::signature_checker::run ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	// Pending tasks are drained before exiting so callers waiting in verify are released
+	while (!stopped || !tasks.empty ())
+	{
+		if (!tasks.empty ())
+		{
+			auto task (tasks.front ());
+			tasks.pop_front ();
+			lock.unlock ();
+			task ();
+			lock.lock ();
+		}
+		else
+		{
+			condition.wait (lock);
+		}
+	}
+}
+
+void rai::signature_checker::verify_batch (rai::signature_check_set & check_a, size_t start_a, size_t size_a)
+{
+	rai::validate_message_batch (check_a.messages + start_a, check_a.message_lengths + start_a, check_a.pub_keys + start_a, check_a.signatures + start_a, size_a, check_a.verifications + start_a);
+}
+
+void rai::signature_checker::verify (rai::signature_check_set & check_a)
+{
+	execute (check_a.size, batch_size, [this, &check_a](size_t start_a, size_t size_a) {
+		verify_batch (check_a, start_a, size_a);
+	});
+}
+
+bool rai::signature_checker::parallel ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return !stopped && !threads.empty ();
+}
+
+void rai::signature_checker::execute (size_t size_a, size_t chunk_a, std::function<void(size_t, size_t)> const & action_a)
+{
+	std::mutex pending_mutex;
+	std::condition_variable pending_condition;
+	size_t pending (0);
+	// Workers decrement pending as soon as mutex is released, branch on what was queued instead
+	size_t queued (0);
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		if (!stopped && !threads.empty ())
+		{
+			// The first chunk is left for the calling thread
+			for (size_t start (chunk_a); start < size_a; start += chunk_a)
+			{
+				auto size (std::min (chunk_a, size_a - start));
+				++queued;
+				++pending;
+				tasks.push_back ([&action_a, start, size, &pending, &pending_mutex, &pending_condition]() {
+					action_a (start, size);
+					std::lock_guard<std::mutex> lock (pending_mutex);
+					--pending;
+					pending_condition.notify_all ();
+				});
+			}
+			condition.notify_all ();
+		}
+	}
+	if (queued == 0)
+	{
+		action_a (0, size_a);
+	}
+	else
+	{
+		action_a (0, chunk_a);
+		std::unique_lock<std::mutex> lock (pending_mutex);
+		while (pending != 0)
+		{
+			pending_condition.wait (lock);
+		}
+	}
+}
+
+namespace
+{
+rai::stat::detail block_queue_detail (rai::block_queue queue_a)
+{
+	rai::stat::detail result;
+	switch (queue_a)
+	{
+		case rai::block_queue::live:
+			result = rai::stat::detail::live;
+			break;
+		case rai::block_queue::forced:
+			result = rai::stat::detail::forced;
+			break;
+		case rai::block_queue::local:
+			result = rai::stat::detail::local;
+			break;
+		case rai::block_queue::bootstrap:
+			result = rai::stat::detail::bootstrap;
+			break;
+	}
+	return result;
+}
+}
+
 rai::block_processor::block_processor (rai::node & node_a) :
 stopped (false),
 active (false),
+weights ({ { node_a.config.block_processor_live_weight, 0, node_a.config.block_processor_local_weight, node_a.config.block_processor_bootstrap_weight } }),
 node (node_a),
 next_log (std::chrono::steady_clock::now ())
 {
@@ -1412,28 +2085,53 @@ void rai::block_processor::stop ()
 void rai::block_processor::flush ()
 {
 	std::unique_lock<std::mutex> lock (mutex);
-	while (!stopped && (!blocks.empty () || active))
+	while (!stopped && (have_blocks () || active))
 	{
 		condition.wait (lock);
 	}
 }
 
-bool rai::block_processor::full ()
+bool rai::block_processor::full ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	size_t size (verified_blocks.size ());
+	for (auto & queue : blocks)
+	{
+		size += queue.size ();
+	}
+	return size > 16384;
+}
+
+bool rai::block_processor::full (rai::block_queue queue_a)
+{
+	return size (queue_a) > queue_max;
+}
+
+size_t rai::block_processor::size (rai::block_queue queue_a)
 {
-	std::unique_lock<std::mutex> lock (mutex);
-	return blocks.size () > 16384;
+	std::lock_guard<std::mutex> lock (mutex);
+	return blocks[static_cast<size_t> (queue_a)].size ();
 }
 
 void rai::block_processor::add (std::shared_ptr<rai::block> block_a, std::chrono::steady_clock::time_point origination)
+{
+	add (block_a, origination, node.block_arrival.recent (block_a->hash ()) ? rai::block_queue::live : rai::block_queue::bootstrap);
+}
+
+void rai::block_processor::add (std::shared_ptr<rai::block> block_a, std::chrono::steady_clock::time_point origination, rai::block_queue queue_a)
 {
 	auto hash_l (block_a->hash ());
 	if (!rai::work_validate (block_a->root (), block_a->work_get ()))
 	{
 		std::lock_guard<std::mutex> lock (mutex);
-		if (blocks_hashes.find (hash_l) == blocks_hashes.end ())
+		if (queue_a == rai::block_queue::forced || blocks_hashes.find (hash_l) == blocks_hashes.end ())
 		{
-			blocks.push_back (std::make_pair (block_a, origination));
-			blocks_hashes.insert (hash_l);
+			blocks[static_cast<size_t> (queue_a)].push_back ({ block_a, origination, std::chrono::steady_clock::now (), queue_a });
+			if (queue_a != rai::block_queue::forced)
+			{
+				blocks_hashes.insert (hash_l);
+			}
+			node.stats.inc (rai::stat::type::block_processor, block_queue_detail (queue_a), rai::stat::dir::in);
 			condition.notify_all ();
 		}
 	}
@@ -1447,7 +2145,8 @@ void rai::block_processor::add (std::shared_ptr<rai::block> block_a, std::chrono
 void rai::block_processor::force (std::shared_ptr<rai::block> block_a)
 {
 	std::lock_guard<std::mutex> lock (mutex);
-	forced.push_back (block_a);
+	blocks[static_cast<size_t> (rai::block_queue::forced)].push_back ({ block_a, std::chrono::steady_clock::now (), std::chrono::steady_clock::now (), rai::block_queue::forced });
+	node.stats.inc (rai::stat::type::block_processor, rai::stat::detail::forced, rai::stat::dir::in);
 	condition.notify_all ();
 }
 
@@ -1459,9 +2158,18 @@ void rai::block_processor::process_blocks ()
 		if (have_blocks ())
 		{
 			active = true;
-			lock.unlock ();
-			process_receive_many (lock);
-			lock.lock ();
+			auto & forced (blocks[static_cast<size_t> (rai::block_queue::forced)]);
+			// Forced blocks don't wait for a verification batch, the ledger checks their signature
+			if (forced.empty ())
+			{
+				verify_blocks (lock);
+			}
+			if (!verified_blocks.empty () || !forced.empty ())
+			{
+				lock.unlock ();
+				process_receive_many (lock);
+				lock.lock ();
+			}
 			active = false;
 		}
 		else
@@ -1487,41 +2195,180 @@ bool rai::block_processor::should_log ()
 bool rai::block_processor::have_blocks ()
 {
 	assert (!mutex.try_lock ());
-	return !blocks.empty () || !forced.empty ();
+	auto result (!verified_blocks.empty ());
+	for (auto i (blocks.begin ()), n (blocks.end ()); i != n && !result; ++i)
+	{
+		result = !i->empty ();
+	}
+	return result;
+}
+
+std::deque<rai::block_processor_item> rai::block_processor::next_batch ()
+{
+	assert (!mutex.try_lock ());
+	std::deque<rai::block_processor_item> result;
+	auto remaining (true);
+	while (remaining && result.size () < verification_batch_max)
+	{
+		remaining = false;
+		for (size_t i (0); i < queue_count && result.size () < verification_batch_max; ++i)
+		{
+			if (i == static_cast<size_t> (rai::block_queue::forced))
+			{
+				continue;
+			}
+			auto & queue (blocks[i]);
+			auto count (std::min<size_t> ({ weights[i], queue.size (), verification_batch_max - result.size () }));
+			result.insert (result.end (), queue.begin (), queue.begin () + count);
+			queue.erase (queue.begin (), queue.begin () + count);
+			remaining = remaining || !queue.empty ();
+		}
+	}
+	return result;
+}
+
+void rai::block_processor::verify_blocks (std::unique_lock<std::mutex> & lock_a)
+{
+	assert (!mutex.try_lock ());
+	auto items (next_batch ());
+	auto size (items.size ());
+	if (size == 0)
+	{
+		return;
+	}
+	lock_a.unlock ();
+	std::vector<rai::block_hash> hashes;
+	hashes.reserve (size);
+	std::vector<rai::account> accounts;
+	accounts.reserve (size);
+	std::vector<unsigned char const *> messages;
+	messages.reserve (size);
+	std::vector<size_t> lengths (size, sizeof (rai::block_hash));
+	std::vector<unsigned char const *> pub_keys;
+	pub_keys.reserve (size);
+	std::vector<unsigned char const *> signatures;
+	signatures.reserve (size);
+	std::vector<int> verifications (size, 0);
+	for (auto & item : items)
+	{
+		hashes.push_back (item.block->hash ());
+		accounts.push_back (item.block->account ());
+		messages.push_back (hashes.back ().bytes.data ());
+		pub_keys.push_back (accounts.back ().bytes.data ());
+		signatures.push_back (item.block->signature_get ().bytes.data ());
+	}
+	rai::signature_check_set check = { size, messages.data (), lengths.data (), pub_keys.data (), signatures.data (), verifications.data () };
+	node.signature_checker.verify (check);
+	auto rejected (std::count (verifications.begin (), verifications.end (), 0));
+	node.stats.inc (rai::stat::type::signature, rai::stat::detail::batch);
+	node.stats.add (rai::stat::type::signature, rai::stat::detail::batch_size, rai::stat::dir::in, size);
+	node.stats.add (rai::stat::type::signature, rai::stat::detail::batch_rejected, rai::stat::dir::in, rejected);
+	lock_a.lock ();
+	for (size_t i (0); i < size; ++i)
+	{
+		if (verifications[i] == 1)
+		{
+			verified_blocks.push_back (items[i]);
+		}
+		else
+		{
+			blocks_hashes.erase (hashes[i]);
+			if (node.config.logging.ledger_logging ())
+			{
+				BOOST_LOG (node.log) << boost::str (boost::format ("Bad signature for: %1%") % hashes[i].to_string ());
+			}
+		}
+	}
+}
+
+void rai::block_processor::prefetch (std::vector<std::shared_ptr<rai::block>> const & blocks_a)
+{
+	node.signature_checker.execute (blocks_a.size (), rai::signature_checker::batch_size, [this, &blocks_a](size_t start_a, size_t size_a) {
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		for (auto i (start_a), n (start_a + size_a); i != n; ++i)
+		{
+			prefetch_one (transaction, *blocks_a[i]);
+		}
+	});
+}
+
+void rai::block_processor::prefetch_one (MDB_txn * transaction_a, rai::block const & block_a)
+{
+	// Touch what ledger_processor reads for this block, the results are not used
+	auto & store (node.store);
+	if (!store.block_exists (transaction_a, block_a.hash ()))
+	{
+		rai::account_info info;
+		store.account_get (transaction_a, block_a.account (), info);
+		auto state (dynamic_cast<rai::state_block const *> (&block_a));
+		if (state != nullptr && !state->link ().is_zero ())
+		{
+			rai::block_sideband previous;
+			auto receive (block_a.previous ().is_zero () || (!store.block_sideband_get (transaction_a, block_a.previous (), previous) && block_a.balance () > previous.balance));
+			if (receive)
+			{
+				store.block_exists (transaction_a, state->link ());
+				store.pending_exists (transaction_a, rai::pending_key (block_a.account (), state->link ()));
+			}
+		}
+	}
 }
 
 void rai::block_processor::process_receive_many (std::unique_lock<std::mutex> & lock_a)
 {
+	std::vector<std::shared_ptr<rai::block>> batch;
+	{
+		lock_a.lock ();
+		if (verified_blocks.size () >= prefetch_min)
+		{
+			auto size (std::min (verified_blocks.size (), process_batch_max));
+			batch.reserve (size);
+			for (auto i (verified_blocks.begin ()), n (verified_blocks.begin () + size); i != n; ++i)
+			{
+				batch.push_back (i->block);
+			}
+		}
+		lock_a.unlock ();
+	}
+	if (!batch.empty () && node.signature_checker.parallel ())
+	{
+		// Stage 1, read only and parallel.  Stage 2 below still runs the full ledger checks, anything could have changed in between.
+		prefetch (batch);
+	}
 	{
 		rai::transaction transaction (node.store.environment, nullptr, true);
 		auto cutoff (std::chrono::steady_clock::now () + rai::transaction_timeout);
 		lock_a.lock ();
-		auto count (0);
-		while (have_blocks () && count < 16384)
+		auto & forced (blocks[static_cast<size_t> (rai::block_queue::forced)]);
+		size_t count (0);
+		while ((!forced.empty () || !verified_blocks.empty ()) && count < process_batch_max)
 		{
-			if (blocks.size () > 64 && should_log ())
+			if (verified_blocks.size () > 64 && should_log ())
 			{
-				BOOST_LOG (node.log) << boost::str (boost::format ("%1% blocks in processing queue") % blocks.size ());
+				BOOST_LOG (node.log) << boost::str (boost::format ("%1% blocks in processing queue, %2% live, %3% bootstrap") % verified_blocks.size () % blocks[static_cast<size_t> (rai::block_queue::live)].size () % blocks[static_cast<size_t> (rai::block_queue::bootstrap)].size ());
 			}
-			std::pair<std::shared_ptr<rai::block>, std::chrono::steady_clock::time_point> block;
-			bool force (false);
-			if (forced.empty ())
+			rai::block_processor_item item;
+			auto force (!forced.empty ());
+			// Checked before every block so forced blocks never wait behind a verified batch
+			if (force)
 			{
-				block = blocks.front ();
-				blocks.pop_front ();
-				blocks_hashes.erase (block.first->hash ());
+				item = forced.front ();
+				forced.pop_front ();
 			}
 			else
 			{
-				block = std::make_pair (forced.front (), std::chrono::steady_clock::now ());
-				forced.pop_front ();
-				force = true;
+				item = verified_blocks.front ();
+				verified_blocks.pop_front ();
+				blocks_hashes.erase (item.block->hash ());
 			}
 			lock_a.unlock ();
-			auto hash (block.first->hash ());
+			auto detail (block_queue_detail (item.queue));
+			node.stats.inc (rai::stat::type::block_processor, detail, rai::stat::dir::out);
+			node.stats.add (rai::stat::type::block_processor_latency, detail, rai::stat::dir::in, std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - item.arrival).count ());
+			auto hash (item.block->hash ());
 			if (force)
 			{
-				auto successor (node.ledger.successor (transaction, block.first->root ()));
+				auto successor (node.ledger.successor (transaction, item.block->root ()));
 				if (successor != nullptr && successor->hash () != hash)
 				{
 					// Replace our block with the winner and roll back any dependent blocks
@@ -1529,7 +2376,7 @@ void rai::block_processor::process_receive_many (std::unique_lock<std::mutex> &
 					node.ledger.rollback (transaction, successor->hash ());
 				}
 			}
-			auto process_result (process_receive_one (transaction, block.first, block.second));
+			auto process_result (process_receive_one (transaction, item.block, item.origination, force ? rai::signature_verification::unknown : rai::signature_verification::valid));
 			(void)process_result;
 			lock_a.lock ();
 			++count;
@@ -1538,11 +2385,11 @@ void rai::block_processor::process_receive_many (std::unique_lock<std::mutex> &
 	lock_a.unlock ();
 }
 
-rai::process_return rai::block_processor::process_receive_one (MDB_txn * transaction_a, std::shared_ptr<rai::block> block_a, std::chrono::steady_clock::time_point origination)
+rai::process_return rai::block_processor::process_receive_one (MDB_txn * transaction_a, std::shared_ptr<rai::block> block_a, std::chrono::steady_clock::time_point origination, rai::signature_verification verification_a)
 {
 	rai::process_return result;
 	auto hash (block_a->hash ());
-	result = node.ledger.process (transaction_a, *block_a);
+	result = node.ledger.process (transaction_a, *block_a, verification_a);
 	switch (result.code)
 	{
 		case rai::process_result::progress:
@@ -1557,6 +2404,7 @@ rai::process_return rai::block_processor::process_receive_one (MDB_txn * transac
 			{
 				node.active.start (block_a);
 			}
+			node.wallets.reps_update (transaction_a, block_a->representative ());
 			queue_unchecked (transaction_a, hash);
 			break;
 		}
@@ -1686,10 +2534,13 @@ rai::process_return rai::block_processor::process_receive_one (MDB_txn * transac
 void rai::block_processor::queue_unchecked (MDB_txn * transaction_a, rai::block_hash const & hash_a)
 {
 	auto cached (node.store.unchecked_get (transaction_a, hash_a));
-	for (auto i (cached.begin ()), n (cached.end ()); i != n; ++i)
+	if (!cached.empty ())
 	{
-		node.store.unchecked_del (transaction_a, hash_a, **i);
-		add (*i, std::chrono::steady_clock::time_point ());
+		node.store.unchecked_del (transaction_a, hash_a);
+		for (auto & block : cached)
+		{
+			add (block, std::chrono::steady_clock::time_point ());
+		}
 	}
 	std::lock_guard<std::mutex> lock (node.gap_cache.mutex);
 	node.gap_cache.blocks.get<1> ().erase (hash_a);
@@ -1705,7 +2556,7 @@ service (service_a),
 config (config_a),
 alarm (alarm_a),
 work (work_a),
-store (init_a.block_store_init, application_path_a / "data.ldb", config_a.lmdb_max_dbs),
+store (init_a.block_store_init, application_path_a / "data.ldb", config_a.lmdb_max_dbs, config_a.account_cache_size),
 gap_cache (*this),
 ledger (store, stats),
 active (*this),
@@ -1716,13 +2567,16 @@ peers (network.endpoint ()),
 application_path (application_path_a),
 wallets (init_a.block_store_init, *this),
 port_mapping (*this),
+signature_checker (config.signature_checker_threads),
 vote_processor (*this),
+vote_generator (*this, std::chrono::milliseconds (config.vote_generator_delay)),
 warmed_up (0),
 block_processor (*this),
 block_processor_thread ([this]() { this->block_processor.process_blocks (); }),
 online_reps (*this),
 stats (config.stat_config)
 {
+	store.account_cache.stats = &stats;
 	{
 		rai::transaction transaction (store.environment, nullptr, false);
 		auto block_counts (store.block_count (transaction));
@@ -1737,13 +2591,14 @@ stats (config.stat_config)
 	peers.disconnect_observer = [this]() {
 		observers.disconnect.notify ();
 	};
-	observers.blocks.add ([this](std::shared_ptr<rai::block> block_a, rai::account const & account_a, rai::amount const & amount_a, bool is_state_send_a) {
-		if (this->block_arrival.recent (block_a->hash ()))
-		{
-			auto node_l (shared_from_this ());
-			background ([node_l, block_a, account_a, amount_a, is_state_send_a]() {
-				if (!node_l->config.callback_address.empty ())
-				{
+	if (!config.callback_address.empty ())
+	{
+		callback = std::make_shared<rai::callback_dispatcher> (*this, application_path_a / "callback_queue");
+		observers.blocks.add ([this](std::shared_ptr<rai::block> block_a, rai::account const & account_a, rai::amount const & amount_a, bool is_state_send_a) {
+			if (this->block_arrival.recent (block_a->hash ()))
+			{
+				auto node_l (shared_from_this ());
+				background ([node_l, block_a, account_a, amount_a, is_state_send_a]() {
 					boost::property_tree::ptree event;
 					event.add ("account", account_a.to_account ());
 					event.add ("hash", block_a->hash ().to_string ());
@@ -1755,92 +2610,29 @@ stats (config.stat_config)
 					{
 						event.add ("is_send", is_state_send_a);
 					}
+					// Compact so each event is a single line in the retry queue
 					std::stringstream ostream;
-					boost::property_tree::write_json (ostream, event);
-					ostream.flush ();
-					auto body (std::make_shared<std::string> (ostream.str ()));
-					auto address (node_l->config.callback_address);
-					auto port (node_l->config.callback_port);
-					auto target (std::make_shared<std::string> (node_l->config.callback_target));
-					auto resolver (std::make_shared<boost::asio::ip::tcp::resolver> (node_l->service));
-					resolver->async_resolve (boost::asio::ip::tcp::resolver::query (address, std::to_string (port)), [node_l, address, port, target, body, resolver](boost::system::error_code const & ec, boost::asio::ip::tcp::resolver::iterator i_a) {
-						if (!ec)
-						{
-							for (auto i (i_a), n (boost::asio::ip::tcp::resolver::iterator{}); i != n; ++i)
-							{
-								auto sock (std::make_shared<boost::asio::ip::tcp::socket> (node_l->service));
-								sock->async_connect (i->endpoint (), [node_l, target, body, sock, address, port](boost::system::error_code const & ec) {
-									if (!ec)
-									{
-										auto req (std::make_shared<boost::beast::http::request<boost::beast::http::string_body>> ());
-										req->method (boost::beast::http::verb::post);
-										req->target (*target);
-										req->version (11);
-										req->insert (boost::beast::http::field::host, address);
-										req->insert (boost::beast::http::field::content_type, "application/json");
-										req->body () = *body;
-										//req->prepare (*req);
-										//boost::beast::http::prepare(req);
-										req->prepare_payload ();
-										boost::beast::http::async_write (*sock, *req, [node_l, sock, address, port, req](boost::system::error_code const & ec, size_t bytes_transferred) {
-											if (!ec)
-											{
-												auto sb (std::make_shared<boost::beast::flat_buffer> ());
-												auto resp (std::make_shared<boost::beast::http::response<boost::beast::http::string_body>> ());
-												boost::beast::http::async_read (*sock, *sb, *resp, [node_l, sb, resp, sock, address, port](boost::system::error_code const & ec, size_t bytes_transferred) {
-													if (!ec)
-													{
-														if (resp->result () == boost::beast::http::status::ok)
-														{
-														}
-														else
-														{
-															if (node_l->config.logging.callback_logging ())
-															{
-																BOOST_LOG (node_l->log) << boost::str (boost::format ("Callback to %1%:%2% failed with status: %3%") % address % port % resp->result ());
-															}
-														}
-													}
-													else
-													{
-														if (node_l->config.logging.callback_logging ())
-														{
-															BOOST_LOG (node_l->log) << boost::str (boost::format ("Unable complete callback: %1%:%2%: %3%") % address % port % ec.message ());
-														}
-													};
-												});
-											}
-											else
-											{
-												if (node_l->config.logging.callback_logging ())
-												{
-													BOOST_LOG (node_l->log) << boost::str (boost::format ("Unable to send callback: %1%:%2%: %3%") % address % port % ec.message ());
-												}
-											}
-										});
-									}
-									else
-									{
-										if (node_l->config.logging.callback_logging ())
-										{
-											BOOST_LOG (node_l->log) << boost::str (boost::format ("Unable to connect to callback address: %1%:%2%: %3%") % address % port % ec.message ());
-										}
-									}
-								});
-							}
-						}
-						else
-						{
-							if (node_l->config.logging.callback_logging ())
-							{
-								BOOST_LOG (node_l->log) << boost::str (boost::format ("Error resolving callback: %1%:%2%: %3%") % address % port % ec.message ());
-							}
-						}
-					});
-				}
-			});
-		}
-	});
+					boost::property_tree::write_json (ostream, event, false);
+					auto body (ostream.str ());
+					if (!body.empty () && body.back () == '\n')
+					{
+						body.pop_back ();
+					}
+					node_l->callback->add (body);
+				});
+			}
+		});
+	}
+	if (config.websocket.enable)
+	{
+		websocket = std::make_shared<rai::websocket_server> (*this, config.websocket);
+		observers.blocks.add ([this](std::shared_ptr<rai::block> block_a, rai::account const & account_a, rai::amount_t const & amount_a, bool is_state_send_a) {
+			websocket->confirmation (block_a, account_a, amount_a, is_state_send_a);
+		});
+		observers.vote.add ([this](std::shared_ptr<rai::vote> vote_a, rai::endpoint const &) {
+			websocket->vote (vote_a);
+		});
+	}
 	observers.endpoint.add ([this](rai::endpoint const & endpoint_a) {
 		this->network.send_keepalive (endpoint_a);
 		rep_query (*this, endpoint_a);
@@ -1906,36 +2698,34 @@ stats (config.stat_config)
 		node_id_set (store.node_id_get_or_create (transaction));
 	}
 	peers.online_weight_minimum = config.online_weight_minimum.number ();
-	if (rai::rai_network == rai::rai_networks::rai_live_network)
+	// A rep_weights.bin in the data directory takes precedence over the weights built into the executable
+	auto weights_path (application_path_a / "rep_weights.bin");
+	auto weights_error (true);
+	if (boost::filesystem::exists (weights_path))
+	{
+		weights_error = ledger.bootstrap_weights.load (weights_path);
+		if (weights_error)
+		{
+			BOOST_LOG (log) << "Could not load bootstrap rep weights from " << weights_path.string ();
+		}
+	}
+	else if (rai::rai_network == rai::rai_networks::rai_live_network)
 	{
 		extern unsigned char rai_bootstrap_weights[];
 		extern size_t rai_bootstrap_weights_size;
-		rai::bufferstream weight_stream ((const uint8_t *)rai_bootstrap_weights, rai_bootstrap_weights_size);
-		rai::uint128_struct block_height;
-		if (!rai::read (weight_stream, block_height))
+		weights_error = ledger.bootstrap_weights.load (static_cast<uint8_t const *> (rai_bootstrap_weights), rai_bootstrap_weights_size);
+		if (weights_error)
 		{
-			auto max_blocks = (uint64_t)block_height.number ();
-			rai::transaction transaction (store.environment, nullptr, false);
-			if (ledger.store.block_count (transaction).sum () < max_blocks)
-			{
-				ledger.bootstrap_weight_max_blocks = max_blocks;
-				while (true)
-				{
-					rai::account account;
-					if (rai::read (weight_stream, account.bytes))
-					{
-						break;
-					}
-					rai::amount weight;
-					if (rai::read (weight_stream, weight.data))
-					{
-						break;
-					}
-					boost::endian::big_to_native_inplace (weight.data);
-					BOOST_LOG (log) << "Using bootstrap rep weight: " << account.to_account () << " -> " << weight.format_balance (Mxrb_ratio, 0, true) << " XRB";
-					ledger.bootstrap_weights[account] = weight.number ();
-				}
-			}
+			BOOST_LOG (log) << "Could not load the built in bootstrap rep weights";
+		}
+	}
+	if (!weights_error)
+	{
+		rai::transaction transaction (store.environment, nullptr, false);
+		ledger.bootstrap_weights_enable (transaction);
+		if (ledger.bootstrap_weights_active)
+		{
+			BOOST_LOG (log) << boost::str (boost::format ("Using %1% bootstrap rep weights until the ledger holds %2% blocks") % ledger.bootstrap_weights.size () % ledger.bootstrap_weights.max_blocks);
 		}
 	}
 }
@@ -1947,6 +2737,7 @@ rai::node::~node ()
 		BOOST_LOG (log) << "Destructing node";
 	}
 	stop ();
+	store.account_cache.stats = nullptr;
 }
 
 bool rai::node::copy_with_compaction (boost::filesystem::path const & destination_file)
@@ -2108,11 +2899,11 @@ void rai::network::confirm_send (rai::confirm_ack const & confirm_a, std::shared
 	});
 }
 
-void rai::node::process_active (std::shared_ptr<rai::block> incoming)
+void rai::node::process_active (std::shared_ptr<rai::block> incoming, rai::block_queue queue_a)
 {
 	if (!block_arrival.add (incoming->hash ()))
 	{
-		block_processor.add (incoming, std::chrono::steady_clock::now ());
+		block_processor.add (incoming, std::chrono::steady_clock::now (), queue_a);
 	}
 }
 
@@ -2126,7 +2917,7 @@ rai::process_return rai::node::process (rai::block const & block_a)
 // Simulating with sqrt_broadcast_simulate shows we only need to broadcast to sqrt(total_peers) random peers in order to successfully publish to everyone with high probability
 std::deque<rai::endpoint> rai::peer_container::list_fanout ()
 {
-	auto peers (random_set (size_sqrt ()));
+	auto peers (random_set (std::ceil (std::sqrt (snapshot ()->endpoints.size ()))));
 	std::deque<rai::endpoint> result;
 	for (auto i (peers.begin ()), n (peers.end ()); i != n; ++i)
 	{
@@ -2137,12 +2928,8 @@ std::deque<rai::endpoint> rai::peer_container::list_fanout ()
 
 std::deque<rai::endpoint> rai::peer_container::list ()
 {
-	std::deque<rai::endpoint> result;
-	std::lock_guard<std::mutex> lock (mutex);
-	for (auto i (peers.begin ()), j (peers.end ()); i != j; ++i)
-	{
-		result.push_back (i->endpoint);
-	}
+	auto snapshot_l (snapshot ());
+	std::deque<rai::endpoint> result (snapshot_l->endpoints.begin (), snapshot_l->endpoints.end ());
 	std::random_shuffle (result.begin (), result.end ());
 	return result;
 }
@@ -2318,17 +3105,26 @@ bool rai::parse_tcp_endpoint (std::string const & string, rai::tcp_endpoint & en
 
 void rai::node::start ()
 {
-	network.receive ();
+	network.start ();
 	ongoing_keepalive ();
 	ongoing_syn_cookie_cleanup ();
 	ongoing_bootstrap ();
 	ongoing_store_flush ();
+	ongoing_unchecked_cleanup ();
 	ongoing_rep_crawl ();
 	bootstrap.start ();
 	backup_wallet ();
 	online_reps.recalculate_stake ();
 	port_mapping_start_delayed ();
 	add_initial_peers ();
+	if (websocket != nullptr)
+	{
+		websocket->start ();
+	}
+	if (callback != nullptr)
+	{
+		callback->start ();
+	}
 	observers.started.notify ();
 }
 
@@ -2340,13 +3136,23 @@ void rai::node::stop ()
 	{
 		block_processor_thread.join ();
 	}
+	signature_checker.stop ();
 	active.stop ();
 	network.stop ();
 	bootstrap_initiator.stop ();
 	bootstrap.stop ();
 	port_mapping.stop ();
+	vote_generator.stop ();
 	vote_processor.stop ();
 	wallets.stop ();
+	if (websocket != nullptr)
+	{
+		websocket->stop ();
+	}
+	if (callback != nullptr)
+	{
+		callback->stop ();
+	}
 }
 
 void rai::node::keepalive_preconfigured (std::vector<std::string> const & peers_a)
@@ -2499,6 +3305,29 @@ void rai::node::ongoing_store_flush ()
 	});
 }
 
+void rai::node::ongoing_unchecked_cleanup ()
+{
+	auto cutoff (std::chrono::duration_cast<std::chrono::seconds> ((std::chrono::system_clock::now () - unchecked_cutoff).time_since_epoch ()).count ());
+	size_t expired (0);
+	{
+		rai::transaction transaction (store.environment, nullptr, true);
+		expired = store.unchecked_expire (transaction, cutoff, unchecked_expire_batch);
+	}
+	if (expired != 0 && config.logging.ledger_logging ())
+	{
+		BOOST_LOG (log) << boost::str (boost::format ("Expired %1% unchecked blocks") % expired);
+	}
+	std::weak_ptr<rai::node> node_w (shared_from_this ());
+	// Come back sooner while a full batch was expired
+	auto delay (expired == unchecked_expire_batch ? std::chrono::seconds (1) : std::chrono::duration_cast<std::chrono::seconds> (unchecked_cleanup_interval));
+	alarm.add (std::chrono::steady_clock::now () + delay, [node_w]() {
+		if (auto node_l = node_w.lock ())
+		{
+			node_l->ongoing_unchecked_cleanup ();
+		}
+	});
+}
+
 void rai::node::port_mapping_start_delayed ()
 {
 	auto delay_sec (60);
@@ -3118,24 +3947,25 @@ std::unordered_set<rai::endpoint> rai::peer_container::random_set (size_t count_
 {
 	std::unordered_set<rai::endpoint> result;
 	result.reserve (count_a);
-	std::lock_guard<std::mutex> lock (mutex);
+	auto snapshot_l (snapshot ());
+	auto & endpoints (snapshot_l->endpoints);
 	// Stop trying to fill result with random samples after this many attempts
 	auto random_cutoff (count_a * 2);
-	auto peers_size (peers.size ());
+	auto peers_size (endpoints.size ());
 	// Usually count_a will be much smaller than peers.size()
 	// Otherwise make sure we have a cutoff on attempting to randomly fill
-	if (!peers.empty ())
+	if (!endpoints.empty ())
 	{
 		for (auto i (0); i < random_cutoff && result.size () < count_a; ++i)
 		{
 			auto index (random_pool.GenerateWord32 (0, peers_size - 1));
-			result.insert (peers.get<3> ()[index].endpoint);
+			result.insert (endpoints[index]);
 		}
 	}
-	// Fill the remainder with most recent contact
-	for (auto i (peers.get<1> ().begin ()), n (peers.get<1> ().end ()); i != n && result.size () < count_a; ++i)
+	// Fill the remainder in table order
+	for (auto i (endpoints.begin ()), n (endpoints.end ()); i != n && result.size () < count_a; ++i)
 	{
-		result.insert (i->endpoint);
+		result.insert (*i);
 	}
 	return result;
 }
@@ -3159,16 +3989,9 @@ void rai::peer_container::random_fill (std::array<rai::endpoint, 8> & target_a)
 // Request a list of the top known representatives
 std::vector<rai::peer_information> rai::peer_container::representatives (size_t count_a)
 {
-	std::vector<peer_information> result;
-	result.reserve (std::min (count_a, size_t (16)));
-	std::lock_guard<std::mutex> lock (mutex);
-	for (auto i (peers.get<6> ().begin ()), n (peers.get<6> ().end ()); i != n && result.size () < count_a; ++i)
-	{
-		if (!i->rep_weight.is_zero ())
-		{
-			result.push_back (*i);
-		}
-	}
+	auto snapshot_l (snapshot ());
+	auto & reps (snapshot_l->representatives);
+	std::vector<peer_information> result (reps.begin (), reps.begin () + std::min (count_a, reps.size ()));
 	return result;
 }
 
@@ -3221,7 +4044,12 @@ std::vector<rai::peer_information> rai::peer_container::purge_list (std::chrono:
 			}
 		}
 		// Remove peers that haven't been heard from past the cutoff
+		auto purged (pivot != peers.get<1> ().begin ());
 		peers.get<1> ().erase (peers.get<1> ().begin (), pivot);
+		if (purged)
+		{
+			publish ();
+		}
 		for (auto i (peers.begin ()), n (peers.end ()); i != n; ++i)
 		{
 			peers.modify (i, [](rai::peer_information & info) { info.last_attempt = std::chrono::steady_clock::now (); });
@@ -3267,24 +4095,38 @@ size_t rai::peer_container::size_sqrt ()
 
 rai::amount_t rai::peer_container::total_weight ()
 {
-	rai::amount_t result (0);
+	return snapshot ()->total_weight;
+}
+
+bool rai::peer_container::empty ()
+{
+	return size () == 0;
+}
+
+std::shared_ptr<rai::peer_snapshot const> rai::peer_container::snapshot () const
+{
+	return std::atomic_load (&current);
+}
+
+void rai::peer_container::publish ()
+{
+	auto result (std::make_shared<rai::peer_snapshot> ());
+	result->endpoints.reserve (peers.size ());
+	for (auto i (peers.get<3> ().begin ()), n (peers.get<3> ().end ()); i != n; ++i)
+	{
+		result->endpoints.push_back (i->endpoint);
+	}
 	std::unordered_set<rai::account> probable_reps;
-	std::lock_guard<std::mutex> lock (mutex);
-	for (auto i (peers.get<6> ().begin ()), n (peers.get<6> ().end ()); i != n; ++i)
+	for (auto i (peers.get<6> ().begin ()), n (peers.get<6> ().end ()); i != n && !i->rep_weight.is_zero (); ++i)
 	{
+		result->representatives.push_back (*i);
 		// Calculate if representative isn't recorded for several IP addresses
-		if (probable_reps.find (i->probable_rep_account) == probable_reps.end ())
+		if (probable_reps.insert (i->probable_rep_account).second)
 		{
-			result = result + i->rep_weight.number ();
-			probable_reps.insert (i->probable_rep_account);
+			result->total_weight += i->rep_weight.number ();
 		}
 	}
-	return result;
-}
-
-bool rai::peer_container::empty ()
-{
-	return size () == 0;
+	std::atomic_store (&current, std::shared_ptr<rai::peer_snapshot const> (std::move (result)));
 }
 
 bool rai::peer_container::not_a_peer (rai::endpoint const & endpoint_a, bool blacklist_loopback)
@@ -3322,6 +4164,10 @@ bool rai::peer_container::rep_response (rai::endpoint const & endpoint_a, rai::a
 				info.probable_rep_account = rep_account_a;
 			}
 		});
+		if (updated)
+		{
+			publish ();
+		}
 	}
 	return updated;
 }
@@ -3416,6 +4262,7 @@ bool rai::peer_container::insert (rai::endpoint const & endpoint_a, rai::protoco
 					rai::peer_information peer (endpoint_a, protocol_info_a);
 					peer.node_id = node_id_a;
 					peers.insert (peer);
+					publish ();
 				}
 			}
 		}
@@ -3568,11 +4415,17 @@ protocol_info ()
 {
 }
 
+rai::peer_snapshot::peer_snapshot () :
+total_weight (0)
+{
+}
+
 rai::peer_container::peer_container (rai::endpoint const & self_a) :
 self (self_a),
 peer_observer ([](rai::endpoint const &) {}),
 disconnect_observer ([]() {}),
-legacy_peers (0)
+legacy_peers (0),
+current (std::make_shared<rai::peer_snapshot> ())
 {
 }
 
@@ -3598,6 +4451,29 @@ void rai::network::send_buffer (uint8_t const * data_a, size_t size_a, rai::endp
 	{
 		BOOST_LOG (node.log) << "Sending packet";
 	}
+	if (batch_io ())
+	{
+		send_queue.push_back (rai::queued_datagram{ data_a, size_a, endpoint_a, callback_a });
+		if (send_queue.size () >= node.config.udp_batch_size)
+		{
+			std::vector<rai::queued_datagram> items;
+			items.swap (send_queue);
+			lock.unlock ();
+			send_batch (items);
+		}
+		else if (!send_flush_scheduled)
+		{
+			send_flush_scheduled = true;
+			std::weak_ptr<rai::node> node_w (node.shared ());
+			node.alarm.add (std::chrono::steady_clock::now () + std::chrono::milliseconds (node.config.udp_flush_interval), [node_w]() {
+				if (auto node_l = node_w.lock ())
+				{
+					node_l->network.flush_send_queue ();
+				}
+			});
+		}
+		return;
+	}
 	socket.async_send_to (boost::asio::buffer (data_a, size_a), endpoint_a, [this, callback_a](boost::system::error_code const & ec, size_t size_a) {
 		callback_a (ec, size_a);
 		this->node.stats.add (rai::stat::type::traffic, rai::stat::dir::out, size_a);
@@ -3608,6 +4484,96 @@ void rai::network::send_buffer (uint8_t const * data_a, size_t size_a, rai::endp
 	});
 }
 
+void rai::network::flush_send_queue ()
+{
+	std::vector<rai::queued_datagram> items;
+	{
+		std::lock_guard<std::mutex> lock (socket_mutex);
+		items.swap (send_queue);
+		send_flush_scheduled = false;
+	}
+	if (!items.empty ())
+	{
+		send_batch (items);
+	}
+}
+
+void rai::network::send_batch (std::vector<rai::queued_datagram> & items_a)
+{
+	size_t sent (0);
+#ifdef __linux__
+	std::lock_guard<std::mutex> send_lock (send_mutex);
+	// Only grows, later batches reuse the allocation
+	auto & messages (send_messages);
+	auto & iovecs (send_iovecs);
+	messages.resize (std::max (messages.size (), items_a.size ()));
+	iovecs.resize (std::max (iovecs.size (), items_a.size ()));
+	for (size_t i (0), n (items_a.size ()); i < n; ++i)
+	{
+		iovecs[i].iov_base = const_cast<uint8_t *> (items_a[i].data);
+		iovecs[i].iov_len = items_a[i].size;
+		messages[i].msg_hdr = msghdr ();
+		messages[i].msg_hdr.msg_name = items_a[i].endpoint.data ();
+		messages[i].msg_hdr.msg_namelen = items_a[i].endpoint.size ();
+		messages[i].msg_hdr.msg_iov = &iovecs[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+		messages[i].msg_len = 0;
+	}
+	// Callbacks of the datagrams handled here, run together in one background task
+	auto completed (std::make_shared<std::vector<std::tuple<std::function<void(boost::system::error_code const &, size_t)>, boost::system::error_code, size_t>>> ());
+	auto more (true);
+	while (more && sent < items_a.size ())
+	{
+		auto result (sendmmsg (socket.native_handle (), messages.data () + sent, items_a.size () - sent, MSG_DONTWAIT));
+		if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			// Drop this datagram and report the error, like a failed async_send_to would
+			completed->emplace_back (items_a[sent].callback, boost::system::error_code (errno, boost::system::system_category ()), 0);
+			++sent;
+		}
+		else if (result <= 0)
+		{
+			// Nothing sent, errno is only meaningful for -1. The rest goes through the regular asynchronous path
+			more = false;
+		}
+		else
+		{
+			// Detail level only, the traffic type counter is in bytes
+			node.stats.add (rai::stat::type::traffic, rai::stat::detail::batch, rai::stat::dir::out, 1, true);
+			node.stats.add (rai::stat::type::traffic, rai::stat::detail::batch_size, rai::stat::dir::out, result, true);
+			for (auto i (sent), n (sent + result); i < n; ++i)
+			{
+				auto size (messages[i].msg_len);
+				node.stats.add (rai::stat::type::traffic, rai::stat::dir::out, size);
+				completed->emplace_back (items_a[i].callback, boost::system::error_code (), size);
+			}
+			sent += result;
+		}
+	}
+	if (!completed->empty ())
+	{
+		node.background ([completed]() {
+			for (auto & i : *completed)
+			{
+				std::get<0> (i) (std::get<1> (i), std::get<2> (i));
+			}
+		});
+	}
+#endif
+	if (sent < items_a.size ())
+	{
+		std::lock_guard<std::mutex> lock (socket_mutex);
+		for (auto i (sent), n (items_a.size ()); i < n; ++i)
+		{
+			auto callback (items_a[i].callback);
+			socket.async_send_to (boost::asio::buffer (items_a[i].data, items_a[i].size), items_a[i].endpoint, [this, callback](boost::system::error_code const & ec, size_t size_a) {
+				callback (ec, size_a);
+				this->node.stats.add (rai::stat::type::traffic, rai::stat::dir::out, size_a);
+			});
+		}
+	}
+}
+
 bool rai::peer_container::known_peer (rai::endpoint const & endpoint_a)
 {
 	std::lock_guard<std::mutex> lock (mutex);
@@ -3640,8 +4606,9 @@ status ({ block_a, 0 }),
 confirmed (false),
 aborted (false)
 {
-	last_votes.insert (std::make_pair (rai::not_an_account, rai::vote_info{ std::chrono::steady_clock::now (), 0, block_a->hash () }));
+	last_votes.insert (std::make_pair (rai::not_an_account, rai::vote_info{ std::chrono::steady_clock::now (), 0, block_a->hash (), 0 }));
 	blocks.insert (std::make_pair (block_a->hash (), block_a));
+	last_tally[block_a->hash ()] = 0;
 }
 
 void rai::election::compute_rep_votes (MDB_txn * transaction_a)
@@ -3688,9 +4655,10 @@ bool rai::election::have_quorum (rai::tally_t const & tally_a)
 rai::tally_t rai::election::tally (MDB_txn * transaction_a)
 {
 	std::unordered_map<rai::block_hash, rai::amount_t> block_weights;
-	for (auto vote_info : last_votes)
+	for (auto & vote_info : last_votes)
 	{
-		block_weights[vote_info.second.hash] += node.ledger.weight (transaction_a, vote_info.first);
+		vote_info.second.weight = node.ledger.weight (transaction_a, vote_info.first);
+		block_weights[vote_info.second.hash] += vote_info.second.weight;
 	}
 	last_tally = block_weights;
 	rai::tally_t result;
@@ -3707,27 +4675,42 @@ rai::tally_t rai::election::tally (MDB_txn * transaction_a)
 
 void rai::election::confirm_if_quorum (MDB_txn * transaction_a)
 {
-	auto tally_l (tally (transaction_a));
-	assert (tally_l.size () > 0);
-	auto winner (tally_l.begin ());
-	auto block_l (winner->second);
-	status.tally = winner->first;
+	// Only the candidates are visited, not the voters
+	std::shared_ptr<rai::block> block_l;
+	rai::amount_t first (0);
+	rai::amount_t second (0);
 	rai::amount_t sum (0);
-	for (auto & i : tally_l)
+	for (auto & item : last_tally)
 	{
-		sum += i.first;
+		auto existing (blocks.find (item.first));
+		if (existing != blocks.end ())
+		{
+			sum += item.second;
+			if (block_l == nullptr || item.second > first)
+			{
+				second = first;
+				first = item.second;
+				block_l = existing->second;
+			}
+			else if (item.second > second)
+			{
+				second = item.second;
+			}
+		}
 	}
+	assert (block_l != nullptr);
+	status.tally = first;
 	if (sum >= node.config.online_weight_minimum.number () && !(*block_l == *status.winner))
 	{
 		auto node_l (node.shared ());
 		node_l->block_processor.force (block_l);
 		status.winner = block_l;
 	}
-	if (have_quorum (tally_l))
+	if (first > second + node.delta ())
 	{
 		if (node.config.logging.vote_logging () || blocks.size () > 1)
 		{
-			log_votes (tally_l);
+			log_votes (tally (transaction_a));
 		}
 		confirm_once (transaction_a);
 	}
@@ -3792,7 +4775,14 @@ rai::election_vote_result rai::election::vote (rai::account rep, uint64_t sequen
 		}
 		if (should_process)
 		{
-			last_votes[rep] = { std::chrono::steady_clock::now (), sequence, block_hash };
+			if (last_vote_it != last_votes.end ())
+			{
+				auto & previous (last_tally[last_vote_it->second.hash]);
+				assert (previous >= last_vote_it->second.weight);
+				previous -= std::min (previous, last_vote_it->second.weight);
+			}
+			last_tally[block_hash] += weight;
+			last_votes[rep] = { std::chrono::steady_clock::now (), sequence, block_hash, weight };
 			if (!confirmed)
 			{
 				confirm_if_quorum (transaction);
@@ -3826,7 +4816,7 @@ void rai::active_transactions::announce_votes ()
 	unsigned unconfirmed_count (0);
 	unsigned unconfirmed_announcements (0);
 	unsigned mass_request_count (0);
-	std::vector<rai::block_hash> blocks_bundle;
+	auto peers_l (node.peers.snapshot ());
 
 	for (auto i (roots.begin ()), n (roots.end ()); i != n; ++i)
 	{
@@ -3864,15 +4854,7 @@ void rai::active_transactions::announce_votes ()
 					if (node.config.enable_voting && std::chrono::system_clock::now () >= node.config.generate_hash_votes_at)
 					{
 						node.network.republish_block (transaction, election_l->status.winner, false);
-						blocks_bundle.push_back (election_l->status.winner->hash ());
-						if (blocks_bundle.size () >= 12)
-						{
-							node.wallets.foreach_representative (transaction, [&](rai::public_key const & pub_a, rai::raw_key const & prv_a) {
-								auto vote (this->node.store.vote_generate (transaction, pub_a, prv_a, blocks_bundle));
-								this->node.vote_processor.vote (vote, this->node.network.endpoint ());
-							});
-							blocks_bundle.clear ();
-						}
+						node.vote_generator.add (election_l->status.winner->hash ());
 					}
 					else
 					{
@@ -3887,38 +4869,22 @@ void rai::active_transactions::announce_votes ()
 			}
 			if (i->announcements % 4 == 1)
 			{
-				auto reps (std::make_shared<std::vector<rai::peer_information>> (node.peers.representatives (std::numeric_limits<size_t>::max ())));
-				std::unordered_set<rai::account> probable_reps;
-				rai::amount_t total_weight (0);
-				for (auto j (reps->begin ()), m (reps->end ()); j != m;)
+				auto & rep_votes (i->election->last_votes);
+				auto reps (std::make_shared<std::vector<rai::peer_information>> ());
+				for (auto & rep : peers_l->representatives)
 				{
-					auto & rep_votes (i->election->last_votes);
-					auto rep_acct (j->probable_rep_account);
-					// Calculate if representative isn't recorded for several IP addresses
-					if (probable_reps.find (rep_acct) == probable_reps.end ())
-					{
-						total_weight = total_weight + j->rep_weight.number ();
-						probable_reps.insert (rep_acct);
-					}
-					if (rep_votes.find (rep_acct) != rep_votes.end ())
-					{
-						std::swap (*j, reps->back ());
-						reps->pop_back ();
-						m = reps->end ();
-					}
-					else
+					if (rep_votes.find (rep.probable_rep_account) == rep_votes.end ())
 					{
-						++j;
+						reps->push_back (rep);
 						if (node.config.logging.vote_logging ())
 						{
-							BOOST_LOG (node.log) << "Representative did not respond to confirm_req, retrying: " << rep_acct.to_account ();
+							BOOST_LOG (node.log) << "Representative did not respond to confirm_req, retrying: " << rep.probable_rep_account.to_account ();
 						}
 					}
 				}
-				if (!reps->empty () && (total_weight > node.config.online_weight_minimum.number () || mass_request_count > 20))
+				if (!reps->empty () && (peers_l->total_weight > node.config.online_weight_minimum.number () || mass_request_count > 20))
 				{
-					// broadcast_confirm_req_base modifies reps, so we clone it once to avoid aliasing
-					node.network.broadcast_confirm_req_base (i->confirm_req_options.first, std::make_shared<std::vector<rai::peer_information>> (*reps), 0);
+					node.network.broadcast_confirm_req_base (i->confirm_req_options.first, reps, 0);
 				}
 				else
 				{
@@ -3932,13 +4898,6 @@ void rai::active_transactions::announce_votes ()
 			++info_a.announcements;
 		});
 	}
-	if (node.config.enable_voting && !blocks_bundle.empty ())
-	{
-		node.wallets.foreach_representative (transaction, [&](rai::public_key const & pub_a, rai::raw_key const & prv_a) {
-			auto vote (this->node.store.vote_generate (transaction, pub_a, prv_a, blocks_bundle));
-			this->node.vote_processor.vote (vote, this->node.network.endpoint ());
-		});
-	}
 	for (auto i (inactive.begin ()), n (inactive.end ()); i != n; ++i)
 	{
 		auto root_it (roots.find (*i));
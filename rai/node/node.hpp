@@ -4,8 +4,11 @@
 #include <rai/node/bootstrap.hpp>
 #include <rai/node/stats.hpp>
 #include <rai/node/wallet.hpp>
+#include <rai/node/callback.hpp>
+#include <rai/node/websocket.hpp>
 #include <rai/secure/ledger.hpp>
 
+#include <array>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -22,6 +25,10 @@
 #include <boost/multi_index/random_access_index.hpp>
 #include <boost/multi_index_container.hpp>
 
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
 #include <miniupnpc.h>
 
 namespace boost
@@ -49,6 +56,8 @@ public:
 	std::chrono::steady_clock::time_point time;
 	uint64_t sequence;
 	rai::block_hash hash;
+	// Weight of the representative when the vote was counted into the running tally
+	rai::amount_t weight;
 };
 class election_vote_result
 {
@@ -66,12 +75,13 @@ class election : public std::enable_shared_from_this<rai::election>
 public:
 	election (rai::node &, std::shared_ptr<rai::block>, std::function<void(std::shared_ptr<rai::block>)> const &);
 	rai::election_vote_result vote (rai::account, uint64_t, rai::block_hash);
+	// Recompute the tally from the current representative weights, resynchronizing the running tally
 	rai::tally_t tally (MDB_txn *);
 	// Check if we have vote quorum
 	bool have_quorum (rai::tally_t const &);
 	// Change our winner to agree with the network
 	void compute_rep_votes (MDB_txn *);
-	// Confirm this block if quorum is met
+	// Confirm this block if quorum is met, using the running tally
 	void confirm_if_quorum (MDB_txn *);
 	void log_votes (rai::tally_t const &);
 	bool publish (std::shared_ptr<rai::block> block_a);
@@ -83,6 +93,7 @@ public:
 	rai::election_status status;
 	std::atomic<bool> confirmed;
 	bool aborted;
+	// Running weight per candidate, adjusted by the delta whenever a representative changes its vote
 	std::unordered_map<rai::block_hash, rai::amount_t> last_tally;
 };
 class conflict_info
@@ -221,6 +232,18 @@ public:
 class peer_by_ip_addr
 {
 };
+// Immutable copy of the peer table, published whenever peers join or leave or a representative weight changes
+class peer_snapshot
+{
+public:
+	peer_snapshot ();
+	// Every peer, in no particular order
+	std::vector<rai::endpoint> endpoints;
+	// Peers with a known representative weight, highest first
+	std::vector<rai::peer_information> representatives;
+	// Sum of representative weights, counting each representative account once
+	rai::amount_t total_weight;
+};
 class peer_container
 {
 public:
@@ -265,6 +288,8 @@ public:
 	rai::amount_t total_weight ();
 	rai::amount_t online_weight_minimum;
 	bool empty ();
+	// Latest published snapshot, read without locking
+	std::shared_ptr<rai::peer_snapshot const> snapshot () const;
 	std::mutex mutex;
 	rai::endpoint self;
 	boost::multi_index_container<
@@ -301,6 +326,11 @@ public:
 	static size_t constexpr max_legacy_peers_per_ip = 5;
 	// Maximum number of peers that don't support node ID
 	static size_t constexpr max_legacy_peers = 500;
+
+private:
+	// Rebuilds and publishes the snapshot, mutex must be held
+	void publish ();
+	std::shared_ptr<rai::peer_snapshot const> current;
 };
 class send_info
 {
@@ -395,13 +425,70 @@ private:
 	std::mutex mutex;
 	rai::node & node;
 };
+class network;
+/**
+ * Buffers for receiving several datagrams with a single recvmmsg call (Linux only)
+ */
+class datagram_batch
+{
+public:
+	datagram_batch (size_t);
+	// The message headers point into the buffers, so a batch can't be copied
+	datagram_batch (rai::datagram_batch const &) = delete;
+	// Returns the number of datagrams received, or -1 on error with errno set
+	int receive (int);
+	std::vector<std::array<uint8_t, 512>> buffers;
+	std::vector<rai::endpoint> remotes;
+	std::vector<size_t> sizes;
+#ifdef __linux__
+	std::vector<mmsghdr> messages;
+	std::vector<iovec> iovecs;
+#endif
+};
+/**
+ * A datagram waiting to be flushed with sendmmsg. The buffer is kept alive by the callback.
+ */
+class queued_datagram
+{
+public:
+	uint8_t const * data;
+	size_t size;
+	rai::endpoint endpoint;
+	std::function<void(boost::system::error_code const &, size_t)> callback;
+};
+/**
+ * An additional UDP socket bound to the peering port with SO_REUSEPORT. The kernel spreads incoming
+ * datagrams across all such sockets, each of which has its own buffer and parses packets independently.
+ */
+class receive_socket
+{
+public:
+	receive_socket (rai::network &, uint16_t, unsigned);
+	void receive ();
+	void receive_action (boost::system::error_code const &, size_t);
+	void receive_batch_action (boost::system::error_code const &);
+	void stop ();
+	rai::endpoint remote;
+	std::array<uint8_t, 512> buffer;
+	rai::datagram_batch batch;
+	boost::asio::ip::udp::socket socket;
+	rai::network & network;
+	unsigned index;
+};
 class network
 {
 public:
 	network (rai::node &, uint16_t);
+	void start ();
 	void receive ();
 	void stop ();
 	void receive_action (boost::system::error_code const &, size_t);
+	void receive_batch_action (boost::system::error_code const &);
+	void process_packet (uint8_t const *, size_t, rai::endpoint const &, unsigned);
+	void process_batch (rai::datagram_batch &, int, unsigned);
+	void flush_send_queue ();
+	void send_batch (std::vector<rai::queued_datagram> &);
+	bool batch_io () const;
 	void rpc_action (boost::system::error_code const &, size_t);
 	void republish_vote (std::shared_ptr<rai::vote>);
 	void republish_block (MDB_txn *, std::shared_ptr<rai::block>, bool = true);
@@ -418,11 +505,24 @@ public:
 	rai::endpoint endpoint ();
 	rai::endpoint remote;
 	std::array<uint8_t, 512> buffer;
+	rai::datagram_batch batch;
 	boost::asio::ip::udp::socket socket;
 	std::mutex socket_mutex;
+	// Outgoing datagrams waiting for sendmmsg, protected by socket_mutex
+	std::vector<rai::queued_datagram> send_queue;
+	bool send_flush_scheduled;
+	// Protects the message headers reused by send_batch
+	std::mutex send_mutex;
+#ifdef __linux__
+	std::vector<mmsghdr> send_messages;
+	std::vector<iovec> send_iovecs;
+#endif
+	// Extra receive sockets, empty unless receive_sockets is greater than 1 in the node config
+	std::vector<std::unique_ptr<rai::receive_socket>> receive_sockets;
 	boost::asio::ip::udp::resolver resolver;
 	rai::node & node;
 	bool on;
+	static unsigned constexpr receive_sockets_max = 16;
 	static uint16_t const node_port = rai::rai_network == rai::rai_networks::rai_live_network ? 7042 : 54200;
 };
 class logging
@@ -498,14 +598,31 @@ public:
 	unsigned online_weight_quorum;
 	unsigned password_fanout;
 	unsigned io_threads;
+	unsigned receive_sockets;
+	unsigned udp_batch_size;
+	unsigned udp_flush_interval;
 	unsigned work_threads;
+	unsigned signature_checker_threads;
 	bool enable_voting;
 	unsigned bootstrap_connections;
 	unsigned bootstrap_connections_max;
 	std::string callback_address;
 	uint16_t callback_port;
 	std::string callback_target;
+	// Keep-alive connections kept open to the callback address
+	unsigned callback_connections;
+	// Events POSTed together as a JSON array, 1 POSTs each event as a single object
+	unsigned callback_batch_size;
+	// Undelivered events kept on disk for retry, beyond this they are dropped
+	size_t callback_queue_max;
 	int lmdb_max_dbs;
+	size_t account_cache_size;
+	unsigned block_processor_live_weight;
+	unsigned block_processor_local_weight;
+	unsigned block_processor_bootstrap_weight;
+	// Milliseconds hashes are collected for before one vote is signed for all of them
+	unsigned vote_generator_delay;
+	rai::websocket_config websocket;
 	rai::stat_config stat_config;
 	std::chrono::system_clock::time_point generate_hash_votes_at;
 	static std::chrono::seconds constexpr keepalive_period = std::chrono::seconds (60);
@@ -523,18 +640,58 @@ public:
 	rai::observer_set<> disconnect;
 	rai::observer_set<> started;
 };
+/**
+ * A set of signatures to be verified together. All pointers refer to memory owned by the caller.
+ */
+class signature_check_set
+{
+public:
+	size_t size;
+	unsigned char const ** messages;
+	size_t * message_lengths;
+	unsigned char const ** pub_keys;
+	unsigned char const ** signatures;
+	int * verifications;
+};
+/**
+ * Verifies signatures with batch ed25519 verification. Large sets are split into chunks
+ * which are verified in parallel by a pool of threads together with the calling thread.
+ * The pool also runs other chunked work through execute, e.g. the block processor's ledger prefetch.
+ */
+class signature_checker
+{
+public:
+	signature_checker (unsigned);
+	~signature_checker ();
+	void verify (rai::signature_check_set &);
+	// Call action (start, size) for chunks covering [0, size), in parallel on the pool and the calling thread, returns when all are done
+	void execute (size_t, size_t, std::function<void(size_t, size_t)> const &);
+	bool parallel ();
+	void stop ();
+	static size_t constexpr batch_size = 256;
+
+private:
+	void run ();
+	void verify_batch (rai::signature_check_set &, size_t, size_t);
+	std::deque<std::function<void()>> tasks;
+	std::condition_variable condition;
+	std::mutex mutex;
+	bool stopped;
+	std::vector<std::thread> threads;
+};
 class vote_processor
 {
 public:
 	vote_processor (rai::node &);
 	void vote (std::shared_ptr<rai::vote>, rai::endpoint);
-	rai::vote_code vote_blocking (MDB_txn *, std::shared_ptr<rai::vote>, rai::endpoint);
+	rai::vote_code vote_blocking (MDB_txn *, std::shared_ptr<rai::vote>, rai::endpoint, rai::signature_verification = rai::signature_verification::unknown);
 	void flush ();
 	rai::node & node;
 	void stop ();
 
 private:
 	void process_loop ();
+	void verify_votes (std::deque<std::pair<std::shared_ptr<rai::vote>, rai::endpoint>> const &, std::vector<int> &);
 	std::deque<std::pair<std::shared_ptr<rai::vote>, rai::endpoint>> votes;
 	std::condition_variable condition;
 	std::mutex mutex;
@@ -543,6 +700,40 @@ private:
 	bool active;
 	std::thread thread;
 };
+// Collects hashes for a short window and signs one vote per representative covering up to max_hashes of them
+class vote_generator
+{
+public:
+	vote_generator (rai::node &, std::chrono::milliseconds);
+	// Vote for the hash and send the vote to the peer that asked for it
+	void add (rai::block_hash const &, rai::endpoint const &);
+	// Vote for the hash and process the vote locally, which republishes it
+	void add (rai::block_hash const &);
+	void stop ();
+	// As many hashes as fit a confirm_ack in a 512 byte datagram
+	static size_t constexpr max_hashes = 12;
+	static size_t constexpr max_queue = 64 * 1024;
+
+private:
+	class request
+	{
+	public:
+		std::vector<rai::endpoint> endpoints;
+		bool local;
+	};
+	void add (rai::block_hash const &, boost::optional<rai::endpoint> const &);
+	void run ();
+	void send (std::unique_lock<std::mutex> &);
+	rai::node & node;
+	std::chrono::milliseconds wait;
+	std::deque<rai::block_hash> hashes;
+	std::unordered_map<rai::block_hash, rai::vote_generator::request> requests;
+	std::condition_variable condition;
+	std::mutex mutex;
+	bool started;
+	bool stopped;
+	std::thread thread;
+};
 // The network is crawled for representatives by occasionally sending a unicast confirm_req for a specific block and watching to see if it's acknowledged with a vote.
 class rep_crawler
 {
@@ -555,6 +746,30 @@ public:
 };
 // Processing blocks is a potentially long IO operation
 // This class isolates block insertion from other operations like servicing network operations
+/**
+ * Where a block entered the block processor. Each source has its own queue so a bootstrap
+ * flood cannot delay live blocks which may need a vote.
+ */
+enum class block_queue : uint8_t
+{
+	// Published blocks, seen recently by block_arrival
+	live,
+	// Fork winners and blocks forced through RPC, rolling back a competing successor
+	forced,
+	// Blocks created by our own wallets
+	local,
+	// Blocks pulled by bootstrap
+	bootstrap
+};
+class block_processor_item
+{
+public:
+	std::shared_ptr<rai::block> block;
+	std::chrono::steady_clock::time_point origination;
+	// When the block was queued, for latency stats
+	std::chrono::steady_clock::time_point arrival;
+	rai::block_queue queue;
+};
 class block_processor
 {
 public:
@@ -563,22 +778,44 @@ public:
 	void stop ();
 	void flush ();
 	bool full ();
+	// Whether a queue is above queue_max, its producer should slow down
+	bool full (rai::block_queue);
+	size_t size (rai::block_queue);
+	// Queue is live if the block arrived recently, otherwise bootstrap
 	void add (std::shared_ptr<rai::block>, std::chrono::steady_clock::time_point);
+	void add (std::shared_ptr<rai::block>, std::chrono::steady_clock::time_point, rai::block_queue);
 	void force (std::shared_ptr<rai::block>);
 	bool should_log ();
 	bool have_blocks ();
 	void process_blocks ();
-	rai::process_return process_receive_one (MDB_txn *, std::shared_ptr<rai::block>, std::chrono::steady_clock::time_point = std::chrono::steady_clock::now ());
+	rai::process_return process_receive_one (MDB_txn *, std::shared_ptr<rai::block>, std::chrono::steady_clock::time_point = std::chrono::steady_clock::now (), rai::signature_verification = rai::signature_verification::unknown);
+	static size_t constexpr verification_batch_max = 4096;
+	static size_t constexpr process_batch_max = 16384;
+	// Batches smaller than this go straight to the write transaction
+	static size_t constexpr prefetch_min = 256;
+	static size_t constexpr queue_count = 4;
+	static size_t constexpr queue_max = 16384;
 
 private:
 	void queue_unchecked (MDB_txn *, rai::block_hash const &);
+	// Take up to verification_batch_max blocks, serving each queue except forced in turn up to its weight per round
+	std::deque<rai::block_processor_item> next_batch ();
+	void verify_blocks (std::unique_lock<std::mutex> &);
+	// Read-only pass over the next batch in parallel read transactions, so the write transaction finds the pages and account cache warm
+	void prefetch (std::vector<std::shared_ptr<rai::block>> const &);
+	void prefetch_one (MDB_txn *, rai::block const &);
 	void process_receive_many (std::unique_lock<std::mutex> &);
 	bool stopped;
 	bool active;
 	std::chrono::steady_clock::time_point next_log;
-	std::deque<std::pair<std::shared_ptr<rai::block>, std::chrono::steady_clock::time_point>> blocks;
+	// Incoming blocks per rai::block_queue, signatures not yet checked. Forced blocks skip verification and are written ahead of everything else.
+	std::array<std::deque<rai::block_processor_item>, queue_count> blocks;
+	// Blocks taken from each queue per round
+	std::array<unsigned, queue_count> weights;
+	// Blocks with signatures checked, ready for the ledger, in the order the queues were served
+	std::deque<rai::block_processor_item> verified_blocks;
+	// Hashes of queued blocks, except forced ones
 	std::unordered_set<rai::block_hash> blocks_hashes;
-	std::deque<std::shared_ptr<rai::block>> forced;
 	std::condition_variable condition;
 	rai::node & node;
 	std::mutex mutex;
@@ -603,7 +840,7 @@ public:
 	int store_version ();
 	void process_confirmed (std::shared_ptr<rai::block>);
 	void process_message (rai::message &, rai::endpoint const &);
-	void process_active (std::shared_ptr<rai::block>);
+	void process_active (std::shared_ptr<rai::block>, rai::block_queue = rai::block_queue::live);
 	rai::process_return process (rai::block const &);
 	void keepalive_preconfigured (std::vector<std::string> const &);
 	rai::block_hash latest (rai::account const &);
@@ -618,6 +855,7 @@ public:
 	void ongoing_rep_crawl ();
 	void ongoing_bootstrap ();
 	void ongoing_store_flush ();
+	void ongoing_unchecked_cleanup ();
 	void port_mapping_start_delayed ();
 	void backup_wallet ();
 	int price (rai::amount_t const &, int);
@@ -653,7 +891,9 @@ public:
 	rai::node_observers observers;
 	rai::wallets wallets;
 	rai::port_mapping port_mapping;
+	rai::signature_checker signature_checker;
 	rai::vote_processor vote_processor;
+	rai::vote_generator vote_generator;
 	rai::rep_crawler rep_crawler;
 	unsigned warmed_up;
 	rai::block_processor block_processor;
@@ -661,12 +901,20 @@ public:
 	rai::block_arrival block_arrival;
 	rai::online_reps online_reps;
 	rai::stat stats;
+	// Null unless enabled in the config
+	std::shared_ptr<rai::websocket_server> websocket;
+	// Null unless a callback address is configured
+	std::shared_ptr<rai::callback_dispatcher> callback;
 	static double constexpr price_max = 16.0;
 	static double constexpr free_cutoff = 1024.0;
 	static std::chrono::seconds constexpr period = std::chrono::seconds (60);
 	static std::chrono::seconds constexpr cutoff = period * 5;
 	static std::chrono::seconds constexpr syn_cookie_cutoff = std::chrono::seconds (5);
 	static std::chrono::minutes constexpr backup_interval = std::chrono::minutes (5);
+	// Unchecked blocks older than this are dropped, bootstrap pulls them again if still needed
+	static std::chrono::hours constexpr unchecked_cutoff = std::chrono::hours (4);
+	static std::chrono::minutes constexpr unchecked_cleanup_interval = std::chrono::minutes (5);
+	static size_t constexpr unchecked_expire_batch = 16384;
 
 private:
 	rai::keypair node_id; // private to avoid accidental node_id.prv leaking
@@ -11,6 +11,10 @@
 
 #include <rai/lib/errors.hpp>
 
+size_t constexpr rai::rpc_latency::bucket_count;
+size_t constexpr rai::rpc_latency::actions_max;
+size_t constexpr rai::rpc_connection::pipeline_max;
+
 rai::rpc_secure_config::rpc_secure_config () :
 enable (false),
 verbose_logging (false)
@@ -54,7 +58,10 @@ port (rai::rpc::rpc_port),
 enable_control (false),
 frontier_request_limit (16384),
 chain_request_limit (16384),
-max_json_depth (20)
+max_json_depth (20),
+worker_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
+max_requests (1024),
+keepalive_timeout (30)
 {
 }
 
@@ -64,7 +71,10 @@ port (rai::rpc::rpc_port),
 enable_control (enable_control_a),
 frontier_request_limit (16384),
 chain_request_limit (16384),
-max_json_depth (20)
+max_json_depth (20),
+worker_threads (std::max<unsigned> (4, std::thread::hardware_concurrency ())),
+max_requests (1024),
+keepalive_timeout (30)
 {
 }
 
@@ -76,6 +86,9 @@ void rai::rpc_config::serialize_json (boost::property_tree::ptree & tree_a) cons
 	tree_a.put ("frontier_request_limit", frontier_request_limit);
 	tree_a.put ("chain_request_limit", chain_request_limit);
 	tree_a.put ("max_json_depth", max_json_depth);
+	tree_a.put ("worker_threads", worker_threads);
+	tree_a.put ("max_requests", max_requests);
+	tree_a.put ("keepalive_timeout", keepalive_timeout);
 }
 
 bool rai::rpc_config::deserialize_json (boost::property_tree::ptree const & tree_a)
@@ -97,6 +110,11 @@ bool rai::rpc_config::deserialize_json (boost::property_tree::ptree const & tree
 			auto frontier_request_limit_l (tree_a.get<std::string> ("frontier_request_limit"));
 			auto chain_request_limit_l (tree_a.get<std::string> ("chain_request_limit"));
 			max_json_depth = tree_a.get<uint8_t> ("max_json_depth", max_json_depth);
+			worker_threads = tree_a.get<unsigned> ("worker_threads", worker_threads);
+			max_requests = tree_a.get<unsigned> ("max_requests", max_requests);
+			keepalive_timeout = tree_a.get<unsigned> ("keepalive_timeout", keepalive_timeout);
+			result |= worker_threads == 0;
+			result |= max_requests == 0;
 			try
 			{
 				port = std::stoul (port_l);
@@ -126,8 +144,15 @@ bool rai::rpc_config::deserialize_json (boost::property_tree::ptree const & tree
 rai::rpc::rpc (boost::asio::io_service & service_a, rai::node & node_a, rai::rpc_config const & config_a) :
 acceptor (service_a),
 config (config_a),
-node (node_a)
+node (node_a),
+requests (0),
+rejected (0)
+{
+}
+
+rai::rpc::~rpc ()
 {
+	stop ();
 }
 
 void rai::rpc::start ()
@@ -149,6 +174,22 @@ void rai::rpc::start ()
 		observer_action (account_a);
 	});
 
+	workers_work.reset (new boost::asio::io_service::work (workers));
+	for (auto i (0u); i < config.worker_threads; ++i)
+	{
+		worker_threads.push_back (std::thread ([this]() {
+			try
+			{
+				workers.run ();
+			}
+			catch (...)
+			{
+#ifndef NDEBUG
+				throw;
+#endif
+			}
+		}));
+	}
 	accept ();
 }
 
@@ -171,14 +212,97 @@ void rai::rpc::accept ()
 void rai::rpc::stop ()
 {
 	acceptor.close ();
+	workers_work.reset ();
+	workers.stop ();
+	for (auto & i : worker_threads)
+	{
+		i.join ();
+	}
+	worker_threads.clear ();
+}
+
+void rai::rpc::post (std::function<void()> const & action_a)
+{
+	workers.post (action_a);
+}
+
+std::shared_ptr<void> rai::rpc::request_slot ()
+{
+	std::shared_ptr<void> result;
+	if (++requests <= config.max_requests)
+	{
+		result = std::shared_ptr<void> (this, [this](void *) {
+			--requests;
+		});
+	}
+	else
+	{
+		--requests;
+		++rejected;
+	}
+	return result;
+}
+
+rai::rpc_latency::histogram::histogram () :
+count (0),
+total (0),
+max (0)
+{
+	buckets.fill (0);
+}
+
+void rai::rpc_latency::add (std::string const & action_a, std::chrono::microseconds const & duration_a)
+{
+	uint64_t duration (duration_a.count ());
+	size_t bucket (0);
+	while (bucket < bucket_count - 1 && duration >= (uint64_t (1) << bucket))
+	{
+		++bucket;
+	}
+	std::lock_guard<std::mutex> lock (mutex);
+	auto existing (actions.find (action_a));
+	if (existing == actions.end ())
+	{
+		existing = actions.emplace (actions.size () < actions_max ? action_a : std::string ("other"), rai::rpc_latency::histogram ()).first;
+	}
+	auto & histogram (existing->second);
+	++histogram.buckets[bucket];
+	++histogram.count;
+	histogram.total += duration;
+	histogram.max = std::max (histogram.max, duration);
 }
 
-rai::rpc_handler::rpc_handler (rai::node & node_a, rai::rpc & rpc_a, std::string const & body_a, std::string const & request_id_a, std::function<void(boost::property_tree::ptree const &)> const & response_a) :
+void rai::rpc_latency::serialize_json (boost::property_tree::ptree & tree_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	for (auto & i : actions)
+	{
+		boost::property_tree::ptree entry;
+		entry.put ("count", std::to_string (i.second.count));
+		entry.put ("total_us", std::to_string (i.second.total));
+		entry.put ("max_us", std::to_string (i.second.max));
+		boost::property_tree::ptree buckets;
+		for (size_t j (0); j < bucket_count; ++j)
+		{
+			if (i.second.buckets[j] != 0)
+			{
+				// Keyed by the exclusive upper bound in microseconds, the last bucket is open ended
+				buckets.put (j < bucket_count - 1 ? std::to_string (uint64_t (1) << j) : std::string ("inf"), std::to_string (i.second.buckets[j]));
+			}
+		}
+		entry.add_child ("buckets", buckets);
+		tree_a.add_child (i.first, entry);
+	}
+}
+
+rai::rpc_handler::rpc_handler (rai::node & node_a, rai::rpc & rpc_a, std::string const & body_a, std::string const & request_id_a, std::function<void(std::string const &)> const & response_a) :
 body (body_a),
+request_id (request_id_a),
+arrival (std::chrono::steady_clock::now ()),
 node (node_a),
 rpc (rpc_a),
-response (response_a),
-request_id (request_id_a)
+response (rai::json_response (response_a)),
+response_body (response_a)
 {
 }
 
@@ -206,6 +330,147 @@ void rai::error_response (std::function<void(boost::property_tree::ptree const &
 	response_a (response_l);
 }
 
+std::function<void(boost::property_tree::ptree const &)> rai::json_response (std::function<void(std::string const &)> const & response_a)
+{
+	return [response_a](boost::property_tree::ptree const & tree_a) {
+		std::stringstream ostream;
+		boost::property_tree::write_json (ostream, tree_a);
+		ostream.flush ();
+		response_a (ostream.str ());
+	};
+}
+
+rai::json_writer::json_writer ()
+{
+	buffer.reserve (4096);
+}
+
+void rai::json_writer::object_begin (std::string const & key_a)
+{
+	value_begin (key_a);
+	scopes.push_back ({ buffer.size (), 0, false });
+	buffer += '{';
+}
+
+void rai::json_writer::object_end ()
+{
+	assert (!scopes.empty () && !scopes.back ().array);
+	scope_end ('}');
+}
+
+void rai::json_writer::array_begin (std::string const & key_a)
+{
+	value_begin (key_a);
+	scopes.push_back ({ buffer.size (), 0, true });
+	buffer += '[';
+}
+
+void rai::json_writer::array_end ()
+{
+	assert (!scopes.empty () && scopes.back ().array);
+	scope_end (']');
+}
+
+void rai::json_writer::put (std::string const & key_a, std::string const & value_a)
+{
+	value_begin (key_a);
+	buffer += '"';
+	escape (value_a);
+	buffer += '"';
+}
+
+std::string const & rai::json_writer::finish ()
+{
+	while (!scopes.empty ())
+	{
+		scope_end (scopes.back ().array ? ']' : '}');
+	}
+	buffer += '\n';
+	return buffer;
+}
+
+void rai::json_writer::value_begin (std::string const & key_a)
+{
+	if (!scopes.empty ())
+	{
+		auto & scope (scopes.back ());
+		buffer += scope.count++ == 0 ? "\n" : ",\n";
+		buffer.append (4 * scopes.size (), ' ');
+		if (!scope.array)
+		{
+			buffer += '"';
+			escape (key_a);
+			buffer += "\": ";
+		}
+	}
+}
+
+void rai::json_writer::scope_end (char close_a)
+{
+	auto scope (scopes.back ());
+	scopes.pop_back ();
+	if (scope.count == 0 && !scopes.empty ())
+	{
+		// ptree can't tell an empty child from an empty value
+		buffer.resize (scope.begin);
+		buffer += "\"\"";
+	}
+	else
+	{
+		buffer += '\n';
+		buffer.append (4 * scopes.size (), ' ');
+		buffer += close_a;
+	}
+}
+
+void rai::json_writer::escape (std::string const & text_a)
+{
+	// Same escapes as write_json
+	for (auto i : text_a)
+	{
+		auto c (static_cast<unsigned char> (i));
+		if (c == 0x20 || c == 0x21 || (c >= 0x23 && c <= 0x2E) || (c >= 0x30 && c <= 0x5B) || c >= 0x5D)
+		{
+			buffer += i;
+		}
+		else
+		{
+			buffer += '\\';
+			switch (i)
+			{
+				case '\b':
+					buffer += 'b';
+					break;
+				case '\f':
+					buffer += 'f';
+					break;
+				case '\n':
+					buffer += 'n';
+					break;
+				case '\r':
+					buffer += 'r';
+					break;
+				case '\t':
+					buffer += 't';
+					break;
+				case '/':
+				case '"':
+				case '\\':
+					buffer += i;
+					break;
+				default:
+				{
+					char const * digits ("0123456789ABCDEF");
+					buffer += "u00";
+					buffer += digits[c >> 4];
+					buffer += digits[c & 0xf];
+					break;
+				}
+			}
+		}
+	}
+}
+
 void rai::rpc_handler::response_errors ()
 {
 	if (ec || response_l.empty ())
@@ -220,6 +485,18 @@ void rai::rpc_handler::response_errors ()
 	}
 }
 
+void rai::rpc_handler::response_errors (rai::json_writer & writer_a)
+{
+	if (ec)
+	{
+		response_errors ();
+	}
+	else
+	{
+		response_body (writer_a.finish ());
+	}
+}
+
 std::shared_ptr<rai::wallet> rai::rpc_handler::wallet_impl ()
 {
 	if (!ec)
@@ -589,6 +866,7 @@ void rai::rpc_handler::account_move ()
 				}
 				rai::transaction transaction (node.store.environment, nullptr, true);
 				auto error (wallet->store.move (transaction, source->store, accounts));
+				node.wallets.compute_reps (transaction);
 				response_l.put ("moved", error ? "0" : "1");
 			}
 			else
@@ -617,6 +895,8 @@ void rai::rpc_handler::account_remove ()
 			if (wallet->store.find (transaction, account) != wallet->store.end ())
 			{
 				wallet->store.erase (transaction, account);
+				// The cached key would keep voting until the next rebuild
+				node.wallets.compute_reps (transaction);
 				response_l.put ("removed", "1");
 			}
 			else
@@ -733,21 +1013,22 @@ void rai::rpc_handler::account_weight ()
 
 void rai::rpc_handler::accounts_balances ()
 {
-	boost::property_tree::ptree balances;
+	rai::json_writer writer;
+	writer.object_begin ();
+	writer.object_begin ("balances");
 	for (auto & accounts : request.get_child ("accounts"))
 	{
 		auto account (account_impl (accounts.second.data ()));
 		if (!ec)
 		{
-			boost::property_tree::ptree entry;
 			auto balance (node.balance_pending (account));
-			entry.put ("balance", std::to_string (balance.first));
-			entry.put ("pending", std::to_string (balance.second));
-			balances.push_back (std::make_pair (account.to_account (), entry));
+			writer.object_begin (account.to_account ());
+			writer.put ("balance", std::to_string (balance.first));
+			writer.put ("pending", std::to_string (balance.second));
+			writer.object_end ();
 		}
 	}
-	response_l.add_child ("balances", balances);
-	response_errors ();
+	response_errors (writer);
 }
 
 void rai::rpc_handler::accounts_create ()
@@ -1015,8 +1296,9 @@ void rai::rpc_handler::blocks_info ()
 	const bool source = request.get<bool> ("source", false);
 	const bool balance = request.get<bool> ("balance", false);
 	const bool include_comment = request.get<bool> ("include_comment", false);
-	std::vector<std::string> hashes;
-	boost::property_tree::ptree blocks;
+	rai::json_writer writer;
+	writer.object_begin ();
+	writer.object_begin ("blocks");
 	rai::transaction transaction (node.store.environment, nullptr, false);
 	for (boost::property_tree::ptree::value_type & hashes : request.get_child ("hashes"))
 	{
@@ -1037,16 +1319,16 @@ void rai::rpc_handler::blocks_info ()
 			ec = nano::error_blocks::not_found;
 			continue;
 		}
-		boost::property_tree::ptree entry;
+		writer.object_begin (hash_text);
 		auto account (node.ledger.account (transaction, hash));
-		entry.put ("block_account", account.to_account ());
+		writer.put ("block_account", account.to_account ());
 		int amount_sign = 0;
 		auto amount (node.ledger.amount_with_sign (transaction, hash, amount_sign));
-		entry.put ("amount", std::to_string (amount));
-		entry.put ("amount_sign", std::to_string (amount_sign));
+		writer.put ("amount", std::to_string (amount));
+		writer.put ("amount_sign", std::to_string (amount_sign));
 		std::string contents;
 		block->serialize_json (contents);
-		entry.put ("contents", contents);
+		writer.put ("contents", contents);
 		if (pending)
 		{
 			bool exists (false);
@@ -1055,7 +1337,7 @@ void rai::rpc_handler::blocks_info ()
 			{
 				exists = node.store.pending_exists (transaction, rai::pending_key (destination, hash));
 			}
-			entry.put ("pending", exists ? "1" : "0");
+			writer.put ("pending", exists ? "1" : "0");
 		}
 		// account comment (on block account)
 		if (include_comment)
@@ -1063,7 +1345,7 @@ void rai::rpc_handler::blocks_info ()
 			auto account_comment (node.ledger.account_comment (transaction, account));
 			if (!account_comment.empty ())
 			{
-				entry.put ("account_comment", account_comment);
+				writer.put ("account_comment", account_comment);
 			}
 		}
 		if (source)
@@ -1072,19 +1354,19 @@ void rai::rpc_handler::blocks_info ()
 			std::unique_ptr<rai::block> block_a (node.store.block_get (transaction, source_hash));
 			if (block_a == nullptr)
 			{
-				entry.put ("source_account", "0");
+				writer.put ("source_account", "0");
 			}
 			else
 			{
 				auto source_account (node.ledger.account (transaction, source_hash));
-				entry.put ("source_account", source_account.to_account ());
+				writer.put ("source_account", source_account.to_account ());
 				// account comment on source
 				if (include_comment)
 				{
 					auto source_account_comment (node.ledger.account_comment (transaction, source_account));
 					if (!source_account_comment.empty ())
 					{
-						entry.put ("source_account_comment", source_account_comment);
+						writer.put ("source_account_comment", source_account_comment);
 					}
 				}
 			}
@@ -1092,12 +1374,11 @@ void rai::rpc_handler::blocks_info ()
 		if (balance)
 		{
 			auto balance (node.ledger.balance (transaction, hash));
-			entry.put ("balance", std::to_string (balance));
+			writer.put ("balance", std::to_string (balance));
 		}
-		blocks.push_back (std::make_pair (hash_text, entry));
+		writer.object_end ();
 	}
-	response_l.add_child ("blocks", blocks);
-	response_errors ();
+	response_errors (writer);
 }
 
 void rai::rpc_handler::block_account ()
@@ -1505,17 +1786,15 @@ void rai::rpc_handler::delegators ()
 	{
 		boost::property_tree::ptree delegators;
 		rai::transaction transaction (node.store.environment, nullptr, false);
-		for (auto i (node.store.latest_begin (transaction)), n (node.store.latest_end ()); i != n; ++i)
+		for (auto i (node.store.delegators_begin (transaction, account)), n (node.store.delegators_end ()); i != n && rai::account (i->first.uint256 ()) == account; i.next_dup ())
 		{
-			rai::account_info info (i->second);
-			auto block (node.store.block_get (transaction, info.rep_block));
-			assert (block != nullptr);
-			if (block->representative () == account)
-			{
-				std::string balance;
-				rai::amount (info.balance).encode_dec (balance);
-				delegators.put (rai::account (i->first.uint256 ()).to_account (), balance);
-			}
+			rai::account delegator (i->second.uint256 ());
+			rai::account_info info;
+			auto error (node.store.account_get (transaction, delegator, info));
+			assert (!error);
+			std::string balance;
+			rai::amount (info.balance).encode_dec (balance);
+			delegators.put (delegator.to_account (), balance);
 		}
 		response_l.add_child ("delegators", delegators);
 	}
@@ -1527,18 +1806,8 @@ void rai::rpc_handler::delegators_count ()
 	auto account (account_impl ());
 	if (!ec)
 	{
-		uint64_t count (0);
 		rai::transaction transaction (node.store.environment, nullptr, false);
-		for (auto i (node.store.latest_begin (transaction)), n (node.store.latest_end ()); i != n; ++i)
-		{
-			rai::account_info info (i->second);
-			auto block (node.store.block_get (transaction, info.rep_block));
-			assert (block != nullptr);
-			if (block->representative () == account)
-			{
-				++count;
-			}
-		}
+		auto count (node.store.delegator_count (transaction, account));
 		response_l.put ("count", std::to_string (count));
 	}
 	response_errors ();
@@ -1767,6 +2036,16 @@ void rai::rpc_handler::account_history ()
 		{
 			boost::property_tree::ptree history;
 			response_l.put ("account", account.to_account ());
+			if (!head_str && offset > 0 && node.store.account_height_enabled ())
+			{
+				// Seek straight to the block at the offset instead of walking to it
+				rai::account_info info;
+				if (!node.store.account_get (transaction, account, info))
+				{
+					hash = offset < info.block_count ? node.store.account_height_get (transaction, account, info.block_count - offset) : rai::block_hash (0);
+					offset = 0;
+				}
+			}
 			auto block (node.store.block_get (transaction, hash));
 			while (block != nullptr && count > 0)
 			{
@@ -1900,7 +2179,9 @@ void rai::rpc_handler::ledger ()
 		const bool weight = request.get<bool> ("weight", false);
 		const bool pending = request.get<bool> ("pending", false);
 		const bool include_comment = request.get<bool> ("include_comment", false);
-		boost::property_tree::ptree accounts;
+		rai::json_writer writer;
+		writer.object_begin ();
+		writer.object_begin ("accounts");
 		rai::transaction transaction (node.store.environment, nullptr, false);
 		if (!ec && !sorting && !sorting_by_time) // Simple unsorted
 		{
@@ -1913,7 +2194,7 @@ void rai::rpc_handler::ledger ()
 					account_infos_l.push_back (std::make_pair (i->first.uint256 (), info));
 				}
 			}
-			ledger_helper_fill (transaction, account_infos_l, accounts, representative, weight, pending, include_comment);
+			ledger_helper_fill (transaction, account_infos_l, writer, representative, weight, pending, include_comment);
 		}
 		else if (!ec && sorting) // Sorted by balance
 		{
@@ -1932,7 +2213,7 @@ void rai::rpc_handler::ledger ()
 			{
 				account_infos_l.push_back (i->second);
 			}
-			ledger_helper_fill (transaction, account_infos_l, accounts, representative, weight, pending, include_comment);
+			ledger_helper_fill (transaction, account_infos_l, writer, representative, weight, pending, include_comment);
 		}
 		else if (!ec && sorting_by_time) // Sorted by time
 		{
@@ -1951,43 +2232,46 @@ void rai::rpc_handler::ledger ()
 			{
 				account_infos_l.push_back (i->second);
 			}
-			ledger_helper_fill (transaction, account_infos_l, accounts, representative, weight, pending, include_comment);
+			ledger_helper_fill (transaction, account_infos_l, writer, representative, weight, pending, include_comment);
 		}
-		response_l.add_child ("accounts", accounts);
+		response_errors (writer);
+	}
+	else
+	{
+		response_errors ();
 	}
-	response_errors ();
 }
 
-void rai::rpc_handler::ledger_helper_fill (rai::transaction & transaction_a, std::vector<std::pair<rai::account, rai::account_info>> const & account_list_a, boost::property_tree::ptree & accounts_a, bool representative_in, bool weight_in, bool pending_in, bool comment_in)
+void rai::rpc_handler::ledger_helper_fill (rai::transaction & transaction_a, std::vector<std::pair<rai::account, rai::account_info>> const & account_list_a, rai::json_writer & writer_a, bool representative_in, bool weight_in, bool pending_in, bool comment_in)
 {
 	for (auto i (account_list_a.begin ()), n (account_list_a.end ()); i != n; ++i)
 	{
 		rai::account account (i->first);
 		rai::account_info info = i->second;
-		boost::property_tree::ptree response_a;
-		response_a.put ("frontier", info.head.to_string ());
-		response_a.put ("open_block", info.open_block.to_string ());
-		response_a.put ("representative_block", info.rep_block.to_string ());
+		writer_a.object_begin (account.to_account ());
+		writer_a.put ("frontier", info.head.to_string ());
+		writer_a.put ("open_block", info.open_block.to_string ());
+		writer_a.put ("representative_block", info.rep_block.to_string ());
 		std::string balance;
 		(info.balance).encode_dec (balance);
-		response_a.put ("balance", balance);
-		response_a.put ("last_block_time", rai::short_timestamp::convert_to_posix_time (info.last_block_time ()));
-		response_a.put ("block_count", std::to_string (info.block_count));
+		writer_a.put ("balance", balance);
+		writer_a.put ("last_block_time", std::to_string (rai::short_timestamp::convert_to_posix_time (info.last_block_time ())));
+		writer_a.put ("block_count", std::to_string (info.block_count));
 		if (representative_in)
 		{
 			auto block (node.store.block_get (transaction_a, info.rep_block));
 			assert (block != nullptr);
-			response_a.put ("representative", block->representative ().to_account ());
+			writer_a.put ("representative", block->representative ().to_account ());
 		}
 		if (weight_in)
 		{
 			auto account_weight (node.ledger.weight (transaction_a, account));
-			response_a.put ("weight", std::to_string (account_weight));
+			writer_a.put ("weight", std::to_string (account_weight));
 		}
 		if (pending_in)
 		{
 			auto account_pending (node.ledger.account_pending (transaction_a, account));
-			response_a.put ("pending", std::to_string (account_pending));
+			writer_a.put ("pending", std::to_string (account_pending));
 		}
 		if (comment_in)
 		{
@@ -1996,11 +2280,11 @@ void rai::rpc_handler::ledger_helper_fill (rai::transaction & transaction_a, std
 				auto account_comment (node.ledger.account_comment (transaction_a, account));
 				if (!account_comment.empty ())
 				{
-					response_a.put ("account_comment", account_comment);
+					writer_a.put ("account_comment", account_comment);
 				}
 			}
 		}
-		accounts_a.push_back (std::make_pair (account.to_account (), response_a));
+		writer_a.object_end ();
 	}
 }
 
@@ -2604,18 +2888,9 @@ void rai::rpc_handler::representatives ()
 		}
 		else // Sorting
 		{
-			std::vector<std::pair<rai::amount, std::string>> representation;
-			for (auto i (node.store.representation_begin (transaction)), n (node.store.representation_end ()); i != n; ++i)
-			{
-				rai::account account (i->first.uint256 ());
-				auto amount (node.store.representation_get (transaction, account));
-				representation.push_back (std::make_pair (amount, account.to_account ()));
-			}
-			std::sort (representation.begin (), representation.end ());
-			std::reverse (representation.begin (), representation.end ());
-			for (auto i (representation.begin ()), n (representation.end ()); i != n && representatives.size () < count; ++i)
+			for (auto & i : node.store.rep_weights.top (count))
 			{
-				representatives.put (i->second, std::to_string ((i->first).number ()));
+				representatives.put (i.first.to_account (), std::to_string (i.second));
 			}
 		}
 		response_l.add_child ("representatives", representatives);
@@ -2635,6 +2910,34 @@ void rai::rpc_handler::representatives_online ()
 	response_errors ();
 }
 
+void rai::rpc_handler::representatives_voting ()
+{
+	rpc_control_impl ();
+	if (!ec)
+	{
+		boost::property_tree::ptree representatives;
+		rai::transaction transaction (node.store.environment, nullptr, false);
+		auto reps (node.wallets.reps_list (transaction));
+		for (auto & i : reps)
+		{
+			representatives.put (i.first.to_account (), std::to_string (i.second));
+		}
+		response_l.add_child ("representatives", representatives);
+		response_l.put ("locked", std::to_string (node.wallets.reps_locked ()));
+	}
+	response_errors ();
+}
+
+void rai::rpc_handler::rpc_stats ()
+{
+	response_l.put ("requests", std::to_string (rpc.requests));
+	response_l.put ("rejected", std::to_string (rpc.rejected));
+	boost::property_tree::ptree latency;
+	rpc.latency.serialize_json (latency);
+	response_l.add_child ("latency", latency);
+	response_errors ();
+}
+
 void rai::rpc_handler::republish ()
 {
 	auto count (count_optional_impl (1024U));
@@ -2876,6 +3179,7 @@ void rai::rpc_handler::stats ()
 	std::string type (request.get<std::string> ("type", ""));
 	if (type == "counters")
 	{
+		node.store.account_cache.flush_stats ();
 		node.stats.log_counters (*sink);
 	}
 	else if (type == "samples")
@@ -2906,7 +3210,11 @@ void rai::rpc_handler::stop ()
 	response_errors ();
 	if (!ec)
 	{
-		rpc.stop ();
+		// Stopping joins the RPC workers, this one included
+		auto & rpc_l (rpc);
+		node.background ([&rpc_l]() {
+			rpc_l.stop ();
+		});
 		node.stop ();
 	}
 }
@@ -2921,10 +3229,13 @@ void rai::rpc_handler::unchecked ()
 		for (auto i (node.store.unchecked_begin (transaction)), n (node.store.unchecked_end ()); i != n && unchecked.size () < count; ++i)
 		{
 			rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-			auto block (rai::deserialize_block (stream));
-			std::string contents;
-			block->serialize_json (contents);
-			unchecked.put (block->hash ().to_string (), contents);
+			rai::unchecked_info info;
+			if (!info.deserialize (stream))
+			{
+				std::string contents;
+				info.block->serialize_json (contents);
+				unchecked.put (info.block->hash ().to_string (), contents);
+			}
 		}
 		response_l.add_child ("blocks", unchecked);
 	}
@@ -2951,14 +3262,18 @@ void rai::rpc_handler::unchecked_get ()
 		rai::transaction transaction (node.store.environment, nullptr, false);
 		for (auto i (node.store.unchecked_begin (transaction)), n (node.store.unchecked_end ()); i != n; ++i)
 		{
-			rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-			auto block (rai::deserialize_block (stream));
-			if (block->hash () == hash)
+			rai::unchecked_key key (i->first);
+			if (key.hash == hash)
 			{
-				std::string contents;
-				block->serialize_json (contents);
-				response_l.put ("contents", contents);
-				break;
+				rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+				rai::unchecked_info info;
+				if (!info.deserialize (stream))
+				{
+					std::string contents;
+					info.block->serialize_json (contents);
+					response_l.put ("contents", contents);
+					break;
+				}
 			}
 		}
 		if (response_l.empty ())
@@ -2987,15 +3302,19 @@ void rai::rpc_handler::unchecked_keys ()
 		rai::transaction transaction (node.store.environment, nullptr, false);
 		for (auto i (node.store.unchecked_begin (transaction, key)), n (node.store.unchecked_end ()); i != n && unchecked.size () < count; ++i)
 		{
-			boost::property_tree::ptree entry;
 			rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-			auto block (rai::deserialize_block (stream));
-			std::string contents;
-			block->serialize_json (contents);
-			entry.put ("key", rai::block_hash (i->first.uint256 ()).to_string ());
-			entry.put ("hash", block->hash ().to_string ());
-			entry.put ("contents", contents);
-			unchecked.push_back (std::make_pair ("", entry));
+			rai::unchecked_info info;
+			if (!info.deserialize (stream))
+			{
+				boost::property_tree::ptree entry;
+				std::string contents;
+				info.block->serialize_json (contents);
+				entry.put ("key", rai::unchecked_key (i->first).dependency.to_string ());
+				entry.put ("hash", info.block->hash ().to_string ());
+				entry.put ("modified_timestamp", std::to_string (info.arrival));
+				entry.put ("contents", contents);
+				unchecked.push_back (std::make_pair ("", entry));
+			}
 		}
 		response_l.add_child ("unchecked", unchecked);
 	}
@@ -3345,6 +3664,7 @@ void rai::rpc_handler::wallet_lock ()
 		rai::raw_key empty;
 		empty.data.clear ();
 		wallet->store.password.value_set (empty);
+		node.wallets.compute_reps ();
 		response_l.put ("locked", "1");
 	}
 	response_errors ();
@@ -3358,59 +3678,75 @@ void rai::rpc_handler::wallet_pending ()
 	const bool source = request.get<bool> ("source", false);
 	const bool min_version = request.get<bool> ("min_version", false);
 	const bool include_active = request.get<bool> ("include_active", false);
+	rai::json_writer writer;
 	if (!ec)
 	{
-		boost::property_tree::ptree pending;
+		writer.object_begin ();
+		writer.object_begin ("blocks");
+		// Without a threshold or sources each account lists only its pending hashes
+		auto hashes_only (threshold.is_zero () && !source);
 		rai::transaction transaction (node.store.environment, nullptr, false);
 		for (auto i (wallet->store.begin (transaction)), n (wallet->store.end ()); i != n; ++i)
 		{
 			rai::account account (i->first.uint256 ());
-			boost::property_tree::ptree peers_l;
+			uint64_t entries (0);
 			rai::account end (account.number () + 1);
-			for (auto ii (node.store.pending_begin (transaction, rai::pending_key (account, 0))), nn (node.store.pending_begin (transaction, rai::pending_key (end, 0))); ii != nn && peers_l.size () < count; ++ii)
+			for (auto ii (node.store.pending_begin (transaction, rai::pending_key (account, 0))), nn (node.store.pending_begin (transaction, rai::pending_key (end, 0))); ii != nn && entries < count; ++ii)
 			{
 				rai::pending_key key (ii->first);
 				std::shared_ptr<rai::block> block (node.store.block_get (transaction, key.hash));
 				assert (block);
 				if (include_active || (block && !node.active.active (*block)))
 				{
-					if (threshold.is_zero () && !source)
+					if (hashes_only)
 					{
-						boost::property_tree::ptree entry;
-						entry.put ("", key.hash.to_string ());
-						peers_l.push_back (std::make_pair ("", entry));
+						if (entries++ == 0)
+						{
+							writer.array_begin (account.to_account ());
+						}
+						writer.put ("", key.hash.to_string ());
 					}
 					else
 					{
 						rai::pending_info info (ii->second);
 						if (info.amount.number () >= threshold.number ())
 						{
+							if (entries++ == 0)
+							{
+								writer.object_begin (account.to_account ());
+							}
 							if (source || min_version)
 							{
-								boost::property_tree::ptree pending_tree;
-								pending_tree.put ("amount", std::to_string (info.amount.number ()));
+								writer.object_begin (key.hash.to_string ());
+								writer.put ("amount", std::to_string (info.amount.number ()));
 								if (source)
 								{
-									pending_tree.put ("source", info.source.to_account ());
+									writer.put ("source", info.source.to_account ());
 								}
-								peers_l.add_child (key.hash.to_string (), pending_tree);
+								writer.object_end ();
 							}
 							else
 							{
-								peers_l.put (key.hash.to_string (), std::to_string (info.amount.number ()));
+								writer.put (key.hash.to_string (), std::to_string (info.amount.number ()));
 							}
 						}
 					}
 				}
 			}
-			if (!peers_l.empty ())
+			if (entries != 0)
 			{
-				pending.add_child (account.to_account (), peers_l);
+				if (hashes_only)
+				{
+					writer.array_end ();
+				}
+				else
+				{
+					writer.object_end ();
+				}
 			}
 		}
-		response_l.add_child ("blocks", pending);
 	}
-	response_errors ();
+	response_errors (writer);
 }
 
 void rai::rpc_handler::wallet_representative ()
@@ -3657,76 +3993,202 @@ void rai::rpc_handler::work_peers_clear ()
 rai::rpc_connection::rpc_connection (rai::node & node_a, rai::rpc & rpc_a) :
 node (node_a.shared ()),
 rpc (rpc_a),
-socket (node_a.service)
+socket (node_a.service),
+strand (node_a.service),
+timer (node_a.service),
+next_request (0),
+next_response (0),
+writing (false),
+reading (false),
+finished (false),
+closed (false)
 {
-	responded.clear ();
 }
 
 void rai::rpc_connection::parse_connection ()
 {
-	read ();
+	auto this_l (shared_from_this ());
+	strand.dispatch ([this_l]() {
+		this_l->read ();
+	});
+}
+
+void rai::rpc_connection::read ()
+{
+	auto this_l (shared_from_this ());
+	reading = true;
+	idle_wait ();
+	boost::beast::http::async_read (socket, buffer, request, strand.wrap ([this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		this_l->received (ec);
+	}));
+}
+
+void rai::rpc_connection::received (boost::system::error_code const & ec)
+{
+	reading = false;
+	timer.cancel ();
+	if (!ec)
+	{
+		auto this_l (shared_from_this ());
+		auto sequence (next_request++);
+		auto version (request.version ());
+		auto keep_alive (request.keep_alive ());
+		auto start (std::chrono::steady_clock::now ());
+		std::string request_id (boost::str (boost::format ("%1%/%2%") % boost::io::group (std::hex, std::showbase, reinterpret_cast<uintptr_t> (this)) % sequence));
+		auto respond_l ([this_l, sequence, version, keep_alive](std::string const & body_a, boost::beast::http::status status_a) {
+			this_l->strand.post ([this_l, sequence, body_a, version, keep_alive, status_a]() {
+				this_l->respond (sequence, body_a, version, keep_alive, status_a);
+			});
+		});
+		if (request.method () == boost::beast::http::verb::post)
+		{
+			auto slot (rpc.request_slot ());
+			if (slot != nullptr)
+			{
+				auto node_l (node);
+				auto response_handler ([respond_l, slot, node_l, start, request_id](std::string const & body_a) {
+					respond_l (body_a, boost::beast::http::status::ok);
+					if (node_l->config.logging.log_rpc ())
+					{
+						BOOST_LOG (node_l->log) << boost::str (boost::format ("RPC request %2% completed in: %1% microseconds") % std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count () % request_id);
+					}
+				});
+				// Constructed here so the handler's arrival time includes the wait for a worker
+				auto handler (std::make_shared<rai::rpc_handler> (*node, rpc, request.body (), request_id, response_handler));
+				rpc.post ([handler]() {
+					handler->process_request ();
+				});
+			}
+			else
+			{
+				error_response (rai::json_response ([respond_l](std::string const & body_a) {
+					respond_l (body_a, boost::beast::http::status::service_unavailable);
+				}),
+				"Too many requests in progress");
+			}
+		}
+		else
+		{
+			error_response (rai::json_response ([respond_l](std::string const & body_a) {
+				respond_l (body_a, boost::beast::http::status::ok);
+			}),
+			"Can only POST requests");
+		}
+		request = boost::beast::http::request<boost::beast::http::string_body> ();
+		finished = !keep_alive;
+		write_next ();
+	}
+	else
+	{
+		if (ec != boost::beast::http::error::end_of_stream && ec != boost::asio::error::operation_aborted)
+		{
+			BOOST_LOG (node->log) << "RPC read error: " << ec.message ();
+		}
+		finished = true;
+		write_next ();
+	}
 }
 
-void rai::rpc_connection::write_result (std::string body, unsigned version)
+void rai::rpc_connection::respond (uint64_t sequence_a, std::string const & body_a, unsigned version_a, bool keep_alive_a, boost::beast::http::status status_a)
 {
-	if (!responded.test_and_set ())
+	if (sequence_a >= next_response + (writing ? 1 : 0) && responses.find (sequence_a) == responses.end ())
 	{
-		res.set ("Content-Type", "application/json");
-		res.set ("Access-Control-Allow-Origin", "*");
-		res.set ("Access-Control-Allow-Headers", "Accept, Accept-Language, Content-Language, Content-Type");
-		res.set ("Connection", "close");
-		res.result (boost::beast::http::status::ok);
-		res.body () = body;
-		res.version (version);
-		res.prepare_payload ();
+		auto response (std::make_shared<response_type> ());
+		response->set ("Content-Type", "application/json");
+		response->set ("Access-Control-Allow-Origin", "*");
+		response->set ("Access-Control-Allow-Headers", "Accept, Accept-Language, Content-Language, Content-Type");
+		response->result (status_a);
+		response->version (version_a);
+		response->keep_alive (keep_alive_a);
+		response->body () = body_a;
+		response->prepare_payload ();
+		responses[sequence_a] = response;
+		write_next ();
 	}
 	else
 	{
 		assert (false && "RPC already responded and should only respond once");
-		// Guards `res' from being clobbered while async_write is being serviced
 	}
 }
 
-void rai::rpc_connection::read ()
+void rai::rpc_connection::write_next ()
 {
-	auto this_l (shared_from_this ());
-	boost::beast::http::async_read (socket, buffer, request, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
-		if (!ec)
+	if (!writing && !closed)
+	{
+		auto existing (responses.find (next_response));
+		if (existing != responses.end ())
 		{
-			this_l->node->background ([this_l]() {
-				auto start (std::chrono::steady_clock::now ());
-				auto version (this_l->request.version ());
-				std::string request_id (boost::str (boost::format ("%1%") % boost::io::group (std::hex, std::showbase, reinterpret_cast<uintptr_t> (this_l.get ()))));
-				auto response_handler ([this_l, version, start, request_id](boost::property_tree::ptree const & tree_a) {
-					std::stringstream ostream;
-					boost::property_tree::write_json (ostream, tree_a);
-					ostream.flush ();
-					auto body (ostream.str ());
-					this_l->write_result (body, version);
-					boost::beast::http::async_write (this_l->socket, this_l->res, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
-					});
-
-					if (this_l->node->config.logging.log_rpc ())
-					{
-						BOOST_LOG (this_l->node->log) << boost::str (boost::format ("RPC request %2% completed in: %1% microseconds") % std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count () % request_id);
-					}
-				});
-				if (this_l->request.method () == boost::beast::http::verb::post)
-				{
-					auto handler (std::make_shared<rai::rpc_handler> (*this_l->node, this_l->rpc, this_l->request.body (), request_id, response_handler));
-					handler->process_request ();
-				}
-				else
-				{
-					error_response (response_handler, "Can only POST requests");
-				}
-			});
+			auto response (existing->second);
+			responses.erase (existing);
+			writing = true;
+			write (response);
 		}
-		else
+		else if (next_request == next_response)
+		{
+			if (finished)
+			{
+				close ();
+			}
+			else if (reading)
+			{
+				// Everything is answered, restart the idle timeout
+				idle_wait ();
+			}
+		}
+		if (!closed && !finished && !reading && next_request - next_response < pipeline_max)
 		{
-			BOOST_LOG (this_l->node->log) << "RPC read error: " << ec.message ();
+			read ();
 		}
-	});
+	}
+}
+
+void rai::rpc_connection::write (std::shared_ptr<response_type> response_a)
+{
+	auto this_l (shared_from_this ());
+	boost::beast::http::async_write (socket, *response_a, strand.wrap ([this_l, response_a](boost::system::error_code const & ec, size_t bytes_transferred) {
+		this_l->written (ec, response_a);
+	}));
+}
+
+void rai::rpc_connection::written (boost::system::error_code const & ec, std::shared_ptr<response_type> response_a)
+{
+	writing = false;
+	++next_response;
+	if (!ec)
+	{
+		finished = finished || !response_a->keep_alive ();
+		write_next ();
+	}
+	else
+	{
+		BOOST_LOG (node->log) << "RPC write error: " << ec.message ();
+		close ();
+	}
+}
+
+void rai::rpc_connection::idle_wait ()
+{
+	auto this_l (shared_from_this ());
+	timer.expires_from_now (std::chrono::seconds (rpc.config.keepalive_timeout));
+	timer.async_wait (strand.wrap ([this_l](boost::system::error_code const & ec) {
+		// Only idle connections time out, requests still being processed hold the connection open
+		if (!ec && this_l->reading && !this_l->writing && this_l->next_request == this_l->next_response)
+		{
+			this_l->close ();
+		}
+	}));
+}
+
+void rai::rpc_connection::close ()
+{
+	if (!closed)
+	{
+		closed = true;
+		timer.cancel ();
+		boost::system::error_code ec;
+		socket.shutdown (boost::asio::ip::tcp::socket::shutdown_both, ec);
+		socket.close (ec);
+	}
 }
 
 namespace
@@ -3766,6 +4228,14 @@ void rai::rpc_handler::process_request ()
 			std::stringstream istream (body);
 			boost::property_tree::read_json (istream, request);
 			std::string action (request.get<std::string> ("action"));
+			auto response_a (response_body);
+			auto arrival_l (arrival);
+			auto & latency (rpc.latency);
+			response_body = [response_a, arrival_l, &latency, action](std::string const & body_a) {
+				latency.add (action, std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - arrival_l));
+				response_a (body_a);
+			};
+			response = rai::json_response (response_body);
 			if (action == "password_enter")
 			{
 				password_enter ();
@@ -4075,10 +4545,18 @@ void rai::rpc_handler::process_request ()
 			{
 				representatives_online ();
 			}
+			else if (action == "representatives_voting")
+			{
+				representatives_voting ();
+			}
 			else if (action == "republish")
 			{
 				republish ();
 			}
+			else if (action == "rpc_stats")
+			{
+				rpc_stats ();
+			}
 			else if (action == "search_pending")
 			{
 				search_pending ();
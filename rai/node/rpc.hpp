@@ -1,11 +1,14 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <rai/secure/utility.hpp>
+#include <map>
+#include <thread>
 #include <unordered_map>
 
 #include <rai/secure/common.hpp>
@@ -13,6 +16,8 @@
 namespace rai
 {
 void error_response (std::function<void(boost::property_tree::ptree const &)> response_a, std::string const & message_a);
+// Serializes the tree with write_json and passes the text on
+std::function<void(boost::property_tree::ptree const &)> json_response (std::function<void(std::string const &)> const &);
 class node;
 /** Configuration options for RPC TLS */
 class rpc_secure_config
@@ -51,6 +56,12 @@ public:
 	uint64_t chain_request_limit;
 	rpc_secure_config secure;
 	uint8_t max_json_depth;
+	/** Threads processing requests, separate from the node's network threads */
+	unsigned worker_threads;
+	/** Requests in progress beyond this are answered with 503 Service Unavailable */
+	unsigned max_requests;
+	/** Seconds an idle keep-alive connection is held open */
+	unsigned keepalive_timeout;
 };
 enum class payment_status
 {
@@ -64,36 +75,99 @@ enum class payment_status
 };
 class wallet;
 class payment_observer;
+/** Request latency per RPC action, bucketed by powers of two microseconds */
+class rpc_latency
+{
+public:
+	void add (std::string const &, std::chrono::microseconds const &);
+	void serialize_json (boost::property_tree::ptree &);
+	static size_t constexpr bucket_count = 24;
+	// Actions beyond this many distinct names are counted as "other"
+	static size_t constexpr actions_max = 256;
+
+private:
+	class histogram
+	{
+	public:
+		histogram ();
+		std::array<uint64_t, bucket_count> buckets;
+		uint64_t count;
+		uint64_t total;
+		uint64_t max;
+	};
+	std::mutex mutex;
+	std::map<std::string, rai::rpc_latency::histogram> actions;
+};
 class rpc
 {
 public:
 	rpc (boost::asio::io_service &, rai::node &, rai::rpc_config const &);
+	virtual ~rpc ();
 	void start ();
 	virtual void accept ();
 	void stop ();
 	void observer_action (rai::account const &);
+	// Runs the action on the worker pool
+	void post (std::function<void()> const &);
+	// Counts a request in progress until the last copy is released, null if max_requests are already in progress
+	std::shared_ptr<void> request_slot ();
 	boost::asio::ip::tcp::acceptor acceptor;
 	std::mutex mutex;
 	std::unordered_map<rai::account, std::shared_ptr<rai::payment_observer>> payment_observers;
 	rai::rpc_config config;
 	rai::node & node;
 	bool on;
+	rai::rpc_latency latency;
+	std::atomic<unsigned> requests;
+	std::atomic<uint64_t> rejected;
 	static uint16_t const rpc_port = rai::rai_network == rai::rai_networks::rai_live_network ? 7043 : 54300;
+
+private:
+	boost::asio::io_service workers;
+	std::unique_ptr<boost::asio::io_service::work> workers_work;
+	std::vector<std::thread> worker_threads;
 };
+/**
+ * A persistent HTTP/1.1 connection. Requests are read while earlier ones are still being processed and responses are written in request order.
+ * Socket operations and the response queue are serialized by the strand.
+ */
 class rpc_connection : public std::enable_shared_from_this<rai::rpc_connection>
 {
 public:
 	rpc_connection (rai::node &, rai::rpc &);
+	virtual ~rpc_connection () = default;
 	virtual void parse_connection ();
+	// Reads the next request into `request', completing with received ()
 	virtual void read ();
-	virtual void write_result (std::string body, unsigned version);
 	std::shared_ptr<rai::node> node;
 	rai::rpc & rpc;
 	boost::asio::ip::tcp::socket socket;
+	boost::asio::io_service::strand strand;
 	boost::beast::flat_buffer buffer;
 	boost::beast::http::request<boost::beast::http::string_body> request;
-	boost::beast::http::response<boost::beast::http::string_body> res;
-	std::atomic_flag responded;
+	// Unanswered requests per connection before reading pauses
+	static size_t constexpr pipeline_max = 32;
+
+protected:
+	using response_type = boost::beast::http::response<boost::beast::http::string_body>;
+	void received (boost::system::error_code const &);
+	// Writes the response, completing with written ()
+	virtual void write (std::shared_ptr<response_type>);
+	void written (boost::system::error_code const &, std::shared_ptr<response_type>);
+	virtual void close ();
+	void respond (uint64_t, std::string const &, unsigned, bool, boost::beast::http::status);
+	void write_next ();
+	void idle_wait ();
+	boost::asio::steady_timer timer;
+	// Finished responses waiting for earlier requests, by request sequence
+	std::map<uint64_t, std::shared_ptr<response_type>> responses;
+	uint64_t next_request;
+	uint64_t next_response;
+	bool writing;
+	bool reading;
+	// No further requests will be read, the connection closes once all responses are written
+	bool finished;
+	bool closed;
 };
 class payment_observer : public std::enable_shared_from_this<rai::payment_observer>
 {
@@ -113,10 +187,41 @@ public:
 	std::atomic_flag completed;
 };
 
+/**
+ * Writes JSON text directly in the layout of boost::property_tree::write_json, for responses too large to build as a ptree.
+ * As with ptree every value is a string, and an empty object or array other than the root is written as "".
+ */
+class json_writer
+{
+public:
+	json_writer ();
+	// Opens an object, as the root or as the value of the key. Keys are ignored inside arrays.
+	void object_begin (std::string const & = "");
+	void object_end ();
+	void array_begin (std::string const &);
+	void array_end ();
+	void put (std::string const &, std::string const &);
+	// Closes any open objects and arrays, returning the document
+	std::string const & finish ();
+	std::string buffer;
+
+private:
+	void value_begin (std::string const &);
+	void scope_end (char);
+	void escape (std::string const &);
+	class scope
+	{
+	public:
+		size_t begin;
+		size_t count;
+		bool array;
+	};
+	std::vector<scope> scopes;
+};
 class rpc_handler : public std::enable_shared_from_this<rai::rpc_handler>
 {
 public:
-	rpc_handler (rai::node &, rai::rpc &, std::string const &, std::string const &, std::function<void(boost::property_tree::ptree const &)> const &);
+	rpc_handler (rai::node &, rai::rpc &, std::string const &, std::string const &, std::function<void(std::string const &)> const &);
 	void process_request ();
 	void account_balance ();
 	void account_block_count ();
@@ -162,7 +267,7 @@ public:
 	void key_create ();
 	void key_expand ();
 	void ledger ();
-	void ledger_helper_fill (rai::transaction &, std::vector<std::pair<rai::account, rai::account_info>> const &, boost::property_tree::ptree &, bool, bool, bool, bool);
+	void ledger_helper_fill (rai::transaction &, std::vector<std::pair<rai::account, rai::account_info>> const &, rai::json_writer &, bool, bool, bool, bool);
 	void mrai_to_raw (rai::amount_t = rai::Mxrb_ratio);
 	void mrai_from_raw (rai::amount_t = rai::Mxrb_ratio);
 	void node_id_get ();
@@ -184,7 +289,9 @@ public:
 	void receive_minimum_set ();
 	void representatives ();
 	void representatives_online ();
+	void representatives_voting ();
 	void republish ();
+	void rpc_stats ();
 	void search_pending ();
 	void search_pending_all ();
 	void send ();
@@ -224,11 +331,15 @@ public:
 	void work_peers_clear ();
 	std::string body;
 	std::string request_id;
+	std::chrono::steady_clock::time_point arrival;
 	rai::node & node;
 	rai::rpc & rpc;
 	boost::property_tree::ptree request;
 	std::function<void(boost::property_tree::ptree const &)> response;
+	// Receives the serialized response, bulk actions write to it with a json_writer
+	std::function<void(std::string const &)> response_body;
 	void response_errors ();
+	void response_errors (rai::json_writer &);
 	std::error_code ec;
 	boost::property_tree::ptree response_l;
 	std::shared_ptr<rai::wallet> wallet_impl ();
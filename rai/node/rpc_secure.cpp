@@ -135,16 +135,18 @@ void rai::rpc_connection_secure::parse_connection ()
 {
 	// Perform the SSL handshake
 	stream.async_handshake (boost::asio::ssl::stream_base::server,
-	std::bind (
+	strand.wrap (std::bind (
 	&rai::rpc_connection_secure::handle_handshake,
 	std::static_pointer_cast<rai::rpc_connection_secure> (shared_from_this ()),
-	std::placeholders::_1));
+	std::placeholders::_1)));
 }
 
 void rai::rpc_connection_secure::on_shutdown (const boost::system::error_code & error)
 {
-	// No-op. We initiate the shutdown (since the RPC server kills the connection after each request)
+	// We initiate the shutdown when a client ends its keep-alive session or goes idle
 	// and we'll thus get an expected EOF error. If the client disconnects, a short-read error will be expected.
+	boost::system::error_code ec;
+	socket.close (ec);
 }
 
 void rai::rpc_connection_secure::handle_handshake (const boost::system::error_code & error)
@@ -162,48 +164,31 @@ void rai::rpc_connection_secure::handle_handshake (const boost::system::error_co
 void rai::rpc_connection_secure::read ()
 {
 	auto this_l (std::static_pointer_cast<rai::rpc_connection_secure> (shared_from_this ()));
-	boost::beast::http::async_read (stream, buffer, request, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
-		if (!ec)
-		{
-			this_l->node->background ([this_l]() {
-				auto start (std::chrono::steady_clock::now ());
-				auto version (this_l->request.version ());
-				std::string request_id (boost::str (boost::format ("%1%") % boost::io::group (std::hex, std::showbase, reinterpret_cast<uintptr_t> (this_l.get ()))));
-				auto response_handler ([this_l, version, start, request_id](boost::property_tree::ptree const & tree_a) {
-					std::stringstream ostream;
-					boost::property_tree::write_json (ostream, tree_a);
-					ostream.flush ();
-					auto body (ostream.str ());
-					this_l->write_result (body, version);
-					boost::beast::http::async_write (this_l->stream, this_l->res, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
-						// Perform the SSL shutdown
-						this_l->stream.async_shutdown (
-						std::bind (
-						&rai::rpc_connection_secure::on_shutdown,
-						this_l,
-						std::placeholders::_1));
-					});
-
-					if (this_l->node->config.logging.log_rpc ())
-					{
-						BOOST_LOG (this_l->node->log) << boost::str (boost::format ("TLS: RPC request %2% completed in: %1% microseconds") % std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count () % request_id);
-					}
-				});
-
-				if (this_l->request.method () == boost::beast::http::verb::post)
-				{
-					auto handler (std::make_shared<rai::rpc_handler> (*this_l->node, this_l->rpc, this_l->request.body (), request_id, response_handler));
-					handler->process_request ();
-				}
-				else
-				{
-					error_response (response_handler, "Can only POST requests");
-				}
-			});
-		}
-		else
-		{
-			BOOST_LOG (this_l->node->log) << "TLS: Read error: " << ec.message () << std::endl;
-		}
-	});
+	reading = true;
+	idle_wait ();
+	boost::beast::http::async_read (stream, buffer, request, strand.wrap ([this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		this_l->received (ec);
+	}));
+}
+
+void rai::rpc_connection_secure::write (std::shared_ptr<response_type> response_a)
+{
+	auto this_l (std::static_pointer_cast<rai::rpc_connection_secure> (shared_from_this ()));
+	boost::beast::http::async_write (stream, *response_a, strand.wrap ([this_l, response_a](boost::system::error_code const & ec, size_t bytes_transferred) {
+		this_l->written (ec, response_a);
+	}));
+}
+
+void rai::rpc_connection_secure::close ()
+{
+	if (!closed)
+	{
+		closed = true;
+		timer.cancel ();
+		// Perform the SSL shutdown
+		stream.async_shutdown (strand.wrap (std::bind (
+		&rai::rpc_connection_secure::on_shutdown,
+		std::static_pointer_cast<rai::rpc_connection_secure> (shared_from_this ()),
+		std::placeholders::_1)));
+	}
 }
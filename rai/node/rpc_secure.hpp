@@ -44,6 +44,11 @@ public:
 	/** The TLS async shutdown callback */
 	void on_shutdown (const boost::system::error_code & error);
 
+protected:
+	virtual void write (std::shared_ptr<response_type>) override;
+	/** Performs the TLS shutdown before closing the socket */
+	virtual void close () override;
+
 private:
 	boost::asio::ssl::stream<boost::asio::ip::tcp::socket &> stream;
 };
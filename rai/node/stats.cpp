@@ -256,6 +256,16 @@ void rai::stat::log_samples_impl (stat_log_sink & sink)
 	sink.finalize ();
 }
 
+void rai::stat::set (stat::type type, stat::detail detail, stat::dir dir, uint64_t value)
+{
+	std::unique_lock<std::mutex> lock (stat_mutex);
+	auto entry (get_entry_impl (key_of (type, detail, dir), config.interval, config.capacity));
+	auto old (entry->counter.value);
+	entry->counter.value = value;
+	entry->counter.timestamp = std::chrono::system_clock::now ();
+	entry->count_observers.notify (old, entry->counter.value);
+}
+
 void rai::stat::update (uint32_t key_a, uint64_t value)
 {
 	static file_writer log_count (config.log_counters_filename);
@@ -343,6 +353,33 @@ std::string rai::stat::type_to_string (uint32_t key)
 		case rai::stat::type::message:
 			res = "message";
 			break;
+		case rai::stat::type::signature:
+			res = "signature";
+			break;
+		case rai::stat::type::receive_socket:
+			res = "receive_socket";
+			break;
+		case rai::stat::type::account_cache:
+			res = "account_cache";
+			break;
+		case rai::stat::type::block_processor:
+			res = "block_processor";
+			break;
+		case rai::stat::type::block_processor_latency:
+			res = "block_processor_latency";
+			break;
+		case rai::stat::type::vote_generator:
+			res = "vote_generator";
+			break;
+		case rai::stat::type::websocket:
+			res = "websocket";
+			break;
+		case rai::stat::type::http_callback:
+			res = "http_callback";
+			break;
+		case rai::stat::type::http_callback_latency:
+			res = "http_callback_latency";
+			break;
 	}
 	return res;
 }
@@ -371,6 +408,15 @@ std::string rai::stat::detail_to_string (uint32_t key)
 		case rai::stat::detail::bulk_push:
 			res = "bulk_push";
 			break;
+		case rai::stat::detail::blocks_sent:
+			res = "blocks_sent";
+			break;
+		case rai::stat::detail::send_time_ms:
+			res = "send_time_ms";
+			break;
+		case rai::stat::detail::backpressure:
+			res = "backpressure";
+			break;
 		case rai::stat::detail::confirm_ack:
 			res = "confirm_ack";
 			break;
@@ -425,6 +471,108 @@ std::string rai::stat::detail_to_string (uint32_t key)
 		case rai::stat::detail::vote_invalid:
 			res = "vote_invalid";
 			break;
+		case rai::stat::detail::batch:
+			res = "batch";
+			break;
+		case rai::stat::detail::batch_size:
+			res = "batch_size";
+			break;
+		case rai::stat::detail::batch_rejected:
+			res = "batch_rejected";
+			break;
+		case rai::stat::detail::socket_0:
+			res = "socket_0";
+			break;
+		case rai::stat::detail::socket_1:
+			res = "socket_1";
+			break;
+		case rai::stat::detail::socket_2:
+			res = "socket_2";
+			break;
+		case rai::stat::detail::socket_3:
+			res = "socket_3";
+			break;
+		case rai::stat::detail::socket_4:
+			res = "socket_4";
+			break;
+		case rai::stat::detail::socket_5:
+			res = "socket_5";
+			break;
+		case rai::stat::detail::socket_6:
+			res = "socket_6";
+			break;
+		case rai::stat::detail::socket_7:
+			res = "socket_7";
+			break;
+		case rai::stat::detail::socket_8:
+			res = "socket_8";
+			break;
+		case rai::stat::detail::socket_9:
+			res = "socket_9";
+			break;
+		case rai::stat::detail::socket_10:
+			res = "socket_10";
+			break;
+		case rai::stat::detail::socket_11:
+			res = "socket_11";
+			break;
+		case rai::stat::detail::socket_12:
+			res = "socket_12";
+			break;
+		case rai::stat::detail::socket_13:
+			res = "socket_13";
+			break;
+		case rai::stat::detail::socket_14:
+			res = "socket_14";
+			break;
+		case rai::stat::detail::socket_15:
+			res = "socket_15";
+			break;
+		case rai::stat::detail::hit:
+			res = "hit";
+			break;
+		case rai::stat::detail::miss:
+			res = "miss";
+			break;
+		case rai::stat::detail::eviction:
+			res = "eviction";
+			break;
+		case rai::stat::detail::live:
+			res = "live";
+			break;
+		case rai::stat::detail::forced:
+			res = "forced";
+			break;
+		case rai::stat::detail::local:
+			res = "local";
+			break;
+		case rai::stat::detail::bootstrap:
+			res = "bootstrap";
+			break;
+		case rai::stat::detail::vote_signed:
+			res = "vote_signed";
+			break;
+		case rai::stat::detail::bytes_sent:
+			res = "bytes_sent";
+			break;
+		case rai::stat::detail::overflow:
+			res = "overflow";
+			break;
+		case rai::stat::detail::failure:
+			res = "failure";
+			break;
+		case rai::stat::detail::retry:
+			res = "retry";
+			break;
+		case rai::stat::detail::queue:
+			res = "queue";
+			break;
+		case rai::stat::detail::queue_size:
+			res = "queue_size";
+			break;
+		case rai::stat::detail::reconnect:
+			res = "reconnect";
+			break;
 	}
 	return res;
 }
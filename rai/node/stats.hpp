@@ -95,7 +95,7 @@ public:
 	/** Value within the current sample interval */
 	stat_datapoint sample_current;
 
-	/** Counting value for this entry, including the time of last update. This is never reset and only increases. */
+	/** Counting value for this entry, including the time of last update. This is never reset and only increases, unless the entry is a gauge set with stat::set. */
 	stat_datapoint counter;
 
 	/** Zero or more observers for samples. Called at the end of the sample interval. */
@@ -184,7 +184,16 @@ public:
 		rollback,
 		bootstrap,
 		vote,
-		peering
+		peering,
+		signature,
+		receive_socket,
+		account_cache,
+		block_processor,
+		block_processor_latency,
+		vote_generator,
+		websocket,
+		http_callback,
+		http_callback_latency
 	};
 
 	/** Optional detail type */
@@ -219,6 +228,9 @@ public:
 		bulk_pull_account,
 		bulk_pull_blocks,
 		frontier_req,
+		blocks_sent,
+		send_time_ms,
+		backpressure,
 
 		// vote specific
 		vote_valid,
@@ -227,6 +239,52 @@ public:
 
 		// peering
 		handshake,
+
+		// signature verification specific
+		batch,
+		batch_size,
+		batch_rejected,
+
+		// receive socket specific, one per socket index
+		socket_0,
+		socket_1,
+		socket_2,
+		socket_3,
+		socket_4,
+		socket_5,
+		socket_6,
+		socket_7,
+		socket_8,
+		socket_9,
+		socket_10,
+		socket_11,
+		socket_12,
+		socket_13,
+		socket_14,
+		socket_15,
+
+		// cache specific
+		hit,
+		miss,
+		eviction,
+
+		// block processor queue specific, one per rai::block_queue
+		live,
+		forced,
+		local,
+		bootstrap,
+
+		// vote generator specific
+		vote_signed,
+		bytes_sent,
+		overflow,
+
+		// http callback specific
+		failure,
+		retry,
+		queue,
+		queue_size,
+		reconnect,
 	};
 
 	/** Direction of the stat. If the direction is irrelevant, use in */
@@ -313,6 +371,12 @@ public:
 		}
 	}
 
+	/**
+	 * Set the counter of a gauge, such as the current size of a queue, to \p value.
+	 * Gauges are only ever set, not added to, and are not sampled or aggregated at the type level.
+	 */
+	void set (stat::type type, stat::detail detail, stat::dir dir, uint64_t value);
+
 	/**
 	 * Add a sampling observer for a given counter.
 	 * The observer receives a snapshot of the current sampling. Accessing the sample buffer is thus thread safe.
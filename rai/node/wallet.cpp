@@ -825,6 +825,7 @@ bool rai::wallet::enter_password (rai::transaction & transaction, std::string co
 			this_l->search_pending ();
 		});
 	}
+	node.wallets.compute_reps (transaction);
 	lock_observer (result, password_a.empty ());
 	return result;
 }
@@ -842,6 +843,7 @@ rai::public_key rai::wallet::deterministic_insert (MDB_txn * transaction_a, bool
 	if (store.valid_password (transaction_a))
 	{
 		key = store.deterministic_insert (transaction_a);
+		node.wallets.reps_insert (transaction_a, key);
 		if (generate_work_a)
 		{
 			work_ensure (key, key);
@@ -863,6 +865,7 @@ rai::public_key rai::wallet::insert_adhoc (MDB_txn * transaction_a, rai::raw_key
 	if (store.valid_password (transaction_a))
 	{
 		key = store.insert_adhoc (transaction_a, key_a);
+		node.wallets.reps_insert (transaction_a, key);
 		if (generate_work_a)
 		{
 			work_ensure (key, node.ledger.latest_root (transaction_a, key));
@@ -910,6 +913,7 @@ bool rai::wallet::import (std::string const & json_a, std::string const & passwo
 		error = store.import (transaction, *temp);
 	}
 	temp->destroy (transaction);
+	node.wallets.compute_reps (transaction);
 	return error;
 }
 
@@ -995,7 +999,7 @@ std::shared_ptr<rai::block> rai::wallet::receive_action (rai::block const & send
 		{
 			node.work_generate_blocking (*block);
 		}
-		node.process_active (block);
+		node.process_active (block, rai::block_queue::local);
 		node.block_processor.flush ();
 		if (generate_work_a)
 		{
@@ -1035,7 +1039,7 @@ std::shared_ptr<rai::block> rai::wallet::change_action (rai::account const & sou
 		{
 			node.work_generate_blocking (*block);
 		}
-		node.process_active (block);
+		node.process_active (block, rai::block_queue::local);
 		node.block_processor.flush ();
 		if (generate_work_a)
 		{
@@ -1118,7 +1122,7 @@ std::shared_ptr<rai::block> rai::wallet::send_action (rai::account const & sourc
 		{
 			node.work_generate_blocking (*block);
 		}
-		node.process_active (block);
+		node.process_active (block, rai::block_queue::local);
 		node.block_processor.flush ();
 		if (generate_work_a)
 		{
@@ -1161,7 +1165,7 @@ std::shared_ptr<rai::block> rai::wallet::add_comment_action (rai::account const
 		{
 			node.work_generate_blocking (*block);
 		}
-		node.process_active (block);
+		node.process_active (block, rai::block_queue::local);
 		node.block_processor.flush ();
 		if (generate_work_a)
 		{
@@ -1349,7 +1353,8 @@ rai::public_key rai::wallet::change_seed (MDB_txn * transaction_a, rai::raw_key
 		// Generate work for first 4 accounts only to prevent weak CPU nodes stuck
 		account = deterministic_insert (transaction_a, i < 4);
 	}
-
+	// Keys derived from the replaced seed are gone from the wallet
+	node.wallets.compute_reps (transaction_a);
 	return account;
 }
 
@@ -1370,6 +1375,7 @@ void rai::wallet::work_cache_blocking (rai::account const & account_a, rai::bloc
 
 rai::wallets::wallets (bool & error_a, rai::node & node_a) :
 observer ([](bool) {}),
+reps_locked_count (0),
 node (node_a),
 stopped (false),
 thread ([this]() { do_wallet_actions (); }),
@@ -1405,6 +1411,7 @@ handle (0)
 	{
 		i->second->enter_initial_password ();
 	}
+	compute_reps ();
 }
 
 rai::wallets::~wallets ()
@@ -1434,7 +1441,10 @@ std::shared_ptr<rai::wallet> rai::wallets::create (rai::uint256_union const & id
 	}
 	if (!error)
 	{
-		items[id_a] = result;
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			items[id_a] = result;
+		}
 		result->enter_initial_password ();
 	}
 	return result;
@@ -1464,11 +1474,16 @@ void rai::wallets::search_pending_all ()
 void rai::wallets::destroy (rai::uint256_union const & id_a)
 {
 	rai::transaction transaction (node.store.environment, nullptr, true);
-	auto existing (items.find (id_a));
-	assert (existing != items.end ());
-	auto wallet (existing->second);
-	items.erase (existing);
+	std::shared_ptr<rai::wallet> wallet;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		auto existing (items.find (id_a));
+		assert (existing != items.end ());
+		wallet = existing->second;
+		items.erase (existing);
+	}
 	wallet->store.destroy (transaction);
+	compute_reps (transaction);
 }
 
 void rai::wallets::do_wallet_actions ()
@@ -1503,35 +1518,139 @@ void rai::wallets::queue_wallet_action (rai::amount_t const & amount_a, std::fun
 
 void rai::wallets::foreach_representative (MDB_txn * transaction_a, std::function<void(rai::public_key const & pub_a, rai::raw_key const & prv_a)> const & action_a)
 {
-	for (auto i (items.begin ()), n (items.end ()); i != n; ++i)
+	std::vector<std::pair<rai::public_key, rai::raw_key>> reps_l;
+	{
+		std::lock_guard<std::mutex> lock (reps_mutex);
+		reps_l.assign (reps.begin (), reps.end ());
+	}
+	for (auto & i : reps_l)
+	{
+		// Weight moved away since the key was cached
+		if (node.ledger.weight (transaction_a, i.first) != 0)
+		{
+			action_a (i.first, i.second);
+		}
+	}
+}
+
+void rai::wallets::compute_reps ()
+{
+	rai::transaction transaction (node.store.environment, nullptr, false);
+	compute_reps (transaction);
+}
+
+void rai::wallets::compute_reps (MDB_txn * transaction_a)
+{
+	std::unordered_map<rai::public_key, rai::raw_key> reps_l;
+	std::unordered_set<rai::account> accounts_l;
+	size_t locked_count (0);
+	auto items_l (items_get ());
+	for (auto i (items_l.begin ()), n (items_l.end ()); i != n; ++i)
 	{
 		auto & wallet (*i->second);
+		auto valid (wallet.store.valid_password (transaction_a));
+		size_t wallet_locked_count (0);
 		for (auto j (wallet.store.begin (transaction_a)), m (wallet.store.end ()); j != m; ++j)
 		{
 			rai::account account (j->first.uint256 ());
+			accounts_l.insert (account);
 			if (node.ledger.weight (transaction_a, account) != 0)
 			{
-				if (wallet.store.valid_password (transaction_a))
+				if (valid)
 				{
 					rai::raw_key prv;
-					auto error (wallet.store.fetch (transaction_a, j->first.uint256 (), prv));
+					auto error (wallet.store.fetch (transaction_a, account, prv));
 					assert (!error);
-					action_a (j->first.uint256 (), prv);
+					reps_l[account] = prv;
 				}
 				else
 				{
-					static auto last_log = std::chrono::steady_clock::time_point ();
-					if (last_log < std::chrono::steady_clock::now () - std::chrono::seconds (60))
+					++wallet_locked_count;
+				}
+			}
+		}
+		if (wallet_locked_count > 0)
+		{
+			BOOST_LOG (node.log) << boost::str (boost::format ("%1% representatives locked inside wallet %2%") % wallet_locked_count % i->first.to_string ());
+			locked_count += wallet_locked_count;
+		}
+	}
+	std::lock_guard<std::mutex> lock (reps_mutex);
+	reps.swap (reps_l);
+	accounts.swap (accounts_l);
+	reps_locked_count = locked_count;
+}
+
+void rai::wallets::reps_insert (MDB_txn * transaction_a, rai::account const & account_a)
+{
+	{
+		std::lock_guard<std::mutex> lock (reps_mutex);
+		accounts.insert (account_a);
+	}
+	reps_update (transaction_a, account_a);
+}
+
+void rai::wallets::reps_update (MDB_txn * transaction_a, rai::account const & account_a)
+{
+	bool search;
+	{
+		std::lock_guard<std::mutex> lock (reps_mutex);
+		search = accounts.find (account_a) != accounts.end () && reps.find (account_a) == reps.end ();
+	}
+	if (search && node.ledger.weight (transaction_a, account_a) != 0)
+	{
+		auto items_l (items_get ());
+		for (auto i (items_l.begin ()), n (items_l.end ()); i != n; ++i)
+		{
+			auto & wallet (*i->second);
+			if (wallet.store.exists (transaction_a, account_a))
+			{
+				if (wallet.store.valid_password (transaction_a))
+				{
+					rai::raw_key prv;
+					auto error (wallet.store.fetch (transaction_a, account_a, prv));
+					if (!error)
 					{
-						last_log = std::chrono::steady_clock::now ();
-						BOOST_LOG (node.log) << boost::str (boost::format ("Representative locked inside wallet %1%") % i->first.to_string ());
+						std::lock_guard<std::mutex> lock (reps_mutex);
+						reps[account_a] = prv;
 					}
 				}
+				break;
 			}
 		}
 	}
 }
 
+std::unordered_map<rai::uint256_union, std::shared_ptr<rai::wallet>> rai::wallets::items_get ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return items;
+}
+
+std::vector<std::pair<rai::account, rai::amount_t>> rai::wallets::reps_list (MDB_txn * transaction_a)
+{
+	std::vector<std::pair<rai::account, rai::amount_t>> result;
+	foreach_representative (transaction_a, [this, &result, transaction_a](rai::public_key const & pub_a, rai::raw_key const &) {
+		result.push_back (std::make_pair (pub_a, node.ledger.weight (transaction_a, pub_a)));
+	});
+	std::sort (result.begin (), result.end (), [](std::pair<rai::account, rai::amount_t> const & a, std::pair<rai::account, rai::amount_t> const & b) {
+		return a.second > b.second;
+	});
+	return result;
+}
+
+size_t rai::wallets::reps_locked ()
+{
+	std::lock_guard<std::mutex> lock (reps_mutex);
+	return reps_locked_count;
+}
+
+bool rai::wallets::have_reps ()
+{
+	std::lock_guard<std::mutex> lock (reps_mutex);
+	return !reps.empty ();
+}
+
 bool rai::wallets::exists (MDB_txn * transaction_a, rai::public_key const & account_a)
 {
 	auto result (false);
@@ -179,10 +179,31 @@ public:
 	void do_wallet_actions ();
 	void queue_wallet_action (rai::amount_t const &, std::function<void()> const &);
 	void foreach_representative (MDB_txn *, std::function<void(rai::public_key const &, rai::raw_key const &)> const &);
+	// Rebuilds the representative key cache from every unlocked wallet, after a wallet is locked, unlocked, imported or removed
+	void compute_reps ();
+	void compute_reps (MDB_txn *);
+	// Adds the account to the representative key cache if it is in an unlocked wallet and has voting weight
+	void reps_update (MDB_txn *, rai::account const &);
+	// Records an account just inserted into a wallet, then updates the representative key cache for it
+	void reps_insert (MDB_txn *, rai::account const &);
+	// Copy of items taken under mutex, safe to iterate from any thread
+	std::unordered_map<rai::uint256_union, std::shared_ptr<rai::wallet>> items_get ();
+	// Cached representatives with their current weight, highest first
+	std::vector<std::pair<rai::account, rai::amount_t>> reps_list (MDB_txn *);
+	size_t reps_locked ();
+	// Whether the node holds a key with voting weight, it only answers confirm_req if so
+	bool have_reps ();
 	bool exists (MDB_txn *, rai::public_key const &);
 	void stop ();
 	std::function<void(bool)> observer;
 	std::unordered_map<rai::uint256_union, std::shared_ptr<rai::wallet>> items;
+	// Decrypted keys of wallet accounts with voting weight, used for vote generation
+	std::unordered_map<rai::public_key, rai::raw_key> reps;
+	// Every account in every wallet, so reps_update only searches the wallets for our own accounts
+	std::unordered_set<rai::account> accounts;
+	// Accounts with voting weight found in locked wallets on the last rebuild
+	size_t reps_locked_count;
+	std::mutex reps_mutex;
 	std::multimap<rai::amount_t, std::function<void()>, std::greater<rai::amount_t>> actions;
 	std::mutex mutex;
 	std::condition_variable condition;
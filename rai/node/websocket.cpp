@@ -0,0 +1,493 @@
+#include <rai/node/websocket.hpp>
+
+#include <rai/node/node.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <algorithm>
+
+rai::websocket_config::websocket_config () :
+enable (false),
+address (boost::asio::ip::address_v6::loopback ()),
+port (websocket_port),
+max_queue (1024),
+stats_interval (10)
+{
+}
+
+void rai::websocket_config::serialize_json (boost::property_tree::ptree & tree_a) const
+{
+	tree_a.put ("enable", enable);
+	tree_a.put ("address", address.to_string ());
+	tree_a.put ("port", std::to_string (port));
+	tree_a.put ("max_queue", std::to_string (max_queue));
+	tree_a.put ("stats_interval", std::to_string (stats_interval));
+}
+
+bool rai::websocket_config::deserialize_json (boost::property_tree::ptree const & tree_a)
+{
+	auto result (false);
+	try
+	{
+		enable = tree_a.get<bool> ("enable");
+		auto address_l (tree_a.get<std::string> ("address"));
+		auto port_l (tree_a.get<std::string> ("port"));
+		auto max_queue_l (tree_a.get<std::string> ("max_queue"));
+		auto stats_interval_l (tree_a.get<std::string> ("stats_interval"));
+		try
+		{
+			auto port_number (std::stoul (port_l));
+			result |= port_number > std::numeric_limits<uint16_t>::max ();
+			port = port_number;
+			max_queue = std::stoul (max_queue_l);
+			stats_interval = std::stoul (stats_interval_l);
+			result |= max_queue == 0;
+			result |= stats_interval == 0;
+		}
+		catch (std::logic_error const &)
+		{
+			result = true;
+		}
+		boost::system::error_code ec;
+		address = boost::asio::ip::address_v6::from_string (address_l, ec);
+		result |= !!ec;
+	}
+	catch (std::runtime_error const &)
+	{
+		result = true;
+	}
+	return result;
+}
+
+std::string rai::to_string (rai::websocket_topic topic_a)
+{
+	std::string result;
+	switch (topic_a)
+	{
+		case rai::websocket_topic::confirmation:
+			result = "confirmation";
+			break;
+		case rai::websocket_topic::vote:
+			result = "vote";
+			break;
+		case rai::websocket_topic::stats:
+			result = "stats";
+			break;
+		case rai::websocket_topic::invalid:
+			result = "invalid";
+			break;
+	}
+	return result;
+}
+
+rai::websocket_topic rai::websocket_topic_from_string (std::string const & topic_a)
+{
+	auto result (rai::websocket_topic::invalid);
+	if (topic_a == "confirmation")
+	{
+		result = rai::websocket_topic::confirmation;
+	}
+	else if (topic_a == "vote")
+	{
+		result = rai::websocket_topic::vote;
+	}
+	else if (topic_a == "stats")
+	{
+		result = rai::websocket_topic::stats;
+	}
+	return result;
+}
+
+rai::websocket_session::websocket_session (rai::websocket_server & server_a, boost::asio::ip::tcp::socket socket_a) :
+server (server_a),
+ws (std::move (socket_a)),
+strand (server_a.node.service),
+writing (false),
+closed (false)
+{
+}
+
+void rai::websocket_session::start ()
+{
+	auto this_l (shared_from_this ());
+	ws.async_accept (strand.wrap ([this_l](boost::system::error_code const & ec) {
+		if (!ec)
+		{
+			this_l->read ();
+		}
+		else
+		{
+			BOOST_LOG (this_l->server.node.log) << "WebSocket handshake error: " << ec.message ();
+			this_l->close ();
+		}
+	}));
+}
+
+void rai::websocket_session::read ()
+{
+	auto this_l (shared_from_this ());
+	ws.async_read (buffer, strand.wrap ([this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		if (!ec)
+		{
+			auto text (boost::beast::buffers_to_string (this_l->buffer.data ()));
+			this_l->buffer.consume (this_l->buffer.size ());
+			this_l->handle (text);
+			this_l->read ();
+		}
+		else
+		{
+			if (ec != boost::beast::websocket::error::closed && ec != boost::asio::error::operation_aborted)
+			{
+				BOOST_LOG (this_l->server.node.log) << "WebSocket read error: " << ec.message ();
+			}
+			this_l->close ();
+		}
+	}));
+}
+
+void rai::websocket_session::handle (std::string const & text_a)
+{
+	boost::property_tree::ptree response;
+	try
+	{
+		boost::property_tree::ptree request;
+		std::stringstream istream (text_a);
+		boost::property_tree::read_json (istream, request);
+		auto action (request.get<std::string> ("action"));
+		auto topic_text (request.get<std::string> ("topic"));
+		auto topic (rai::websocket_topic_from_string (topic_text));
+		response.put ("ack", action);
+		response.put ("topic", topic_text);
+		if (topic == rai::websocket_topic::invalid)
+		{
+			response.put ("error", "Unknown topic");
+		}
+		else if (action == "subscribe")
+		{
+			std::unordered_set<rai::account> accounts;
+			auto accounts_l (request.get_child_optional ("options.accounts"));
+			if (accounts_l)
+			{
+				for (auto & i : *accounts_l)
+				{
+					rai::account account;
+					if (!account.decode_account (i.second.data ()))
+					{
+						accounts.insert (account);
+					}
+					else
+					{
+						response.put ("error", "Bad account number");
+					}
+				}
+			}
+			if (!response.get_optional<std::string> ("error"))
+			{
+				std::lock_guard<std::mutex> lock (mutex);
+				subscriptions[topic] = std::move (accounts);
+			}
+		}
+		else if (action == "unsubscribe")
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			subscriptions.erase (topic);
+		}
+		else
+		{
+			response.put ("error", "Unknown action");
+		}
+	}
+	catch (std::runtime_error const &)
+	{
+		response.put ("error", "Unable to parse JSON");
+	}
+	std::stringstream ostream;
+	boost::property_tree::write_json (ostream, response);
+	push (std::make_shared<std::string> (ostream.str ()));
+}
+
+bool rai::websocket_session::subscribed (rai::websocket_topic topic_a, std::vector<rai::account> const & accounts_a)
+{
+	auto result (false);
+	std::lock_guard<std::mutex> lock (mutex);
+	auto existing (subscriptions.find (topic_a));
+	if (existing != subscriptions.end ())
+	{
+		auto & filter (existing->second);
+		// Events without accounts, such as stats, go to every subscriber
+		result = filter.empty () || accounts_a.empty () || std::any_of (accounts_a.begin (), accounts_a.end (), [&filter](rai::account const & account_a) { return filter.find (account_a) != filter.end (); });
+	}
+	return result;
+}
+
+void rai::websocket_session::push (std::shared_ptr<std::string> const & message_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	if (!closed)
+	{
+		if (queue.size () < server.config.max_queue)
+		{
+			queue.push_back (message_a);
+			if (!writing)
+			{
+				writing = true;
+				auto this_l (shared_from_this ());
+				strand.post ([this_l]() {
+					this_l->write_next ();
+				});
+			}
+		}
+		else
+		{
+			// Dropping messages instead would leave the client with gaps it can't detect
+			server.node.stats.inc (rai::stat::type::websocket, rai::stat::detail::overflow, rai::stat::dir::out);
+			BOOST_LOG (server.node.log) << "WebSocket client is too slow, disconnecting";
+			queue.clear ();
+			stop ();
+		}
+	}
+}
+
+void rai::websocket_session::stop ()
+{
+	auto this_l (shared_from_this ());
+	strand.post ([this_l]() {
+		this_l->close ();
+	});
+}
+
+void rai::websocket_session::write_next ()
+{
+	std::shared_ptr<std::string> message;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		if (!closed && !queue.empty ())
+		{
+			// Left queued until written so the queue bounds what the client hasn't received
+			message = queue.front ();
+		}
+		else
+		{
+			writing = false;
+		}
+	}
+	if (message != nullptr)
+	{
+		auto this_l (shared_from_this ());
+		ws.text (true);
+		ws.async_write (boost::asio::buffer (*message), strand.wrap ([this_l, message](boost::system::error_code const & ec, size_t bytes_transferred) {
+			this_l->written (ec, bytes_transferred);
+		}));
+	}
+}
+
+void rai::websocket_session::written (boost::system::error_code const & ec, size_t bytes_transferred)
+{
+	if (!ec)
+	{
+		server.node.stats.add (rai::stat::type::websocket, rai::stat::detail::bytes_sent, rai::stat::dir::out, bytes_transferred);
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			if (!queue.empty ())
+			{
+				queue.pop_front ();
+			}
+		}
+		write_next ();
+	}
+	else
+	{
+		close ();
+	}
+}
+
+void rai::websocket_session::close ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		closed = true;
+		writing = false;
+		queue.clear ();
+		subscriptions.clear ();
+	}
+	auto & socket (ws.next_layer ());
+	if (socket.is_open ())
+	{
+		boost::system::error_code ec;
+		socket.shutdown (boost::asio::ip::tcp::socket::shutdown_both, ec);
+		socket.close (ec);
+	}
+}
+
+rai::websocket_server::websocket_server (rai::node & node_a, rai::websocket_config const & config_a) :
+node (node_a),
+config (config_a),
+acceptor (node_a.service),
+stopped (false)
+{
+}
+
+void rai::websocket_server::start ()
+{
+	auto endpoint (rai::tcp_endpoint (config.address, config.port));
+	acceptor.open (endpoint.protocol ());
+	acceptor.set_option (boost::asio::ip::tcp::acceptor::reuse_address (true));
+	boost::system::error_code ec;
+	acceptor.bind (endpoint, ec);
+	if (ec)
+	{
+		BOOST_LOG (node.log) << boost::str (boost::format ("Error while binding for WebSocket on port %1%: %2%") % endpoint.port () % ec.message ());
+		throw std::runtime_error (ec.message ());
+	}
+	acceptor.listen ();
+	accept ();
+	ongoing_stats ();
+}
+
+void rai::websocket_server::accept ()
+{
+	auto socket (std::make_shared<boost::asio::ip::tcp::socket> (node.service));
+	auto this_l (shared_from_this ());
+	acceptor.async_accept (*socket, [this_l, socket](boost::system::error_code const & ec) {
+		if (!ec)
+		{
+			auto session (std::make_shared<rai::websocket_session> (*this_l, std::move (*socket)));
+			{
+				std::lock_guard<std::mutex> lock (this_l->mutex);
+				this_l->sessions.erase (std::remove_if (this_l->sessions.begin (), this_l->sessions.end (), [](std::weak_ptr<rai::websocket_session> const & session_a) { return session_a.expired (); }), this_l->sessions.end ());
+				this_l->sessions.push_back (session);
+			}
+			session->start ();
+			this_l->accept ();
+		}
+		else if (ec != boost::asio::error::operation_aborted)
+		{
+			BOOST_LOG (this_l->node.log) << boost::str (boost::format ("Error accepting WebSocket connections: %1%") % ec.message ());
+		}
+	});
+}
+
+void rai::websocket_server::stop ()
+{
+	std::vector<std::shared_ptr<rai::websocket_session>> sessions_l;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		stopped = true;
+		for (auto & i : sessions)
+		{
+			if (auto session = i.lock ())
+			{
+				sessions_l.push_back (session);
+			}
+		}
+		sessions.clear ();
+	}
+	boost::system::error_code ec;
+	acceptor.close (ec);
+	for (auto & i : sessions_l)
+	{
+		i->stop ();
+	}
+}
+
+size_t rai::websocket_server::size ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return std::count_if (sessions.begin (), sessions.end (), [](std::weak_ptr<rai::websocket_session> const & session_a) { return !session_a.expired (); });
+}
+
+void rai::websocket_server::broadcast (rai::websocket_topic topic_a, std::vector<rai::account> const & accounts_a, std::function<void(boost::property_tree::ptree &)> const & message_a)
+{
+	std::vector<std::shared_ptr<rai::websocket_session>> sessions_l;
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		for (auto & i : sessions)
+		{
+			auto session (i.lock ());
+			if (session != nullptr && session->subscribed (topic_a, accounts_a))
+			{
+				sessions_l.push_back (session);
+			}
+		}
+	}
+	if (!sessions_l.empty ())
+	{
+		boost::property_tree::ptree message_l;
+		message_a (message_l);
+		boost::property_tree::ptree envelope;
+		envelope.put ("topic", rai::to_string (topic_a));
+		envelope.put ("time", std::to_string (std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::system_clock::now ().time_since_epoch ()).count ()));
+		envelope.add_child ("message", message_l);
+		std::stringstream ostream;
+		boost::property_tree::write_json (ostream, envelope);
+		auto text (std::make_shared<std::string> (ostream.str ()));
+		for (auto & i : sessions_l)
+		{
+			i->push (text);
+		}
+		node.stats.add (rai::stat::type::websocket, rai::stat::dir::out, sessions_l.size ());
+	}
+}
+
+void rai::websocket_server::confirmation (std::shared_ptr<rai::block> block_a, rai::account const & account_a, rai::amount_t const & amount_a, bool is_state_send_a)
+{
+	std::vector<rai::account> accounts ({ account_a });
+	if (is_state_send_a)
+	{
+		if (auto state = dynamic_cast<rai::state_block *> (block_a.get ()))
+		{
+			accounts.push_back (state->link ());
+		}
+	}
+	broadcast (rai::websocket_topic::confirmation, accounts, [&](boost::property_tree::ptree & message_a) {
+		// Same fields as the HTTP callback
+		message_a.put ("account", account_a.to_account ());
+		message_a.put ("hash", block_a->hash ().to_string ());
+		std::string block_text;
+		block_a->serialize_json (block_text);
+		message_a.put ("block", block_text);
+		message_a.put ("amount", rai::amount (amount_a).to_string_dec ());
+		if (is_state_send_a)
+		{
+			message_a.put ("is_send", is_state_send_a);
+		}
+	});
+}
+
+void rai::websocket_server::vote (std::shared_ptr<rai::vote> vote_a)
+{
+	broadcast (rai::websocket_topic::vote, { vote_a->account }, [&vote_a](boost::property_tree::ptree & message_a) {
+		message_a.put ("account", vote_a->account.to_account ());
+		message_a.put ("sequence", std::to_string (vote_a->sequence));
+		boost::property_tree::ptree blocks;
+		for (auto hash : *vote_a)
+		{
+			boost::property_tree::ptree entry;
+			entry.put ("", hash.to_string ());
+			blocks.push_back (std::make_pair ("", entry));
+		}
+		message_a.add_child ("blocks", blocks);
+	});
+}
+
+void rai::websocket_server::ongoing_stats ()
+{
+	auto node_l (node.shared ());
+	broadcast (rai::websocket_topic::stats, {}, [&node_l](boost::property_tree::ptree & message_a) {
+		auto sink (node_l->stats.log_sink_json ());
+		node_l->stats.log_counters (*sink);
+		message_a = *static_cast<boost::property_tree::ptree *> (sink->to_object ());
+	});
+	std::weak_ptr<rai::websocket_server> server_w (shared_from_this ());
+	node.alarm.add (std::chrono::steady_clock::now () + std::chrono::seconds (config.stats_interval), [server_w]() {
+		if (auto server_l = server_w.lock ())
+		{
+			std::unique_lock<std::mutex> lock (server_l->mutex);
+			if (!server_l->stopped)
+			{
+				lock.unlock ();
+				server_l->ongoing_stats ();
+			}
+		}
+	});
+}
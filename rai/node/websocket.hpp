@@ -0,0 +1,105 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <rai/secure/common.hpp>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+namespace rai
+{
+class node;
+/** Configuration options for the WebSocket push server */
+class websocket_config
+{
+public:
+	websocket_config ();
+	void serialize_json (boost::property_tree::ptree &) const;
+	bool deserialize_json (boost::property_tree::ptree const &);
+	bool enable;
+	boost::asio::ip::address_v6 address;
+	uint16_t port;
+	/** Messages queued for a client before it is disconnected as too slow */
+	size_t max_queue;
+	/** Seconds between messages on the stats topic */
+	unsigned stats_interval;
+	static uint16_t const websocket_port = rai::rai_network == rai::rai_networks::rai_live_network ? 7044 : 54400;
+};
+enum class websocket_topic
+{
+	invalid,
+	// Blocks as they are confirmed, optionally filtered by account or send destination
+	confirmation,
+	// Votes as they are processed, optionally filtered by representative
+	vote,
+	// Node counters every stats_interval seconds
+	stats
+};
+std::string to_string (rai::websocket_topic);
+rai::websocket_topic websocket_topic_from_string (std::string const &);
+class websocket_server;
+/**
+ * A WebSocket client. Clients send {"action": "subscribe", "topic": ..., "options": {"accounts": [...]}} and "unsubscribe" requests,
+ * and receive {"topic": ..., "time": ..., "message": {...}} for each matching event.
+ * Outgoing messages are queued up to max_queue; a client that falls further behind is disconnected rather than silently missing events.
+ */
+class websocket_session : public std::enable_shared_from_this<rai::websocket_session>
+{
+public:
+	websocket_session (rai::websocket_server &, boost::asio::ip::tcp::socket);
+	void start ();
+	// Returns true if the session subscribes to the topic with a filter matching any of the accounts
+	bool subscribed (rai::websocket_topic, std::vector<rai::account> const &);
+	// Queues the message, closing the session instead if its queue is full
+	void push (std::shared_ptr<std::string> const &);
+	// Closes the session on its strand, for callers outside of it
+	void stop ();
+	void close ();
+	rai::websocket_server & server;
+
+private:
+	void read ();
+	void handle (std::string const &);
+	void write_next ();
+	void written (boost::system::error_code const &, size_t);
+	boost::beast::websocket::stream<boost::asio::ip::tcp::socket> ws;
+	boost::asio::io_service::strand strand;
+	boost::beast::flat_buffer buffer;
+	std::mutex mutex;
+	// Accounts each topic is filtered to, an empty set matches every event
+	std::map<rai::websocket_topic, std::unordered_set<rai::account>> subscriptions;
+	std::deque<std::shared_ptr<std::string>> queue;
+	bool writing;
+	bool closed;
+};
+/** Accepts WebSocket clients and pushes node events to the ones subscribed */
+class websocket_server : public std::enable_shared_from_this<rai::websocket_server>
+{
+public:
+	websocket_server (rai::node &, rai::websocket_config const &);
+	void start ();
+	void stop ();
+	void confirmation (std::shared_ptr<rai::block>, rai::account const &, rai::amount_t const &, bool);
+	void vote (std::shared_ptr<rai::vote>);
+	// The message is built once, and only if a session matches
+	void broadcast (rai::websocket_topic, std::vector<rai::account> const &, std::function<void(boost::property_tree::ptree &)> const &);
+	size_t size ();
+	rai::node & node;
+	rai::websocket_config config;
+	boost::asio::ip::tcp::acceptor acceptor;
+
+private:
+	void accept ();
+	void ongoing_stats ();
+	std::mutex mutex;
+	std::vector<std::weak_ptr<rai::websocket_session>> sessions;
+	bool stopped;
+};
+}
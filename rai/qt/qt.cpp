@@ -1585,6 +1585,7 @@ wallet (wallet_a)
 			rai::raw_key empty;
 			empty.data.clear ();
 			this->wallet.wallet_m->store.password.value_set (empty);
+			this->wallet.node.wallets.compute_reps (transaction);
 			update_locked (true, true);
 			lock_toggle->setText ("Unlock");
 			password->setEnabled (1);
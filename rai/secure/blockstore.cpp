@@ -1,7 +1,11 @@
 #include <queue>
+#include <unordered_set>
+#include <rai/node/stats.hpp>
 #include <rai/secure/blockstore.hpp>
 #include <rai/secure/versioning.hpp>
 
+#include <boost/algorithm/string.hpp>
+
 namespace
 {
 /**
@@ -44,6 +48,24 @@ public:
 	MDB_txn * transaction;
 	rai::block_store & store;
 };
+
+uint64_t seconds_since_epoch ()
+{
+	return std::chrono::duration_cast<std::chrono::seconds> (std::chrono::system_clock::now ().time_since_epoch ()).count ();
+}
+
+// Big endian arrival first so the index iterates oldest first
+std::array<uint8_t, 72> unchecked_arrival_key (uint64_t arrival_a, rai::unchecked_key const & key_a)
+{
+	std::array<uint8_t, 72> result;
+	for (auto i (0); i < 8; ++i)
+	{
+		result[7 - i] = static_cast<uint8_t> (arrival_a >> (8 * i));
+	}
+	std::copy (key_a.dependency.bytes.begin (), key_a.dependency.bytes.end (), result.begin () + 8);
+	std::copy (key_a.hash.bytes.begin (), key_a.hash.bytes.end (), result.begin () + 40);
+	return result;
+}
 }
 
 std::pair<rai::mdb_val, rai::mdb_val> * rai::store_iterator::operator-> ()
@@ -194,6 +216,18 @@ rai::store_iterator rai::block_store::representation_end ()
 	return result;
 }
 
+rai::store_iterator rai::block_store::delegators_begin (MDB_txn * transaction_a, rai::account const & representative_a)
+{
+	rai::store_iterator result (transaction_a, delegators, rai::mdb_val (representative_a));
+	return result;
+}
+
+rai::store_iterator rai::block_store::delegators_end ()
+{
+	rai::store_iterator result (nullptr);
+	return result;
+}
+
 rai::store_iterator rai::block_store::unchecked_begin (MDB_txn * transaction_a)
 {
 	rai::store_iterator result (transaction_a, unchecked);
@@ -202,7 +236,7 @@ rai::store_iterator rai::block_store::unchecked_begin (MDB_txn * transaction_a)
 
 rai::store_iterator rai::block_store::unchecked_begin (MDB_txn * transaction_a, rai::block_hash const & hash_a)
 {
-	rai::store_iterator result (transaction_a, unchecked, rai::mdb_val (hash_a));
+	rai::store_iterator result (transaction_a, unchecked, rai::unchecked_key (hash_a, 0).val ());
 	return result;
 }
 
@@ -224,8 +258,420 @@ rai::store_iterator rai::block_store::vote_end ()
 
 const MDB_dbi rai::block_store::invalid_db_handle;
 
-rai::block_store::block_store (bool & error_a, boost::filesystem::path const & path_a, int lmdb_max_dbs) :
+size_t constexpr rai::account_cache::shard_count;
+size_t constexpr rai::account_cache::default_size;
+size_t constexpr rai::block_store::unchecked_cache_max;
+
+rai::account_cache::overlay::overlay () :
+cleared (false)
+{
+}
+
+rai::account_cache::account_cache (rai::mdb_env & environment_a, size_t capacity_a) :
+capacity (capacity_a),
+stats (nullptr),
+environment (environment_a),
+generation_low (std::numeric_limits<uint64_t>::max ()),
+generation_high (0),
+hits (0),
+misses (0),
+evictions (0)
+{
+}
+
+rai::account_cache::shard & rai::account_cache::shard_for (rai::account const & account_a)
+{
+	return shards[account_a.qwords[0] % shard_count];
+}
+
+bool rai::account_cache::covers (uint64_t snapshot_a) const
+{
+	// Low is loaded first, a concurrent write back empties the range before touching any shard
+	auto low (generation_low.load ());
+	auto high (generation_high.load ());
+	return low <= snapshot_a && snapshot_a <= high;
+}
+
+bool rai::account_cache::get (MDB_txn * transaction_a, rai::account const & account_a, rai::account_info & info_a, bool & exists_a)
+{
+	bool result (true);
+	if (capacity > 0)
+	{
+		uint64_t id (mdb_txn_id (transaction_a));
+		auto write (id == environment.write_id);
+		if (write)
+		{
+			std::lock_guard<std::mutex> lock (pending_mutex);
+			auto existing (pending.find (id));
+			if (existing != pending.end ())
+			{
+				auto change (existing->second.changes.find (account_a));
+				if (change != existing->second.changes.end ())
+				{
+					exists_a = change->second != nullptr;
+					if (exists_a)
+					{
+						info_a = *change->second;
+					}
+					return false;
+				}
+			}
+		}
+		// Read transactions see the snapshot with their own id, a write transaction builds on the one before it
+		auto & shard (shard_for (account_a));
+		std::lock_guard<std::mutex> lock (shard.mutex);
+		if (covers (write ? id - 1 : id))
+		{
+			auto existing (shard.index.find (account_a));
+			if (existing != shard.index.end ())
+			{
+				shard.entries.splice (shard.entries.begin (), shard.entries, existing->second);
+				info_a = existing->second->second;
+				exists_a = true;
+				result = false;
+			}
+		}
+		if (result)
+		{
+			++misses;
+		}
+		else
+		{
+			++hits;
+		}
+	}
+	return result;
+}
+
+void rai::account_cache::insert_locked (rai::account_cache::shard & shard_a, rai::account const & account_a, rai::account_info const & info_a)
+{
+	auto existing (shard_a.index.find (account_a));
+	if (existing != shard_a.index.end ())
+	{
+		existing->second->second = info_a;
+		shard_a.entries.splice (shard_a.entries.begin (), shard_a.entries, existing->second);
+	}
+	else
+	{
+		shard_a.entries.emplace_front (account_a, info_a);
+		shard_a.index[account_a] = shard_a.entries.begin ();
+		if (shard_a.entries.size () > std::max<size_t> (capacity / shard_count, 1))
+		{
+			shard_a.index.erase (shard_a.entries.back ().first);
+			shard_a.entries.pop_back ();
+			++evictions;
+		}
+	}
+}
+
+void rai::account_cache::insert (MDB_txn * transaction_a, rai::account const & account_a, rai::account_info const & info_a)
+{
+	if (capacity > 0)
+	{
+		uint64_t id (mdb_txn_id (transaction_a));
+		auto write (id == environment.write_id);
+		if (write)
+		{
+			// Values read by a write transaction that already modified the account are not from a committed snapshot
+			std::lock_guard<std::mutex> lock (pending_mutex);
+			auto existing (pending.find (id));
+			if (existing != pending.end () && (existing->second.cleared || existing->second.changes.find (account_a) != existing->second.changes.end ()))
+			{
+				return;
+			}
+		}
+		auto & shard (shard_for (account_a));
+		std::lock_guard<std::mutex> lock (shard.mutex);
+		if (covers (write ? id - 1 : id))
+		{
+			insert_locked (shard, account_a, info_a);
+		}
+	}
+}
+
+void rai::account_cache::put (MDB_txn * transaction_a, rai::account const & account_a, rai::account_info const & info_a)
+{
+	if (capacity > 0)
+	{
+		std::lock_guard<std::mutex> lock (pending_mutex);
+		pending[mdb_txn_id (transaction_a)].changes[account_a] = std::make_unique<rai::account_info> (info_a);
+	}
+}
+
+void rai::account_cache::del (MDB_txn * transaction_a, rai::account const & account_a)
+{
+	if (capacity > 0)
+	{
+		std::lock_guard<std::mutex> lock (pending_mutex);
+		pending[mdb_txn_id (transaction_a)].changes[account_a] = nullptr;
+	}
+}
+
+void rai::account_cache::clear (MDB_txn * transaction_a)
+{
+	if (capacity > 0)
+	{
+		std::lock_guard<std::mutex> lock (pending_mutex);
+		auto & overlay (pending[mdb_txn_id (transaction_a)]);
+		overlay.changes.clear ();
+		overlay.cleared = true;
+	}
+}
+
+void rai::account_cache::commit (uint64_t id_a)
+{
+	if (capacity > 0)
+	{
+		std::lock_guard<std::mutex> commit_lock (commit_mutex);
+		rai::account_cache::overlay overlay;
+		{
+			std::lock_guard<std::mutex> lock (pending_mutex);
+			auto existing (pending.find (id_a));
+			if (existing != pending.end ())
+			{
+				overlay = std::move (existing->second);
+				pending.erase (existing);
+			}
+		}
+		// A write transaction without changes commits without creating a new snapshot
+		MDB_envinfo info;
+		auto status (mdb_env_info (environment, &info));
+		assert (status == 0);
+		auto based (covers (id_a - 1));
+		if (info.me_last_txnid != id_a)
+		{
+			assert (!overlay.cleared && overlay.changes.empty ());
+		}
+		else if (based && !overlay.cleared && overlay.changes.empty ())
+		{
+			// Nothing cached changed, the entries are also valid for this snapshot
+			generation_high = id_a;
+		}
+		else
+		{
+			// Empty the valid range so no reader trusts a shard while it is being written back
+			generation_low = std::numeric_limits<uint64_t>::max ();
+			for (auto & shard : shards)
+			{
+				std::lock_guard<std::mutex> lock (shard.mutex);
+				if (based && !overlay.cleared)
+				{
+					for (auto & change : overlay.changes)
+					{
+						if (&shard_for (change.first) == &shard)
+						{
+							if (change.second != nullptr)
+							{
+								insert_locked (shard, change.first, *change.second);
+							}
+							else
+							{
+								auto existing (shard.index.find (change.first));
+								if (existing != shard.index.end ())
+								{
+									shard.entries.erase (existing->second);
+									shard.index.erase (existing);
+								}
+							}
+						}
+					}
+				}
+				else
+				{
+					shard.entries.clear ();
+					shard.index.clear ();
+				}
+			}
+			generation_high = id_a;
+			generation_low = id_a;
+		}
+	}
+	flush_stats ();
+}
+
+void rai::account_cache::flush_stats ()
+{
+	if (stats != nullptr)
+	{
+		auto hits_l (hits.exchange (0));
+		auto misses_l (misses.exchange (0));
+		auto evictions_l (evictions.exchange (0));
+		if (hits_l > 0)
+		{
+			stats->add (rai::stat::type::account_cache, rai::stat::detail::hit, rai::stat::dir::in, hits_l);
+		}
+		if (misses_l > 0)
+		{
+			stats->add (rai::stat::type::account_cache, rai::stat::detail::miss, rai::stat::dir::in, misses_l);
+		}
+		if (evictions_l > 0)
+		{
+			stats->add (rai::stat::type::account_cache, rai::stat::detail::eviction, rai::stat::dir::in, evictions_l);
+		}
+	}
+}
+
+size_t rai::account_cache::size ()
+{
+	size_t result (0);
+	for (auto & shard : shards)
+	{
+		std::lock_guard<std::mutex> lock (shard.mutex);
+		result += shard.entries.size ();
+	}
+	return result;
+}
+
+rai::rep_weights::overlay::overlay () :
+cleared (false)
+{
+}
+
+rai::rep_weights::rep_weights (rai::block_store & store_a) :
+store (store_a),
+generation_low (std::numeric_limits<uint64_t>::max ()),
+generation_high (0)
+{
+}
+
+bool rai::rep_weights::covers (uint64_t snapshot_a) const
+{
+	return generation_low <= snapshot_a && snapshot_a <= generation_high;
+}
+
+bool rai::rep_weights::get (MDB_txn * transaction_a, rai::account const & account_a, rai::amount_t & weight_a)
+{
+	bool result (true);
+	uint64_t id (mdb_txn_id (transaction_a));
+	auto write (id == store.environment.write_id);
+	std::lock_guard<std::mutex> lock (mutex);
+	if (write)
+	{
+		auto existing (pending.find (id));
+		if (existing != pending.end ())
+		{
+			auto change (existing->second.changes.find (account_a));
+			if (change != existing->second.changes.end ())
+			{
+				weight_a = change->second;
+				return false;
+			}
+			if (existing->second.cleared)
+			{
+				return true;
+			}
+		}
+	}
+	if (covers (write ? id - 1 : id))
+	{
+		auto existing (weights.find (account_a));
+		weight_a = existing != weights.end () ? existing->second : 0;
+		result = false;
+	}
+	return result;
+}
+
+void rai::rep_weights::put (MDB_txn * transaction_a, rai::account const & account_a, rai::amount_t const & weight_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	pending[mdb_txn_id (transaction_a)].changes[account_a] = weight_a;
+}
+
+void rai::rep_weights::clear (MDB_txn * transaction_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	auto & overlay (pending[mdb_txn_id (transaction_a)]);
+	overlay.changes.clear ();
+	overlay.cleared = true;
+}
+
+void rai::rep_weights::set (rai::account const & account_a, rai::amount_t const & weight_a)
+{
+	auto existing (weights.find (account_a));
+	if (existing != weights.end ())
+	{
+		sorted.erase (std::make_pair (existing->second, account_a));
+		existing->second = weight_a;
+	}
+	else
+	{
+		weights[account_a] = weight_a;
+	}
+	sorted.insert (std::make_pair (weight_a, account_a));
+}
+
+void rai::rep_weights::load ()
+{
+	weights.clear ();
+	sorted.clear ();
+	rai::transaction transaction (store.environment, nullptr, false);
+	for (auto i (store.representation_begin (transaction)), n (store.representation_end ()); i != n; ++i)
+	{
+		rai::amount weight;
+		rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+		auto error (rai::read (stream, weight));
+		assert (!error);
+		set (i->first.uint256 (), weight.number ());
+	}
+	generation_low = generation_high = mdb_txn_id (transaction);
+}
+
+void rai::rep_weights::commit (uint64_t id_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	rai::rep_weights::overlay overlay;
+	auto existing (pending.find (id_a));
+	if (existing != pending.end ())
+	{
+		overlay = std::move (existing->second);
+		pending.erase (existing);
+	}
+	MDB_envinfo info;
+	auto status (mdb_env_info (store.environment, &info));
+	assert (status == 0);
+	if (info.me_last_txnid == id_a)
+	{
+		if (covers (id_a - 1) && !overlay.cleared)
+		{
+			for (auto & change : overlay.changes)
+			{
+				set (change.first, change.second);
+			}
+			if (!overlay.changes.empty ())
+			{
+				generation_low = id_a;
+			}
+			generation_high = id_a;
+		}
+		else
+		{
+			// Runs while further commits are held back so the snapshot read is the one just committed
+			load ();
+		}
+	}
+}
+
+std::vector<std::pair<rai::account, rai::amount_t>> rai::rep_weights::top (size_t count_a)
+{
+	std::vector<std::pair<rai::account, rai::amount_t>> result;
+	std::lock_guard<std::mutex> lock (mutex);
+	for (auto i (sorted.begin ()), n (sorted.end ()); i != n && result.size () < count_a; ++i)
+	{
+		result.push_back (std::make_pair (i->second, i->first));
+	}
+	return result;
+}
+
+size_t rai::rep_weights::size ()
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return weights.size ();
+}
+
+rai::block_store::block_store (bool & error_a, boost::filesystem::path const & path_a, int lmdb_max_dbs, size_t account_cache_size) :
 environment (error_a, path_a, lmdb_max_dbs),
+account_cache (environment, account_cache_size),
+rep_weights (*this),
 frontiers (invalid_db_handle),
 accounts (invalid_db_handle),
 //send_blocks (0),
@@ -236,13 +682,23 @@ comment_blocks (invalid_db_handle),
 pending (invalid_db_handle),
 blocks_info (invalid_db_handle),
 representation (invalid_db_handle),
+delegators (invalid_db_handle),
+comment_index (invalid_db_handle),
+comment_previous (invalid_db_handle),
+account_height (invalid_db_handle),
+account_height_enabled_m (false),
 unchecked (invalid_db_handle),
+unchecked_arrival (invalid_db_handle),
 checksum (invalid_db_handle),
 vote (invalid_db_handle),
 meta (invalid_db_handle)
 {
 	if (!error_a)
 	{
+		environment.commit_observer = [this](uint64_t id_a) {
+			account_cache.commit (id_a);
+			rep_weights.commit (id_a);
+		};
 		rai::transaction transaction (environment, nullptr, true);
 		error_a |= mdb_dbi_open (transaction, "frontiers", MDB_CREATE, &frontiers) != 0;
 		error_a |= mdb_dbi_open (transaction, "accounts_v13", MDB_CREATE, &accounts) != 0;
@@ -254,7 +710,12 @@ meta (invalid_db_handle)
 		error_a |= mdb_dbi_open (transaction, "pending", MDB_CREATE, &pending) != 0;
 		error_a |= mdb_dbi_open (transaction, "blocks_info", MDB_CREATE, &blocks_info) != 0;
 		error_a |= mdb_dbi_open (transaction, "representation", MDB_CREATE, &representation) != 0;
-		error_a |= mdb_dbi_open (transaction, "unchecked", MDB_CREATE | MDB_DUPSORT, &unchecked) != 0;
+		error_a |= mdb_dbi_open (transaction, "delegators", MDB_CREATE | MDB_DUPSORT, &delegators) != 0;
+		error_a |= mdb_dbi_open (transaction, "comment_index", MDB_CREATE | MDB_DUPSORT, &comment_index) != 0;
+		error_a |= mdb_dbi_open (transaction, "comment_previous", MDB_CREATE, &comment_previous) != 0;
+		error_a |= mdb_dbi_open (transaction, "account_height", MDB_CREATE, &account_height) != 0;
+		error_a |= mdb_dbi_open (transaction, "unchecked_v17", MDB_CREATE, &unchecked) != 0;
+		error_a |= mdb_dbi_open (transaction, "unchecked_arrival", MDB_CREATE, &unchecked_arrival) != 0;
 		error_a |= mdb_dbi_open (transaction, "checksum", MDB_CREATE, &checksum) != 0;
 		error_a |= mdb_dbi_open (transaction, "vote", MDB_CREATE, &vote) != 0;
 		error_a |= mdb_dbi_open (transaction, "meta", MDB_CREATE, &meta) != 0;
@@ -263,6 +724,9 @@ meta (invalid_db_handle)
 		{
 			error_a |= do_upgrades (transaction);
 			checksum_put (transaction, 0, 0, 0);
+			rai::uint256_union account_height_flag (4);
+			rai::mdb_val junk;
+			account_height_enabled_m = mdb_get (transaction, meta, rai::mdb_val (account_height_flag), junk) == 0;
 		}
 	}
 }
@@ -363,6 +827,21 @@ int rai::block_store::do_upgrades (MDB_txn * transaction_a)
 			res = upgrade_v12_to_v13 (transaction_a);
 			if (res) return res;
 		case 13:
+			res = upgrade_v13_to_v14 (transaction_a);
+			if (res) return res;
+		case 14:
+			res = upgrade_v14_to_v15 (transaction_a);
+			if (res) return res;
+		case 15:
+			res = upgrade_v15_to_v16 (transaction_a);
+			if (res) return res;
+		case 16:
+			res = upgrade_v16_to_v17 (transaction_a);
+			if (res) return res;
+		case 17:
+			res = upgrade_v17_to_v18 (transaction_a);
+			if (res) return res;
+		case 18:
 			// current
 			break;
 		default:
@@ -603,6 +1082,7 @@ int rai::block_store::upgrade_v11_to_v12 (MDB_txn * transaction_a)
 
 	mdb_drop (transaction_a, frontiers, 0);
 	mdb_drop (transaction_a, accounts, 0);
+	account_cache.clear (transaction_a);
 	//mdb_drop (transaction_a, send_blocks, 0);
 	//mdb_drop (transaction_a, receive_blocks, 0);
 	//mdb_drop (transaction_a, open_blocks, 0);
@@ -611,6 +1091,11 @@ int rai::block_store::upgrade_v11_to_v12 (MDB_txn * transaction_a)
 	mdb_drop (transaction_a, pending, 0);
 	mdb_drop (transaction_a, blocks_info, 0);
 	mdb_drop (transaction_a, representation, 0);
+	rep_weights.clear (transaction_a);
+	mdb_drop (transaction_a, delegators, 0);
+	mdb_drop (transaction_a, comment_index, 0);
+	mdb_drop (transaction_a, comment_previous, 0);
+	mdb_drop (transaction_a, account_height, 0);
 	mdb_drop (transaction_a, unchecked, 0);
 	mdb_drop (transaction_a, checksum, 0);
 	mdb_drop (transaction_a, vote, 0);
@@ -657,11 +1142,170 @@ int rai::block_store::upgrade_v12_to_v13 (MDB_txn * transaction_a)
 	return 0;
 }
 
+int rai::block_store::upgrade_v13_to_v14 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 14);
+
+	// Version 14:
+	// - Add the representative to delegators index, built from the existing accounts
+
+	if (delegators == 0 || delegators == invalid_db_handle)
+	{
+		assert (delegators != 0 && delegators != invalid_db_handle);
+		return 14;
+	}
+	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
+	{
+		rai::account account_l (i->first.uint256 ());
+		rai::account_info info (i->second);
+		auto block (block_get (transaction_a, info.rep_block));
+		assert (block != nullptr);
+		delegator_put (transaction_a, block->representative (), account_l);
+	}
+
+	return 0;
+}
+
+int rai::block_store::upgrade_v14_to_v15 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 15);
+
+	// Version 15:
+	// - Add the comment index, built from the comment blocks of the existing accounts
+
+	if (comment_index == 0 || comment_index == invalid_db_handle)
+	{
+		assert (comment_index != 0 && comment_index != invalid_db_handle);
+		return 15;
+	}
+	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
+	{
+		rai::account_info info (i->second);
+		if (!info.comment_block.is_zero ())
+		{
+			auto block (block_get (transaction_a, info.comment_block));
+			auto comment_block (dynamic_cast<rai::comment_block *> (block.get ()));
+			assert (comment_block != nullptr);
+			if (comment_block != nullptr)
+			{
+				comment_index_put (transaction_a, comment_block->comment (), i->first.uint256 ());
+			}
+		}
+	}
+
+	return 0;
+}
+
+int rai::block_store::upgrade_v15_to_v16 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 16);
+
+	// Version 16:
+	// - Every block value carries a sideband (account, height, balance, timestamp) before its successor
+	// - block_info is no longer written, drop the sparse entries
+
+	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
+	{
+		rai::account_info info (i->second);
+		// Walk from the open block so the predecessor's height is already in place
+		auto hash (info.open_block);
+		while (!hash.is_zero ())
+		{
+			auto block (block_get (transaction_a, hash));
+			assert (block != nullptr);
+			if (block == nullptr)
+			{
+				return 16;
+			}
+			auto successor (block_successor (transaction_a, hash));
+			block_put (transaction_a, hash, *block, successor);
+			hash = successor;
+		}
+	}
+	mdb_drop (transaction_a, blocks_info, 0);
+
+	return 0;
+}
+
+int rai::block_store::upgrade_v16_to_v17 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 17);
+
+	// Version 17:
+	// - unchecked is keyed by (dependency, block hash) instead of duplicates under the dependency, the value carries the arrival time
+	// - unchecked_arrival indexes the entries by arrival time
+	// - entries are moved over from the old table, with the upgrade time as arrival
+
+	MDB_dbi unchecked_v16;
+	if (0 == mdb_dbi_open (transaction_a, "unchecked", MDB_DUPSORT, &unchecked_v16))
+	{
+		auto now (seconds_since_epoch ());
+		for (rai::store_iterator i (transaction_a, unchecked_v16), n (nullptr); i != n; ++i)
+		{
+			rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+			std::shared_ptr<rai::block> block (rai::deserialize_block (stream));
+			if (block != nullptr)
+			{
+				unchecked_write (transaction_a, rai::unchecked_key (i->first.uint256 (), block->hash ()), rai::unchecked_info (block, now));
+			}
+		}
+		mdb_drop (transaction_a, unchecked_v16, 1);
+	}
+
+	return 0;
+}
+
+int rai::block_store::upgrade_v17_to_v18 (MDB_txn * transaction_a)
+{
+	version_put (transaction_a, 18);
+
+	// Version 18:
+	// - comment_previous links every comment block to the account's comment block before it, walking back from the current one
+
+	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
+	{
+		rai::account_info info (i->second);
+		rai::block_hash comment (0);
+		for (auto hash (info.comment_block); !hash.is_zero ();)
+		{
+			auto block (block_get (transaction_a, hash));
+			assert (block != nullptr);
+			if (block == nullptr)
+			{
+				return 18;
+			}
+			if (block->type () == rai::block_type::comment)
+			{
+				if (!comment.is_zero ())
+				{
+					comment_previous_put (transaction_a, comment, hash);
+				}
+				comment = hash;
+			}
+			hash = block->previous ();
+		}
+		if (!comment.is_zero ())
+		{
+			comment_previous_put (transaction_a, comment, 0);
+		}
+	}
+
+	return 0;
+}
+
 void rai::block_store::clear (MDB_dbi db_a)
 {
 	rai::transaction transaction (environment, nullptr, true);
 	auto status (mdb_drop (transaction, db_a, 0));
 	assert (status == 0);
+	if (db_a == accounts)
+	{
+		account_cache.clear (transaction);
+	}
+	if (db_a == representation)
+	{
+		rep_weights.clear (transaction);
+	}
 }
 
 rai::amount_t rai::block_store::block_balance (MDB_txn * transaction_a, rai::block_hash const & hash_a)
@@ -670,13 +1314,14 @@ rai::amount_t rai::block_store::block_balance (MDB_txn * transaction_a, rai::blo
 	{
 		return 0;
 	}
-	auto block (block_get (transaction_a, hash_a));
-	assert (block != nullptr);
-	if (block == nullptr)
+	rai::block_sideband sideband;
+	auto error (block_sideband_get (transaction_a, hash_a, sideband));
+	assert (!error);
+	if (error)
 	{
 		return 0;
 	}
-	return block->balance ().number ();
+	return sideband.balance.number ();
 }
 
 void rai::block_store::representation_add (MDB_txn * transaction_a, rai::block_hash const & source_a, rai::amount_t const & amount_a)
@@ -719,6 +1364,16 @@ void rai::block_store::block_put (MDB_txn * transaction_a, rai::block_hash const
 	{
 		rai::vectorstream stream (vector);
 		block_a.serialize (stream);
+		uint64_t height (1);
+		if (!block_a.previous ().is_zero ())
+		{
+			rai::block_sideband previous;
+			auto error (block_sideband_get (transaction_a, block_a.previous (), previous));
+			assert (!error);
+			height = error ? 0 : previous.height + 1;
+		}
+		rai::block_sideband sideband (block_a.account (), height, block_a.balance (), block_a.creation_time ().number ());
+		sideband.serialize (stream);
 		rai::write (stream, successor_a.bytes);
 	}
 	block_put_raw (transaction_a, block_database (block_a.type ()), hash_a, { vector.size (), vector.data () });
@@ -807,6 +1462,45 @@ rai::block_hash rai::block_store::block_successor (MDB_txn * transaction_a, rai:
 	return result;
 }
 
+bool rai::block_store::block_sideband_get (MDB_txn * transaction_a, rai::block_hash const & hash_a, rai::block_sideband & sideband_a)
+{
+	rai::block_type type;
+	auto value (block_get_raw (transaction_a, hash_a, type));
+	auto result (value.mv_size < rai::block_sideband::size + sizeof (rai::block_hash));
+	if (!result)
+	{
+		rai::bufferstream stream (reinterpret_cast<uint8_t const *> (value.mv_data) + value.mv_size - sizeof (rai::block_hash) - rai::block_sideband::size, rai::block_sideband::size);
+		result = sideband_a.deserialize (stream);
+		assert (!result);
+	}
+	return result;
+}
+
+rai::account rai::block_store::block_account (MDB_txn * transaction_a, rai::block_hash const & hash_a)
+{
+	rai::block_sideband sideband;
+	auto error (block_sideband_get (transaction_a, hash_a, sideband));
+	return error ? rai::account (0) : sideband.account;
+}
+
+size_t rai::block_store::block_serialized_get (MDB_txn * transaction_a, rai::block_hash const & hash_a, rai::stream & stream_a, rai::block_hash & previous_a)
+{
+	size_t result (0);
+	rai::block_type type;
+	auto value (block_get_raw (transaction_a, hash_a, type));
+	if (value.mv_size != 0)
+	{
+		assert (value.mv_size >= rai::block::previous_offset + sizeof (previous_a) + rai::block_sideband::size + sizeof (rai::block_hash));
+		auto data (reinterpret_cast<uint8_t const *> (value.mv_data));
+		std::copy (data + rai::block::previous_offset, data + rai::block::previous_offset + sizeof (previous_a), previous_a.bytes.begin ());
+		auto size (value.mv_size - rai::block_sideband::size - sizeof (rai::block_hash));
+		rai::write (stream_a, type);
+		rai::write_len (stream_a, size, data);
+		result = sizeof (type) + size;
+	}
+	return result;
+}
+
 void rai::block_store::block_successor_clear (MDB_txn * transaction_a, rai::block_hash const & hash_a)
 {
 	auto block (block_get (transaction_a, hash_a));
@@ -888,6 +1582,7 @@ void rai::block_store::account_del (MDB_txn * transaction_a, rai::account const
 {
 	auto status (mdb_del (transaction_a, accounts, rai::mdb_val (account_a), nullptr));
 	assert (status == 0);
+	account_cache.del (transaction_a, account_a);
 }
 
 bool rai::block_store::account_exists (MDB_txn * transaction_a, rai::account const & account_a)
@@ -905,6 +1600,11 @@ bool rai::block_store::account_exists (MDB_txn * transaction_a, rai::account con
 
 bool rai::block_store::account_get (MDB_txn * transaction_a, rai::account const & account_a, rai::account_info & info_a)
 {
+	bool exists;
+	if (!account_cache.get (transaction_a, account_a, info_a, exists))
+	{
+		return !exists;
+	}
 	rai::mdb_val value;
 	auto status (mdb_get (transaction_a, accounts, rai::mdb_val (account_a), value));
 	assert (status == 0 || status == MDB_NOTFOUND);
@@ -913,6 +1613,7 @@ bool rai::block_store::account_get (MDB_txn * transaction_a, rai::account const
 		return true;
 	}
 	info_a.deserialize_from_db (value);
+	account_cache.insert (transaction_a, account_a, info_a);
 	return false;
 }
 
@@ -953,6 +1654,7 @@ void rai::block_store::account_put (MDB_txn * transaction_a, rai::account const
 {
 	auto status (mdb_put (transaction_a, accounts, rai::mdb_val (account_a), info_a.serialize_to_db (), 0));
 	assert (status == 0);
+	account_cache.put (transaction_a, account_a, info_a);
 }
 
 void rai::block_store::pending_put (MDB_txn * transaction_a, rai::pending_key const & key_a, rai::pending_info const & pending_a)
@@ -1054,10 +1756,14 @@ bool rai::block_store::block_info_get (MDB_txn * transaction_a, rai::block_hash
 
 rai::amount_t rai::block_store::representation_get (MDB_txn * transaction_a, rai::account const & account_a)
 {
+	rai::amount_t result;
+	if (!rep_weights.get (transaction_a, account_a, result))
+	{
+		return result;
+	}
 	rai::mdb_val value;
 	auto status (mdb_get (transaction_a, representation, rai::mdb_val (account_a), value));
 	assert (status == 0 || status == MDB_NOTFOUND);
-	rai::amount_t result;
 	if (status == 0)
 	{
 		rai::amount rep;
@@ -1078,32 +1784,237 @@ void rai::block_store::representation_put (MDB_txn * transaction_a, rai::account
 	rai::amount rep (representation_a);
 	auto status (mdb_put (transaction_a, representation, rai::mdb_val (account_a), rai::mdb_val (rep), 0));
 	assert (status == 0);
+	rep_weights.put (transaction_a, account_a, representation_a);
+}
+
+void rai::block_store::delegator_put (MDB_txn * transaction_a, rai::account const & representative_a, rai::account const & account_a)
+{
+	auto status (mdb_put (transaction_a, delegators, rai::mdb_val (representative_a), rai::mdb_val (account_a), 0));
+	assert (status == 0);
+}
+
+void rai::block_store::delegator_del (MDB_txn * transaction_a, rai::account const & representative_a, rai::account const & account_a)
+{
+	auto status (mdb_del (transaction_a, delegators, rai::mdb_val (representative_a), rai::mdb_val (account_a)));
+	assert (status == 0 || status == MDB_NOTFOUND);
+}
+
+size_t rai::block_store::delegator_count (MDB_txn * transaction_a, rai::account const & representative_a)
+{
+	size_t result (0);
+	MDB_cursor * cursor;
+	auto status (mdb_cursor_open (transaction_a, delegators, &cursor));
+	assert (status == 0);
+	rai::mdb_val key (representative_a);
+	rai::mdb_val value;
+	if (mdb_cursor_get (cursor, key, value, MDB_SET) == 0)
+	{
+		auto status2 (mdb_cursor_count (cursor, &result));
+		assert (status2 == 0);
+	}
+	mdb_cursor_close (cursor);
+	return result;
+}
+
+namespace
+{
+std::array<uint8_t, 40> account_height_key (rai::account const & account_a, uint64_t height_a)
+{
+	std::array<uint8_t, 40> result;
+	std::copy (account_a.bytes.begin (), account_a.bytes.end (), result.begin ());
+	for (auto i (0); i < 8; ++i)
+	{
+		result[39 - i] = static_cast<uint8_t> (height_a >> (8 * i));
+	}
+	return result;
+}
+}
+
+bool rai::block_store::account_height_enabled ()
+{
+	return account_height_enabled_m;
+}
+
+uint64_t rai::block_store::account_height_build (MDB_txn * transaction_a)
+{
+	uint64_t result (0);
+	auto status (mdb_drop (transaction_a, account_height, 0));
+	assert (status == 0);
+	for (auto i (latest_begin (transaction_a)), n (latest_end ()); i != n; ++i)
+	{
+		rai::account account_l (i->first.uint256 ());
+		rai::account_info info (i->second);
+		auto height (info.block_count);
+		for (auto hash (info.head); !hash.is_zero () && height > 0; --height)
+		{
+			account_height_put (transaction_a, account_l, height, hash);
+			auto block (block_get (transaction_a, hash));
+			assert (block != nullptr);
+			hash = block->previous ();
+			++result;
+		}
+	}
+	rai::uint256_union account_height_flag (4);
+	rai::uint256_union enabled (1);
+	auto status2 (mdb_put (transaction_a, meta, rai::mdb_val (account_height_flag), rai::mdb_val (enabled), 0));
+	assert (status2 == 0);
+	account_height_enabled_m = true;
+	return result;
+}
+
+void rai::block_store::account_height_put (MDB_txn * transaction_a, rai::account const & account_a, uint64_t height_a, rai::block_hash const & hash_a)
+{
+	auto key (account_height_key (account_a, height_a));
+	auto status (mdb_put (transaction_a, account_height, rai::mdb_val (key.size (), key.data ()), rai::mdb_val (hash_a), 0));
+	assert (status == 0);
+}
+
+void rai::block_store::account_height_del (MDB_txn * transaction_a, rai::account const & account_a, uint64_t height_a)
+{
+	auto key (account_height_key (account_a, height_a));
+	auto status (mdb_del (transaction_a, account_height, rai::mdb_val (key.size (), key.data ()), nullptr));
+	assert (status == 0 || status == MDB_NOTFOUND);
+}
+
+rai::block_hash rai::block_store::account_height_get (MDB_txn * transaction_a, rai::account const & account_a, uint64_t height_a)
+{
+	auto key (account_height_key (account_a, height_a));
+	rai::mdb_val value;
+	auto status (mdb_get (transaction_a, account_height, rai::mdb_val (key.size (), key.data ()), value));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	rai::block_hash result (0);
+	if (status == 0)
+	{
+		result = value.uint256 ();
+	}
+	return result;
+}
+
+void rai::block_store::comment_index_put (MDB_txn * transaction_a, std::string const & comment_a, rai::account const & account_a)
+{
+	auto comment_upper (boost::to_upper_copy (comment_a));
+	for (size_t i (0), n (comment_upper.size ()); i < n; ++i)
+	{
+		auto status (mdb_put (transaction_a, comment_index, rai::mdb_val (n - i, &comment_upper[i]), rai::mdb_val (account_a), 0));
+		assert (status == 0);
+	}
+}
+
+void rai::block_store::comment_index_del (MDB_txn * transaction_a, std::string const & comment_a, rai::account const & account_a)
+{
+	auto comment_upper (boost::to_upper_copy (comment_a));
+	for (size_t i (0), n (comment_upper.size ()); i < n; ++i)
+	{
+		auto status (mdb_del (transaction_a, comment_index, rai::mdb_val (n - i, &comment_upper[i]), rai::mdb_val (account_a)));
+		assert (status == 0 || status == MDB_NOTFOUND);
+	}
+}
+
+std::vector<rai::account> rai::block_store::comment_index_search (MDB_txn * transaction_a, std::string const & pattern_a, size_t max_a)
+{
+	std::vector<rai::account> result;
+	std::unordered_set<rai::account> found;
+	auto pattern_upper (boost::to_upper_copy (pattern_a));
+	auto begin (pattern_upper.empty () ? rai::store_iterator (transaction_a, comment_index) : rai::store_iterator (transaction_a, comment_index, rai::mdb_val (pattern_upper.size (), &pattern_upper[0])));
+	for (auto i (std::move (begin)), n (rai::store_iterator (nullptr)); i != n && result.size () < max_a; ++i)
+	{
+		auto key (reinterpret_cast<char const *> (i->first.data ()));
+		if (i->first.size () < pattern_upper.size () || !std::equal (pattern_upper.begin (), pattern_upper.end (), key))
+		{
+			// Past the suffixes starting with the pattern
+			break;
+		}
+		rai::account account (i->second.uint256 ());
+		if (found.insert (account).second)
+		{
+			result.push_back (account);
+		}
+	}
+	return result;
+}
+
+void rai::block_store::comment_previous_put (MDB_txn * transaction_a, rai::block_hash const & hash_a, rai::block_hash const & previous_a)
+{
+	auto status (mdb_put (transaction_a, comment_previous, rai::mdb_val (hash_a), rai::mdb_val (previous_a), 0));
+	assert (status == 0);
+}
+
+void rai::block_store::comment_previous_del (MDB_txn * transaction_a, rai::block_hash const & hash_a)
+{
+	auto status (mdb_del (transaction_a, comment_previous, rai::mdb_val (hash_a), nullptr));
+	assert (status == 0 || status == MDB_NOTFOUND);
+}
+
+rai::block_hash rai::block_store::comment_previous_get (MDB_txn * transaction_a, rai::block_hash const & hash_a)
+{
+	rai::mdb_val value;
+	auto status (mdb_get (transaction_a, comment_previous, rai::mdb_val (hash_a), value));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	rai::block_hash result (0);
+	if (status == 0)
+	{
+		result = value.uint256 ();
+	}
+	return result;
 }
 
 void rai::block_store::unchecked_clear (MDB_txn * transaction_a)
 {
+	{
+		std::lock_guard<std::mutex> lock (cache_mutex);
+		unchecked_cache.clear ();
+	}
 	auto status (mdb_drop (transaction_a, unchecked, 0));
 	assert (status == 0);
+	auto status2 (mdb_drop (transaction_a, unchecked_arrival, 0));
+	assert (status2 == 0);
 }
 
 void rai::block_store::unchecked_put (MDB_txn * transaction_a, rai::block_hash const & hash_a, std::shared_ptr<rai::block> const & block_a)
 {
-	// Checking if same unchecked block is already in database
-	bool exists (false);
-	auto block_hash (block_a->hash ());
-	auto cached (unchecked_get (transaction_a, hash_a));
-	for (auto i (cached.begin ()), n (cached.end ()); i != n && !exists; ++i)
+	rai::unchecked_key key (hash_a, block_a->hash ());
+	rai::mdb_val junk;
+	auto status (mdb_get (transaction_a, unchecked, key.val (), junk));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	if (status == MDB_NOTFOUND)
 	{
-		if ((*i)->hash () == block_hash)
+		auto spill (false);
+		{
+			std::lock_guard<std::mutex> lock (cache_mutex);
+			auto inserted (unchecked_cache.insert (std::make_pair (key, rai::unchecked_info (block_a, seconds_since_epoch ()))));
+			spill = inserted.second && unchecked_cache.size () > unchecked_cache_max;
+		}
+		if (spill)
 		{
-			exists = true;
+			unchecked_flush (transaction_a);
 		}
 	}
-	// Inserting block if it wasn't found in database
-	if (!exists)
+}
+
+void rai::block_store::unchecked_write (MDB_txn * transaction_a, rai::unchecked_key const & key_a, rai::unchecked_info const & info_a)
+{
+	std::vector<uint8_t> vector;
+	{
+		rai::vectorstream stream (vector);
+		info_a.serialize (stream);
+	}
+	auto status (mdb_put (transaction_a, unchecked, key_a.val (), rai::mdb_val (vector.size (), vector.data ()), 0));
+	assert (status == 0);
+	auto arrival (unchecked_arrival_key (info_a.arrival, key_a));
+	auto status2 (mdb_put (transaction_a, unchecked_arrival, rai::mdb_val (arrival.size (), arrival.data ()), rai::mdb_val (0, nullptr), 0));
+	assert (status2 == 0);
+}
+
+void rai::block_store::unchecked_flush (MDB_txn * transaction_a)
+{
+	std::map<rai::unchecked_key, rai::unchecked_info> unchecked_cache_l;
 	{
 		std::lock_guard<std::mutex> lock (cache_mutex);
-		unchecked_cache.insert (std::make_pair (hash_a, block_a));
+		unchecked_cache_l.swap (unchecked_cache);
+	}
+	for (auto & i : unchecked_cache_l)
+	{
+		unchecked_write (transaction_a, i.first, i.second);
 	}
 }
 
@@ -1134,42 +2045,99 @@ std::vector<std::shared_ptr<rai::block>> rai::block_store::unchecked_get (MDB_tx
 	std::vector<std::shared_ptr<rai::block>> result;
 	{
 		std::lock_guard<std::mutex> lock (cache_mutex);
-		for (auto i (unchecked_cache.find (hash_a)), n (unchecked_cache.end ()); i != n && i->first == hash_a; ++i)
+		for (auto i (unchecked_cache.lower_bound (rai::unchecked_key (hash_a, 0))), n (unchecked_cache.end ()); i != n && i->first.dependency == hash_a; ++i)
 		{
-			result.push_back (i->second);
+			result.push_back (i->second.block);
 		}
 	}
-	for (auto i (unchecked_begin (transaction_a, hash_a)), n (unchecked_end ()); i != n && rai::block_hash (i->first.uint256 ()) == hash_a; i.next_dup ())
+	for (auto i (unchecked_begin (transaction_a, hash_a)), n (unchecked_end ()); i != n && rai::unchecked_key (i->first).dependency == hash_a; ++i)
 	{
 		rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-		result.push_back (rai::deserialize_block (stream));
+		rai::unchecked_info info;
+		auto error (info.deserialize (stream));
+		assert (!error);
+		result.push_back (info.block);
 	}
 	return result;
 }
 
 void rai::block_store::unchecked_del (MDB_txn * transaction_a, rai::block_hash const & hash_a, rai::block const & block_a)
 {
+	rai::unchecked_key key (hash_a, block_a.hash ());
 	{
 		std::lock_guard<std::mutex> lock (cache_mutex);
-		for (auto i (unchecked_cache.find (hash_a)), n (unchecked_cache.end ()); i != n && i->first == hash_a;)
+		unchecked_cache.erase (key);
+	}
+	rai::mdb_val value;
+	auto status (mdb_get (transaction_a, unchecked, key.val (), value));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	if (status == 0)
+	{
+		rai::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
+		uint64_t arrival;
+		auto error (rai::read (stream, arrival));
+		assert (!error);
+		auto arrival_key (unchecked_arrival_key (arrival, key));
+		auto status2 (mdb_del (transaction_a, unchecked_arrival, rai::mdb_val (arrival_key.size (), arrival_key.data ()), nullptr));
+		assert (status2 == 0 || status2 == MDB_NOTFOUND);
+		auto status3 (mdb_del (transaction_a, unchecked, key.val (), nullptr));
+		assert (status3 == 0);
+	}
+}
+
+void rai::block_store::unchecked_del (MDB_txn * transaction_a, rai::block_hash const & hash_a)
+{
+	{
+		std::lock_guard<std::mutex> lock (cache_mutex);
+		unchecked_cache.erase (unchecked_cache.lower_bound (rai::unchecked_key (hash_a, 0)), unchecked_cache.upper_bound (rai::unchecked_key (hash_a, std::numeric_limits<rai::uint256_t>::max ())));
+	}
+	// Collect first, deleting under an open iterator would move its cursor
+	std::vector<std::pair<rai::unchecked_key, uint64_t>> entries;
+	for (auto i (unchecked_begin (transaction_a, hash_a)), n (unchecked_end ()); i != n && rai::unchecked_key (i->first).dependency == hash_a; ++i)
+	{
+		rai::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+		uint64_t arrival;
+		auto error (rai::read (stream, arrival));
+		assert (!error);
+		entries.push_back (std::make_pair (rai::unchecked_key (i->first), arrival));
+	}
+	for (auto & entry : entries)
+	{
+		auto arrival_key (unchecked_arrival_key (entry.second, entry.first));
+		auto status (mdb_del (transaction_a, unchecked_arrival, rai::mdb_val (arrival_key.size (), arrival_key.data ()), nullptr));
+		assert (status == 0 || status == MDB_NOTFOUND);
+		auto status2 (mdb_del (transaction_a, unchecked, entry.first.val (), nullptr));
+		assert (status2 == 0);
+	}
+}
+
+size_t rai::block_store::unchecked_expire (MDB_txn * transaction_a, uint64_t cutoff_a, size_t max_a)
+{
+	std::vector<std::array<uint8_t, 72>> expired;
+	for (rai::store_iterator i (transaction_a, unchecked_arrival), n (nullptr); i != n && expired.size () < max_a; ++i)
+	{
+		assert (i->first.size () == 72);
+		std::array<uint8_t, 72> arrival_key;
+		std::copy (reinterpret_cast<uint8_t const *> (i->first.data ()), reinterpret_cast<uint8_t const *> (i->first.data ()) + arrival_key.size (), arrival_key.begin ());
+		uint64_t arrival (0);
+		for (auto j (0); j < 8; ++j)
 		{
-			if (*i->second == block_a)
-			{
-				i = unchecked_cache.erase (i);
-			}
-			else
-			{
-				++i;
-			}
+			arrival = (arrival << 8) | arrival_key[j];
 		}
+		if (arrival >= cutoff_a)
+		{
+			break;
+		}
+		expired.push_back (arrival_key);
 	}
-	std::vector<uint8_t> vector;
+	for (auto & arrival_key : expired)
 	{
-		rai::vectorstream stream (vector);
-		rai::serialize_block (stream, block_a);
+		auto status (mdb_del (transaction_a, unchecked_arrival, rai::mdb_val (arrival_key.size (), arrival_key.data ()), nullptr));
+		assert (status == 0);
+		auto status2 (mdb_del (transaction_a, unchecked, rai::mdb_val (sizeof (rai::unchecked_key), arrival_key.data () + 8), nullptr));
+		assert (status2 == 0 || status2 == MDB_NOTFOUND);
 	}
-	auto status (mdb_del (transaction_a, unchecked, rai::mdb_val (hash_a), rai::mdb_val (vector.size (), vector.data ())));
-	assert (status == 0 || status == MDB_NOTFOUND);
+	return expired.size ();
 }
 
 size_t rai::block_store::unchecked_count (MDB_txn * transaction_a)
@@ -1177,7 +2145,9 @@ size_t rai::block_store::unchecked_count (MDB_txn * transaction_a)
 	MDB_stat unchecked_stats;
 	auto status (mdb_stat (transaction_a, unchecked, &unchecked_stats));
 	assert (status == 0);
-	auto result (unchecked_stats.ms_entries);
+	size_t result (unchecked_stats.ms_entries);
+	std::lock_guard<std::mutex> lock (cache_mutex);
+	result += unchecked_cache.size ();
 	return result;
 }
 
@@ -1222,22 +2192,11 @@ void rai::block_store::checksum_del (MDB_txn * transaction_a, uint64_t prefix, u
 void rai::block_store::flush (MDB_txn * transaction_a)
 {
 	std::unordered_map<rai::account, std::shared_ptr<rai::vote>> sequence_cache_l;
-	std::unordered_multimap<rai::block_hash, std::shared_ptr<rai::block>> unchecked_cache_l;
 	{
 		std::lock_guard<std::mutex> lock (cache_mutex);
 		sequence_cache_l.swap (vote_cache);
-		unchecked_cache_l.swap (unchecked_cache);
-	}
-	for (auto & i : unchecked_cache_l)
-	{
-		std::vector<uint8_t> vector;
-		{
-			rai::vectorstream stream (vector);
-			rai::serialize_block (stream, *i.second);
-		}
-		auto status (mdb_put (transaction_a, unchecked, rai::mdb_val (i.first), rai::mdb_val (vector.size (), vector.data ()), 0));
-		assert (status == 0);
 	}
+	unchecked_flush (transaction_a);
 	for (auto i (sequence_cache_l.begin ()), n (sequence_cache_l.end ()); i != n; ++i)
 	{
 		std::vector<uint8_t> vector;
@@ -2,8 +2,14 @@
 
 #include <rai/secure/common.hpp>
 
+#include <list>
+#include <mutex>
+#include <set>
+
 namespace rai
 {
+class block_store;
+class stat;
 /**
  * Iterates the key/value pairs of a transaction
  */
@@ -38,13 +44,108 @@ class merged_store_kv
 class store_merge_iterator  
  */
 
+/**
+ * Bounded LRU cache of decoded account_info entries, split into independently locked shards.
+ * Cached entries are valid for the committed snapshots in [generation_low, generation_high], transactions reading any other snapshot bypass the cache.
+ * Changes made by a write transaction are kept in a pending overlay keyed by transaction id and written back when the transaction commits.
+ */
+class account_cache
+{
+public:
+	account_cache (rai::mdb_env &, size_t);
+	// Returns true if the account has to be read from disk, otherwise sets exists_a and info_a
+	bool get (MDB_txn *, rai::account const &, rai::account_info &, bool & exists_a);
+	// Caches a value read from disk by the given transaction
+	void insert (MDB_txn *, rai::account const &, rai::account_info const &);
+	void put (MDB_txn *, rai::account const &, rai::account_info const &);
+	void del (MDB_txn *, rai::account const &);
+	// Drops every entry once the given write transaction commits
+	void clear (MDB_txn *);
+	void commit (uint64_t);
+	void flush_stats ();
+	size_t size ();
+	size_t const capacity;
+	rai::stat * stats;
+	rai::mdb_env & environment;
+	static size_t constexpr shard_count = 16;
+	static size_t constexpr default_size = 64 * 1024;
+
+private:
+	class shard
+	{
+	public:
+		std::mutex mutex;
+		std::list<std::pair<rai::account, rai::account_info>> entries;
+		std::unordered_map<rai::account, std::list<std::pair<rai::account, rai::account_info>>::iterator> index;
+	};
+	class overlay
+	{
+	public:
+		overlay ();
+		// Deleted accounts map to nullptr
+		std::unordered_map<rai::account, std::unique_ptr<rai::account_info>> changes;
+		bool cleared;
+	};
+	rai::account_cache::shard & shard_for (rai::account const &);
+	// Whether the cached entries are those of the given committed snapshot
+	bool covers (uint64_t) const;
+	void insert_locked (rai::account_cache::shard &, rai::account const &, rai::account_info const &);
+	std::array<rai::account_cache::shard, shard_count> shards;
+	std::atomic<uint64_t> generation_low;
+	std::atomic<uint64_t> generation_high;
+	std::mutex pending_mutex;
+	std::unordered_map<uint64_t, rai::account_cache::overlay> pending;
+	std::mutex commit_mutex;
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	std::atomic<uint64_t> evictions;
+};
+
+/**
+ * In memory copy of the representation table with a view sorted by weight.
+ * It is valid for the committed snapshots in [generation_low, generation_high] and reloaded from disk when a commit cannot be applied incrementally.
+ */
+class rep_weights
+{
+public:
+	rep_weights (rai::block_store &);
+	// Returns true if the weight has to be read from disk
+	bool get (MDB_txn *, rai::account const &, rai::amount_t &);
+	void put (MDB_txn *, rai::account const &, rai::amount_t const &);
+	// Reloads every weight once the given write transaction commits
+	void clear (MDB_txn *);
+	void commit (uint64_t);
+	// Representatives with the highest weight first, as of the latest commit
+	std::vector<std::pair<rai::account, rai::amount_t>> top (size_t);
+	size_t size ();
+
+private:
+	class overlay
+	{
+	public:
+		overlay ();
+		std::unordered_map<rai::account, rai::amount_t> changes;
+		bool cleared;
+	};
+	void set (rai::account const &, rai::amount_t const &);
+	void load ();
+	bool covers (uint64_t) const;
+	rai::block_store & store;
+	std::mutex mutex;
+	std::unordered_map<rai::account, rai::amount_t> weights;
+	std::set<std::pair<rai::amount_t, rai::account>, std::greater<std::pair<rai::amount_t, rai::account>>> sorted;
+	uint64_t generation_low;
+	uint64_t generation_high;
+	std::unordered_map<uint64_t, rai::rep_weights::overlay> pending;
+};
+
 /**
  * Manages block storage and iteration
  */
 class block_store
 {
 public:
-	block_store (bool &, boost::filesystem::path const &, int lmdb_max_dbs = 128);
+	block_store (bool &, boost::filesystem::path const &, int lmdb_max_dbs = 128, size_t account_cache_size = rai::account_cache::default_size);
 
 	MDB_dbi block_database (rai::block_type);
 	void block_put_raw (MDB_txn *, MDB_dbi, rai::block_hash const &, MDB_val);
@@ -52,6 +153,11 @@ public:
 	MDB_val block_get_raw (MDB_txn *, rai::block_hash const &, rai::block_type &);
 	rai::block_hash block_successor (MDB_txn *, rai::block_hash const &);
 	void block_successor_clear (MDB_txn *, rai::block_hash const &);
+	// Read the sideband stored with the block, without deserializing the block.  Returns true on error.
+	bool block_sideband_get (MDB_txn *, rai::block_hash const &, rai::block_sideband &);
+	rai::account block_account (MDB_txn *, rai::block_hash const &);
+	// Write the block in wire format (type, then block) straight from the stored value and return its previous.  Returns the bytes written, 0 if not found.
+	size_t block_serialized_get (MDB_txn *, rai::block_hash const &, rai::stream &, rai::block_hash &);
 	std::unique_ptr<rai::block> block_get (MDB_txn *, rai::block_hash const &);
 	std::unique_ptr<rai::block> block_random (MDB_txn *);
 	std::unique_ptr<rai::block> block_random (MDB_txn *, MDB_dbi);
@@ -97,15 +203,47 @@ public:
 	rai::store_iterator representation_begin (MDB_txn *);
 	rai::store_iterator representation_end ();
 
+	void delegator_put (MDB_txn *, rai::account const &, rai::account const &);
+	void delegator_del (MDB_txn *, rai::account const &, rai::account const &);
+	size_t delegator_count (MDB_txn *, rai::account const &);
+	// Iterate with next_dup while the key matches the representative
+	rai::store_iterator delegators_begin (MDB_txn *, rai::account const &);
+	rai::store_iterator delegators_end ();
+
+	// The account height index is optional, it is only maintained once built
+	bool account_height_enabled ();
+	uint64_t account_height_build (MDB_txn *);
+	void account_height_put (MDB_txn *, rai::account const &, uint64_t, rai::block_hash const &);
+	void account_height_del (MDB_txn *, rai::account const &, uint64_t);
+	// Returns the zero hash if there is no block at the height
+	rai::block_hash account_height_get (MDB_txn *, rai::account const &, uint64_t);
+
+	void comment_index_put (MDB_txn *, std::string const &, rai::account const &);
+	void comment_index_del (MDB_txn *, std::string const &, rai::account const &);
+	// Accounts whose comment contains the pattern, case insensitive, at most the given count
+	std::vector<rai::account> comment_index_search (MDB_txn *, std::string const &, size_t);
+
+	void comment_previous_put (MDB_txn *, rai::block_hash const &, rai::block_hash const &);
+	void comment_previous_del (MDB_txn *, rai::block_hash const &);
+	// The account's comment block before the given one, the zero hash if it was the first
+	rai::block_hash comment_previous_get (MDB_txn *, rai::block_hash const &);
+
 	void unchecked_clear (MDB_txn *);
+	// Blocks already stored under the dependency are ignored. The block is kept in unchecked_cache until flush, or until the cache holds more than unchecked_cache_max entries.
 	void unchecked_put (MDB_txn *, rai::block_hash const &, std::shared_ptr<rai::block> const &);
 	std::vector<std::shared_ptr<rai::block>> unchecked_get (MDB_txn *, rai::block_hash const &);
 	void unchecked_del (MDB_txn *, rai::block_hash const &, rai::block const &);
+	// Delete every block waiting on the dependency
+	void unchecked_del (MDB_txn *, rai::block_hash const &);
+	// Delete at most the given count of stored blocks which arrived before the cutoff, in seconds since epoch. Returns the count deleted.
+	size_t unchecked_expire (MDB_txn *, uint64_t, size_t);
+	// Keys are rai::unchecked_key, values rai::unchecked_info
 	rai::store_iterator unchecked_begin (MDB_txn *);
 	rai::store_iterator unchecked_begin (MDB_txn *, rai::block_hash const &);
 	rai::store_iterator unchecked_end ();
 	size_t unchecked_count (MDB_txn *);
-	std::unordered_multimap<rai::block_hash, std::shared_ptr<rai::block>> unchecked_cache;
+	std::map<rai::unchecked_key, rai::unchecked_info> unchecked_cache;
+	static size_t constexpr unchecked_cache_max = 64 * 1024;
 
 	void checksum_put (MDB_txn *, uint64_t, uint8_t, rai::checksum const &);
 	bool checksum_get (MDB_txn *, uint64_t, uint8_t, rai::checksum &);
@@ -143,6 +281,11 @@ public:
 	*/
 	int upgrade_v11_to_v12 (MDB_txn *);
 	int upgrade_v12_to_v13 (MDB_txn *);
+	int upgrade_v13_to_v14 (MDB_txn *);
+	int upgrade_v14_to_v15 (MDB_txn *);
+	int upgrade_v15_to_v16 (MDB_txn *);
+	int upgrade_v16_to_v17 (MDB_txn *);
+	int upgrade_v17_to_v18 (MDB_txn *);
 
 	rai::raw_key node_id_get (MDB_txn *);
 	// Requires a write transaction
@@ -155,12 +298,18 @@ public:
 	void clear (MDB_dbi);
 
 	rai::mdb_env environment;
+	rai::account_cache account_cache;
+	rai::rep_weights rep_weights;
 	// Denotes an uninitialized DB handle
 	static const MDB_dbi invalid_db_handle = (MDB_dbi)-1;
 
 protected:
 	rai::store_iterator iterator_begin (MDB_txn *, MDB_dbi);
 	rai::store_iterator iterator_end (MDB_dbi);
+	// Write one unchecked entry along with its arrival index entry
+	void unchecked_write (MDB_txn *, rai::unchecked_key const &, rai::unchecked_info const &);
+	// Move unchecked_cache to the database
+	void unchecked_flush (MDB_txn *);
 
 	/**
 	 * Maps head block to owning account
@@ -176,13 +325,13 @@ protected:
 
 	/**
 	 * Maps block hash to state block.
-	 * rai::block_hash -> rai::state_block
+	 * rai::block_hash -> rai::state_block, rai::block_sideband, rai::block_hash (successor)
 	 */
 	MDB_dbi state_blocks;
 
 	/**
 	 * Maps block hash to comment block.
-	 * rai::block_hash -> rai::comment_block
+	 * rai::block_hash -> rai::comment_block, rai::block_sideband, rai::block_hash (successor)
 	 */
 	MDB_dbi comment_blocks;
 
@@ -193,7 +342,7 @@ protected:
 	MDB_dbi pending;
 
 	/**
-	 * Maps block hash to account and balance.
+	 * Maps block hash to account and balance.  Superseded by rai::block_sideband, no longer written.
 	 * block_hash -> rai::account, rai::amount
 	 */
 	MDB_dbi blocks_info;
@@ -205,11 +354,42 @@ protected:
 	MDB_dbi representation;
 
 	/**
-	 * Unchecked bootstrap blocks.
-	 * rai::block_hash -> rai::block
+	 * Accounts delegating to a representative, duplicates sorted.
+	 * rai::account -> rai::account
+	 */
+	MDB_dbi delegators;
+
+	/**
+	 * Every suffix of the uppercased account comments, duplicates sorted. A prefix seek finds the comments containing a pattern.
+	 * std::string -> rai::account
+	 */
+	MDB_dbi comment_index;
+
+	/**
+	 * Maps a comment block to the account's comment block before it, so rolling back a comment doesn't walk the chain.
+	 * rai::block_hash -> rai::block_hash
+	 */
+	MDB_dbi comment_previous;
+
+	/**
+	 * Maps account and block height, starting at 1 for the open block, to block hash. Optional.
+	 * rai::account, uint64_t (big endian) -> rai::block_hash
+	 */
+	MDB_dbi account_height;
+	std::atomic<bool> account_height_enabled_m;
+
+	/**
+	 * Unchecked bootstrap blocks, by the block they depend on.
+	 * rai::block_hash, rai::block_hash -> uint64_t, rai::block
 	 */
 	MDB_dbi unchecked;
 
+	/**
+	 * Unchecked blocks by arrival time, for expiry.
+	 * uint64_t (big endian), rai::block_hash, rai::block_hash -> nothing
+	 */
+	MDB_dbi unchecked_arrival;
+
 	/**
 	 * Mapping of region to checksum.
 	 * (uint56_t, uint8_t) -> rai::block_hash
@@ -8,6 +8,7 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/algorithm/string/replace.hpp>
 
+#include <cstring>
 #include <queue>
 
 #include <ed25519-donna/ed25519.h>
@@ -451,6 +452,112 @@ bool rai::block_info::operator== (rai::block_info const & other_a) const
 	return account == other_a.account && balance == other_a.balance;
 }
 
+size_t constexpr rai::block_sideband::size;
+
+rai::block_sideband::block_sideband () :
+account (0),
+height (0),
+balance (0),
+timestamp (0)
+{
+}
+
+rai::block_sideband::block_sideband (rai::account const & account_a, uint64_t height_a, rai::amount const & balance_a, rai::timestamp_t timestamp_a) :
+account (account_a),
+height (height_a),
+balance (balance_a),
+timestamp (timestamp_a)
+{
+}
+
+void rai::block_sideband::serialize (rai::stream & stream_a) const
+{
+	rai::write (stream_a, account.bytes);
+	rai::write (stream_a, height);
+	balance.serialize (stream_a);
+	rai::write (stream_a, timestamp);
+}
+
+bool rai::block_sideband::deserialize (rai::stream & stream_a)
+{
+	auto error (rai::read (stream_a, account.bytes));
+	if (!error)
+	{
+		error = rai::read (stream_a, height);
+		if (!error)
+		{
+			error = balance.deserialize (stream_a);
+			if (!error)
+			{
+				error = rai::read (stream_a, timestamp);
+			}
+		}
+	}
+	return error;
+}
+
+bool rai::block_sideband::operator== (rai::block_sideband const & other_a) const
+{
+	return account == other_a.account && height == other_a.height && balance == other_a.balance && timestamp == other_a.timestamp;
+}
+
+rai::unchecked_key::unchecked_key (rai::block_hash const & dependency_a, rai::block_hash const & hash_a) :
+dependency (dependency_a),
+hash (hash_a)
+{
+}
+
+rai::unchecked_key::unchecked_key (MDB_val const & val_a)
+{
+	assert (val_a.mv_size == sizeof (*this));
+	static_assert (sizeof (dependency) + sizeof (hash) == sizeof (*this), "Packed class");
+	std::copy (reinterpret_cast<uint8_t const *> (val_a.mv_data), reinterpret_cast<uint8_t const *> (val_a.mv_data) + sizeof (*this), reinterpret_cast<uint8_t *> (this));
+}
+
+bool rai::unchecked_key::operator== (rai::unchecked_key const & other_a) const
+{
+	return dependency == other_a.dependency && hash == other_a.hash;
+}
+
+bool rai::unchecked_key::operator< (rai::unchecked_key const & other_a) const
+{
+	return std::memcmp (this, &other_a, sizeof (*this)) < 0;
+}
+
+rai::mdb_val rai::unchecked_key::val () const
+{
+	return rai::mdb_val (sizeof (*this), const_cast<rai::unchecked_key *> (this));
+}
+
+rai::unchecked_info::unchecked_info () :
+arrival (0)
+{
+}
+
+rai::unchecked_info::unchecked_info (std::shared_ptr<rai::block> block_a, uint64_t arrival_a) :
+block (block_a),
+arrival (arrival_a)
+{
+}
+
+void rai::unchecked_info::serialize (rai::stream & stream_a) const
+{
+	assert (block != nullptr);
+	rai::write (stream_a, arrival);
+	rai::serialize_block (stream_a, *block);
+}
+
+bool rai::unchecked_info::deserialize (rai::stream & stream_a)
+{
+	auto error (rai::read (stream_a, arrival));
+	if (!error)
+	{
+		block = rai::deserialize_block (stream_a);
+		error = block == nullptr;
+	}
+	return error;
+}
+
 bool rai::vote::operator== (rai::vote const & other_a) const
 {
 	auto blocks_equal (true);
@@ -780,6 +887,7 @@ void rai::genesis::initialize (MDB_txn * transaction_a, rai::block_store & store
 	store_a.block_put (transaction_a, hash_l, *genesis_block, rai::block_hash (0));
 	store_a.account_put (transaction_a, genesis_account, { hash_l, genesis_block->hash (), genesis_block->hash (), 0, genesis_block->balance (), genesis_block->creation_time ().number (), 1 });
 	store_a.representation_put (transaction_a, genesis_account, genesis_block->balance ().number ());
+	store_a.delegator_put (transaction_a, genesis_block->representative (), genesis_account);
 	store_a.checksum_put (transaction_a, 0, 0, hash_l);
 	store_a.frontier_put (transaction_a, hash_l, genesis_account);
 }
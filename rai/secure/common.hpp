@@ -145,6 +145,52 @@ public:
 	rai::account account;
 	rai::amount balance;
 };
+/**
+ * Per-block metadata stored with every block, after the serialized block and before its successor.
+ * Lets account, height, balance and time of a block be read without deserializing it.
+ */
+class block_sideband
+{
+public:
+	block_sideband ();
+	block_sideband (rai::account const &, uint64_t, rai::amount const &, rai::timestamp_t);
+	void serialize (rai::stream &) const;
+	bool deserialize (rai::stream &);
+	bool operator== (rai::block_sideband const &) const;
+	rai::account account;
+	uint64_t height;
+	rai::amount balance;
+	::uint64_t timestamp; // in fact this is a rai::timestamp_t, stored on 8 bytes
+	static size_t constexpr size = sizeof (rai::account) + sizeof (uint64_t) + sizeof (rai::amount) + sizeof (uint64_t);
+};
+/**
+ * Key of the unchecked table, the hash a block is waiting for followed by the hash of the block itself.
+ * Orders like the database, so all blocks waiting on one dependency are adjacent.
+ */
+class unchecked_key
+{
+public:
+	unchecked_key (rai::block_hash const &, rai::block_hash const &);
+	unchecked_key (MDB_val const &);
+	bool operator== (rai::unchecked_key const &) const;
+	bool operator< (rai::unchecked_key const &) const;
+	rai::mdb_val val () const;
+	rai::block_hash dependency;
+	rai::block_hash hash;
+};
+/**
+ * Value of the unchecked table, the block and when it was put, in seconds since epoch
+ */
+class unchecked_info
+{
+public:
+	unchecked_info ();
+	unchecked_info (std::shared_ptr<rai::block>, uint64_t);
+	void serialize (rai::stream &) const;
+	bool deserialize (rai::stream &);
+	std::shared_ptr<rai::block> block;
+	uint64_t arrival;
+};
 class block_counts
 {
 public:
@@ -218,6 +264,12 @@ enum class process_result
 	invalid_comment_block = 15, // 0x0F a comment block with invalid parameters
 	invalid_comment_block_legacy = 16, // 0x10 Comment block is not allowed before an epoch time
 };
+enum class signature_verification
+{
+	unknown = 0, // Signature has not been checked yet, ledger will check it
+	invalid = 1, // Signature was checked and found bad
+	valid = 2 // Signature was checked up front, ledger can skip checking it
+};
 class process_return
 {
 public:
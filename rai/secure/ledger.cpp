@@ -4,6 +4,11 @@
 #include <rai/secure/ledger.hpp>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/endian/conversion.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstring>
 
 namespace
 {
@@ -68,7 +73,7 @@ public:
 		assert (!error);
 		//auto previous_version (ledger.store.block_version (transaction, block_a.previous ()));
 		auto previous_block (ledger.store.block_get (transaction, block_a.previous ()));
-		ledger.change_latest (transaction, block_a.account (), block_a.previous (), representative, info.comment_block, previous_balance, previous_block == nullptr ? 0 : previous_block->creation_time ().number (), info.block_count - 1, false);
+		ledger.change_latest (transaction, block_a.account (), block_a.previous (), representative, ledger.representative_get (transaction, representative), info.comment_block, previous_balance, previous_block == nullptr ? 0 : previous_block->creation_time ().number (), info.block_count - 1, false);
 
 		auto previous (ledger.store.block_get (transaction, block_a.previous ()));
 		if (previous != nullptr)
@@ -84,8 +89,24 @@ public:
 
 	void comment_block (rai::comment_block const & block_a) override
 	{
-		// TODO !!!
-		assert (false);
+		auto hash (block_a.hash ());
+		rai::account_info info;
+		auto error (ledger.store.account_get (transaction, block_a.account (), info));
+		assert (!error);
+		// Comment blocks keep the representative and do not move representation, only the comment is restored
+		auto previous_balance (ledger.balance (transaction, block_a.previous ()));
+		auto previous_comment (ledger.store.comment_previous_get (transaction, hash));
+		ledger.store.comment_previous_del (transaction, hash);
+		auto previous (ledger.store.block_get (transaction, block_a.previous ()));
+		assert (previous != nullptr);
+		ledger.change_latest (transaction, block_a.account (), block_a.previous (), block_a.previous (), block_a.representative (), previous_comment, previous_balance, previous->creation_time ().number (), info.block_count - 1, false);
+		ledger.store.block_successor_clear (transaction, block_a.previous ());
+		if (previous->type () < rai::block_type::state)
+		{
+			ledger.store.frontier_put (transaction, block_a.previous (), block_a.account ());
+		}
+		ledger.store.block_del (transaction, hash);
+		ledger.stats.inc (rai::stat::type::rollback, rai::stat::detail::comment_block);
 	}
 
 	MDB_txn * transaction;
@@ -95,7 +116,7 @@ public:
 class ledger_processor : public rai::block_visitor
 {
 public:
-	ledger_processor (rai::ledger &, MDB_txn *);
+	ledger_processor (rai::ledger &, MDB_txn *, rai::signature_verification = rai::signature_verification::unknown);
 	virtual ~ledger_processor () = default;
 	// Checks involving base_block members
 	rai::process_result base_block_check (rai::base_block const &);
@@ -105,6 +126,7 @@ public:
 	static bool check_time_sequence (rai::block const & new_block, std::unique_ptr<rai::block> & prev_block, rai::timestamp_t tolerance);
 	rai::ledger & ledger;
 	MDB_txn * transaction;
+	rai::signature_verification verification;
 	rai::process_return result;
 };
 
@@ -126,10 +148,13 @@ rai::process_result ledger_processor::base_block_check (rai::base_block const &
 	result_l = block_a.creation_time ().is_zero () ? rai::process_result::invalid_block_creation_time : rai::process_result::progress;
 	if (result_l != rai::process_result::progress)
 		return result_l;
-	// check signature
-	result_l = validate_message (block_a.account (), hash, block_a.signature_get ()) ? rai::process_result::bad_signature : rai::process_result::progress; // Is this block signed correctly (Unambiguous)
-	if (result_l != rai::process_result::progress)
-		return result_l;
+	// check signature, unless it has already been verified by the caller (e.g. batch verification in block_processor)
+	if (verification != rai::signature_verification::valid)
+	{
+		result_l = validate_message (block_a.account (), hash, block_a.signature_get ()) ? rai::process_result::bad_signature : rai::process_result::progress; // Is this block signed correctly (Unambiguous)
+		if (result_l != rai::process_result::progress)
+			return result_l;
+	}
 	result_l = block_a.account ().is_zero () ? rai::process_result::opened_burn_account : rai::process_result::progress; // Is this for the burn account? (Unambiguous)
 	if (result_l != rai::process_result::progress)
 		return result_l;
@@ -275,7 +300,7 @@ void ledger_processor::state_block (rai::state_block const & block_a)
 		}
 	}
 
-	ledger.change_latest (transaction, block_a.account (), hash, hash, info.comment_block, block_a.balance (), block_a.creation_time ().number (), info.block_count + 1, true);
+	ledger.change_latest (transaction, block_a.account (), hash, hash, block_a.representative (), info.comment_block, block_a.balance (), block_a.creation_time ().number (), info.block_count + 1, true);
 	if (!ledger.store.frontier_get (transaction, info.head).is_zero ())
 	{
 		ledger.store.frontier_del (transaction, info.head);
@@ -333,7 +358,8 @@ void ledger_processor::comment_block (rai::comment_block const & block_a)
 	// checks are OK
 	//ledger.stats.inc (rai::stat::type::ledger, rai::stat::detail::state_block);
 	ledger.store.block_put (transaction, hash, block_a, 0);
-	ledger.change_latest (transaction, block_a.account (), hash, hash, hash, block_a.balance (), block_a.creation_time ().number (), info.block_count + 1, true);
+	ledger.store.comment_previous_put (transaction, hash, info.comment_block);
+	ledger.change_latest (transaction, block_a.account (), hash, hash, block_a.representative (), hash, block_a.balance (), block_a.creation_time ().number (), info.block_count + 1, true);
 	if (!ledger.store.frontier_get (transaction, info.head).is_zero ())
 	{
 		ledger.store.frontier_del (transaction, info.head);
@@ -354,9 +380,10 @@ bool ledger_processor::check_time_sequence (rai::block const & new_block, std::u
 	return check_time_sequence (new_block.creation_time ().number (), prev_block->creation_time ().number (), tolerance);
 }
 
-ledger_processor::ledger_processor (rai::ledger & ledger_a, MDB_txn * transaction_a) :
+ledger_processor::ledger_processor (rai::ledger & ledger_a, MDB_txn * transaction_a, rai::signature_verification verification_a) :
 ledger (ledger_a),
-transaction (transaction_a)
+transaction (transaction_a),
+verification (verification_a)
 {
 }
 } // namespace
@@ -375,11 +402,154 @@ bool rai::shared_ptr_block_hash::operator() (std::shared_ptr<rai::block> const &
 
 const unsigned int rai::ledger::comment_search_max_count;
 
+size_t constexpr rai::bootstrap_weights::header_size;
+size_t constexpr rai::bootstrap_weights::record_size;
+
+rai::bootstrap_weights::bootstrap_weights () :
+max_blocks (0),
+records (nullptr),
+count (0)
+{
+}
+
+rai::bootstrap_weights::~bootstrap_weights ()
+{
+}
+
+bool rai::bootstrap_weights::load (uint8_t const * data_a, size_t size_a)
+{
+	auto result (size_a < header_size || (size_a - header_size) % record_size != 0);
+	if (!result)
+	{
+		rai::bufferstream stream (data_a, header_size);
+		rai::uint128_struct max_blocks_l;
+		result = rai::read (stream, max_blocks_l.bytes);
+		assert (!result);
+		max_blocks = static_cast<uint64_t> (max_blocks_l.number ());
+		records = data_a + header_size;
+		count = (size_a - header_size) / record_size;
+		auto less ([](uint8_t const * lhs_a, uint8_t const * rhs_a) {
+			return std::memcmp (lhs_a, rhs_a, sizeof (rai::account)) < 0;
+		});
+		auto sorted (true);
+		for (size_t i (1); i < count && sorted; ++i)
+		{
+			sorted = less (records + (i - 1) * record_size, records + i * record_size);
+		}
+		if (!sorted)
+		{
+			std::vector<std::array<uint8_t, record_size>> copy (count);
+			for (size_t i (0); i < count; ++i)
+			{
+				std::copy (records + i * record_size, records + (i + 1) * record_size, copy[i].begin ());
+			}
+			std::sort (copy.begin (), copy.end (), [&less](std::array<uint8_t, record_size> const & lhs_a, std::array<uint8_t, record_size> const & rhs_a) {
+				return less (lhs_a.data (), rhs_a.data ());
+			});
+			owned.resize (count * record_size);
+			for (size_t i (0); i < count; ++i)
+			{
+				std::copy (copy[i].begin (), copy[i].end (), owned.begin () + i * record_size);
+			}
+			records = owned.data ();
+		}
+	}
+	return result;
+}
+
+bool rai::bootstrap_weights::load (boost::filesystem::path const & path_a)
+{
+	auto result (false);
+	try
+	{
+		boost::interprocess::file_mapping file (path_a.string ().c_str (), boost::interprocess::read_only);
+		std::unique_ptr<boost::interprocess::mapped_region> region_l (new boost::interprocess::mapped_region (file, boost::interprocess::read_only));
+		result = load (static_cast<uint8_t const *> (region_l->get_address ()), region_l->get_size ());
+		if (!result)
+		{
+			region = std::move (region_l);
+		}
+	}
+	catch (boost::interprocess::interprocess_exception const &)
+	{
+		result = true;
+	}
+	return result;
+}
+
+void rai::bootstrap_weights::load (uint64_t max_blocks_a, std::vector<std::pair<rai::account, rai::amount_t>> const & weights_a)
+{
+	std::vector<uint8_t> buffer;
+	{
+		rai::vectorstream stream (buffer);
+		serialize (stream, max_blocks_a, weights_a);
+	}
+	region.reset ();
+	owned.swap (buffer);
+	auto error (load (owned.data (), owned.size ()));
+	assert (!error);
+}
+
+bool rai::bootstrap_weights::get (rai::account const & account_a, rai::amount_t & weight_a) const
+{
+	auto result (true);
+	size_t low (0);
+	size_t high (count);
+	while (low < high && result)
+	{
+		auto middle (low + (high - low) / 2);
+		auto record (records + middle * record_size);
+		auto compare (std::memcmp (record, account_a.bytes.data (), sizeof (rai::account)));
+		if (compare < 0)
+		{
+			low = middle + 1;
+		}
+		else if (compare > 0)
+		{
+			high = middle;
+		}
+		else
+		{
+			weight_a = 0;
+			for (auto i (sizeof (rai::account)); i < record_size; ++i)
+			{
+				weight_a = (weight_a << 8) | record[i];
+			}
+			result = false;
+		}
+	}
+	return result;
+}
+
+size_t rai::bootstrap_weights::size () const
+{
+	return count;
+}
+
+void rai::bootstrap_weights::serialize (rai::stream & stream_a, uint64_t max_blocks_a, std::vector<std::pair<rai::account, rai::amount_t>> weights_a)
+{
+	std::sort (weights_a.begin (), weights_a.end (), [](std::pair<rai::account, rai::amount_t> const & lhs_a, std::pair<rai::account, rai::amount_t> const & rhs_a) {
+		return std::memcmp (lhs_a.first.bytes.data (), rhs_a.first.bytes.data (), sizeof (rai::account)) < 0;
+	});
+	rai::uint128_struct max_blocks_l (max_blocks_a);
+	rai::write (stream_a, max_blocks_l.bytes);
+	for (auto & i : weights_a)
+	{
+		rai::write (stream_a, i.first.bytes);
+		rai::write (stream_a, boost::endian::native_to_big (i.second));
+	}
+}
+
 rai::ledger::ledger (rai::block_store & store_a, rai::stat & stat_a) :
 store (store_a),
 stats (stat_a),
-check_bootstrap_weights (true)
+bootstrap_weights_active (false)
+{
+}
+
+void rai::ledger::bootstrap_weights_enable (MDB_txn * transaction_a)
 {
+	bootstrap_weights_active = bootstrap_weights.size () != 0 && store.block_count (transaction_a).sum () < bootstrap_weights.max_blocks;
 }
 
 // Balance for account containing hash
@@ -395,19 +565,20 @@ rai::amount_t rai::ledger::balance_with_manna (MDB_txn * transaction_a, rai::blo
 	{
 		return 0;
 	}
-	auto block (store.block_get (transaction_a, hash_a));
-	assert (block != nullptr);
-	if (block == nullptr)
+	rai::block_sideband sideband;
+	auto error (store.block_sideband_get (transaction_a, hash_a, sideband));
+	assert (!error);
+	if (error)
 	{
 		return 0;
 	}
-	auto balance (block->balance ().number ());
-	if (!rai::manna_control::is_manna_account (block->account ()))
+	auto balance (sideband.balance.number ());
+	if (!rai::manna_control::is_manna_account (sideband.account))
 	{
 		return balance;
 	}
 	// manna adjustment
-	return rai::manna_control::adjust_balance_with_manna (block->account (), balance, block->creation_time ().number (), now);
+	return rai::manna_control::adjust_balance_with_manna (sideband.account, balance, sideband.timestamp, now);
 }
 
 // Balance for an account by account number
@@ -491,10 +662,18 @@ std::string rai::ledger::comment (MDB_txn * transaction_a, rai::block_hash const
 	return result;
 }
 
-rai::process_return rai::ledger::process (MDB_txn * transaction_a, rai::block const & block_a)
+rai::process_return rai::ledger::process (MDB_txn * transaction_a, rai::block const & block_a, rai::signature_verification verification_a)
 {
-	ledger_processor processor (*this, transaction_a);
+	ledger_processor processor (*this, transaction_a, verification_a);
 	block_a.visit (processor);
+	if (processor.result.code == rai::process_result::progress && bootstrap_weights_active.load (std::memory_order_relaxed))
+	{
+		if (store.block_count (transaction_a).sum () >= bootstrap_weights.max_blocks)
+		{
+			// One way switch, rollbacks do not bring the bootstrap weights back
+			bootstrap_weights_active = false;
+		}
+	}
 	return processor.result;
 }
 
@@ -554,41 +733,12 @@ rai::state_block_subtype rai::ledger::state_subtype (MDB_txn * transaction_a, ra
 
 std::vector<std::pair<rai::account, std::string>> rai::ledger::comment_search (MDB_txn * transaction_in, std::string comment_pattern_in, unsigned int max_count_in) const
 {
-	// Searches accounts by comment
-	// Note that this linear search (linear with no of accounts) is not very efficient, it would be better to use a special store for this (indexed by comment)
+	// Searches accounts by comment, case insensitive substring match answered from the comment index
 	std::vector<std::pair<rai::account, std::string>> res;
 	auto max (std::max (std::min (max_count_in, rai::ledger::comment_search_max_count), (unsigned int)1));
-	int res_count = 0;
-	boost::to_upper (comment_pattern_in);
-	auto pattern_len (comment_pattern_in.length ());
-	// iterate through accounts
-	for (auto i (store.latest_begin (transaction_in)), n (store.latest_end ()); i != n; ++i)
-	{
-		rai::account_info info (i->second);
-		if (info.comment_block.is_zero ())
-		{
-			continue; // no comment
-		}
-		auto comment (this->comment (transaction_in, info.comment_block));
-		if (comment.length () < pattern_len)
-		{
-			continue; // no comment or too short
-		}
-		// check for pattern match, case insensitive
-		auto comment_upper (comment);
-		boost::to_upper (comment_upper);
-		if (comment_upper.find (comment_pattern_in) == std::string::npos)
-		{
-			continue; // no match
-		}
-		auto account (rai::account (i->first.uint256 ()));
-		res.push_back (std::pair<rai::account, std::string> (account, comment));
-		++res_count;
-		if (res_count >= max)
-		{
-			// enough, stop searching for more
-			break;
-		}
+	for (auto & account : store.comment_index_search (transaction_in, comment_pattern_in, max))
+	{
+		res.push_back (std::pair<rai::account, std::string> (account, account_comment (transaction_in, account)));
 	}
 	return res;
 }
@@ -620,23 +770,12 @@ rai::block_hash rai::ledger::block_source (MDB_txn * transaction_a, rai::block c
 // Vote weight of an account
 rai::amount_t rai::ledger::weight (MDB_txn * transaction_a, rai::account const & account_a)
 {
-	if (check_bootstrap_weights.load ())
+	rai::amount_t result;
+	if (!bootstrap_weights_active.load (std::memory_order_relaxed) || bootstrap_weights.get (account_a, result))
 	{
-		auto blocks = store.block_count (transaction_a);
-		if (blocks.sum () < bootstrap_weight_max_blocks)
-		{
-			auto weight = bootstrap_weights.find (account_a);
-			if (weight != bootstrap_weights.end ())
-			{
-				return weight->second;
-			}
-		}
-		else
-		{
-			check_bootstrap_weights = false;
-		}
+		result = store.representation_get (transaction_a, account_a);
 	}
-	return store.representation_get (transaction_a, account_a);
+	return result;
 }
 
 // Rollback blocks until `block_a' doesn't exist
@@ -658,44 +797,8 @@ void rai::ledger::rollback (MDB_txn * transaction_a, rai::block_hash const & blo
 // Return account containing hash
 rai::account rai::ledger::account (MDB_txn * transaction_a, rai::block_hash const & hash_a)
 {
-	rai::account result;
-	auto hash (hash_a);
-	rai::block_hash successor (1);
-	rai::block_info block_info;
-	std::unique_ptr<rai::block> block (store.block_get (transaction_a, hash));
-	if (block == nullptr)
-	{
-		// block not found
-		assert (!result.is_zero ());
-		return result;
-	}
-	while (!successor.is_zero () && block->type () != rai::block_type::state && block->type () != rai::block_type::comment && store.block_info_get (transaction_a, successor, block_info))
-	{
-		successor = store.block_successor (transaction_a, hash);
-		if (!successor.is_zero ())
-		{
-			hash = successor;
-			block = store.block_get (transaction_a, hash);
-		}
-	}
-	/*
-	if (block->type () == rai::block_type::state)
-	{
-		auto state_block (dynamic_cast<rai::state_block *> (block.get ()));
-		result = state_block->account ();
-	}
-	else if (successor.is_zero ())
-	{
-		result = store.frontier_get (transaction_a, hash);
-	}
-	else
-	{
-		result = block_info.account;
-	}
-	*/
-	result = block->account ();
-	assert (!result.is_zero ());
-	return result;
+	// Zero if the block is not found
+	return store.block_account (transaction_a, hash_a);
 }
 
 // Return amount decrease or increase for block (absolute value)
@@ -734,18 +837,19 @@ rai::amount_t rai::ledger::amount_with_sign (MDB_txn * transaction_a, rai::block
 		return balance;
 	}
 	// prev_hash != 0
-	auto prev_block (store.block_get (transaction_a, prev_hash));
-	assert (prev_block != nullptr);
-	if (prev_block == nullptr)
+	rai::block_sideband prev_sideband;
+	auto error (store.block_sideband_get (transaction_a, prev_hash, prev_sideband));
+	assert (!error);
+	if (error)
 	{
 		amount_sign = 1;
 		return balance;
 	}
-	auto prev_balance (prev_block->balance ().number ());
-	if (rai::manna_control::is_manna_account (prev_block->account ()))
+	auto prev_balance (prev_sideband.balance.number ());
+	if (rai::manna_control::is_manna_account (prev_sideband.account))
 	{
 		// manna adjustment
-		prev_balance = rai::manna_control::adjust_balance_with_manna (prev_block->account (), prev_balance, prev_block->creation_time ().number (), block->creation_time ().number ());
+		prev_balance = rai::manna_control::adjust_balance_with_manna (prev_sideband.account, prev_balance, prev_sideband.timestamp, block->creation_time ().number ());
 	}
 	rai::amount_t amount = 0;
 	if (prev_balance < balance)
@@ -859,10 +963,54 @@ void rai::ledger::checksum_update (MDB_txn * transaction_a, rai::block_hash cons
 	store.checksum_put (transaction_a, 0, 0, value);
 }
 
-void rai::ledger::change_latest (MDB_txn * transaction_a, rai::account const & account_a, rai::block_hash const & hash_a, rai::block_hash const & rep_block_a, rai::block_hash const & comment_block_a, rai::amount const & balance_a, rai::timestamp_t last_block_time_a, uint64_t block_count_a, bool is_state)
+void rai::ledger::change_latest (MDB_txn * transaction_a, rai::account const & account_a, rai::block_hash const & hash_a, rai::block_hash const & rep_block_a, rai::account const & representative_a, rai::block_hash const & comment_block_a, rai::amount const & balance_a, rai::timestamp_t last_block_time_a, uint64_t block_count_a, bool is_state)
 {
 	rai::account_info info;
 	auto exists (!store.account_get (transaction_a, account_a, info));
+	auto old_rep_block (exists ? info.rep_block : rai::block_hash (0));
+	auto new_rep_block (hash_a.is_zero () ? rai::block_hash (0) : rep_block_a);
+	// The caller knows the new representative, the old one is only read when the representative block changes
+	if (old_rep_block != new_rep_block)
+	{
+		auto old_representative (exists ? representative_get (transaction_a, info.rep_block) : rai::account (0));
+		auto new_representative (hash_a.is_zero () ? rai::account (0) : representative_a);
+		if (old_representative != new_representative)
+		{
+			if (exists)
+			{
+				store.delegator_del (transaction_a, old_representative, account_a);
+			}
+			if (!hash_a.is_zero ())
+			{
+				store.delegator_put (transaction_a, new_representative, account_a);
+			}
+		}
+	}
+	if (store.account_height_enabled ())
+	{
+		uint64_t old_count (exists ? info.block_count : 0);
+		uint64_t new_count (hash_a.is_zero () ? 0 : block_count_a);
+		for (auto height (new_count + 1); height <= old_count; ++height)
+		{
+			store.account_height_del (transaction_a, account_a, height);
+		}
+		if (new_count > old_count)
+		{
+			store.account_height_put (transaction_a, account_a, new_count, hash_a);
+		}
+	}
+	auto new_comment_block (hash_a.is_zero () ? rai::block_hash (0) : comment_block_a);
+	if (exists && info.comment_block != new_comment_block)
+	{
+		if (!info.comment_block.is_zero ())
+		{
+			store.comment_index_del (transaction_a, comment (transaction_a, info.comment_block), account_a);
+		}
+		if (!new_comment_block.is_zero ())
+		{
+			store.comment_index_put (transaction_a, comment (transaction_a, new_comment_block), account_a);
+		}
+	}
 	if (exists)
 	{
 		checksum_update (transaction_a, info.head);
@@ -887,13 +1035,6 @@ void rai::ledger::change_latest (MDB_txn * transaction_a, rai::account const & a
 			store.account_del (transaction_a, account_a);
 		}
 		store.account_put (transaction_a, account_a, info);
-		if (!(block_count_a % store.block_info_max) && !is_state)
-		{
-			rai::block_info block_info;
-			block_info.account = account_a;
-			block_info.balance = balance_a;
-			store.block_info_put (transaction_a, hash_a, block_info);
-		}
 		checksum_update (transaction_a, hash_a);
 	}
 	else
@@ -2,11 +2,52 @@
 
 #include <rai/secure/common.hpp>
 
+#include <boost/filesystem/path.hpp>
+
+namespace boost
+{
+namespace interprocess
+{
+	class mapped_region;
+}
+}
+
 namespace rai
 {
 class block_store;
 class stat;
 
+/**
+ * Representative weights used while the ledger holds fewer than max_blocks blocks.
+ * Format, as in rep_weights.bin: max_blocks (uint128, big endian), then records of account and weight (uint64, big endian) sorted by account.
+ * Records are binary searched in place, in the embedded blob or a memory mapped file. Unsorted input is copied and sorted once.
+ */
+class bootstrap_weights
+{
+public:
+	bootstrap_weights ();
+	~bootstrap_weights ();
+	// The buffer must outlive this object. Returns true on error.
+	bool load (uint8_t const *, size_t);
+	// Memory maps the file. Returns true on error.
+	bool load (boost::filesystem::path const &);
+	// Replace the records with a copy, sorted
+	void load (uint64_t, std::vector<std::pair<rai::account, rai::amount_t>> const &);
+	// Returns true if the account has no bootstrap weight
+	bool get (rai::account const &, rai::amount_t &) const;
+	size_t size () const;
+	static void serialize (rai::stream &, uint64_t, std::vector<std::pair<rai::account, rai::amount_t>>);
+	uint64_t max_blocks;
+	static size_t constexpr header_size = 16;
+	static size_t constexpr record_size = sizeof (rai::account) + sizeof (uint64_t);
+
+private:
+	uint8_t const * records;
+	size_t count;
+	std::vector<uint8_t> owned;
+	std::unique_ptr<boost::interprocess::mapped_region> region;
+};
+
 class shared_ptr_block_hash
 {
 public:
@@ -42,9 +83,10 @@ public:
 	std::vector<std::pair<rai::account, std::string>> comment_search (MDB_txn *, std::string, unsigned int) const;
 	rai::block_hash block_destination (MDB_txn *, rai::block const &);
 	rai::block_hash block_source (MDB_txn *, rai::block const &);
-	rai::process_return process (MDB_txn *, rai::block const &);
+	rai::process_return process (MDB_txn *, rai::block const &, rai::signature_verification = rai::signature_verification::unknown);
 	void rollback (MDB_txn *, rai::block_hash const &);
-	void change_latest (MDB_txn *, rai::account const &, rai::block_hash const &, rai::block_hash const &, rai::block_hash const &, rai::amount const &, rai::timestamp_t, uint64_t, bool = false);
+	// The representative is the one named by the representative block, passed in so it isn't read back from the store
+	void change_latest (MDB_txn *, rai::account const &, rai::block_hash const &, rai::block_hash const &, rai::account const &, rai::block_hash const &, rai::amount const &, rai::timestamp_t, uint64_t, bool = false);
 	void checksum_update (MDB_txn *, rai::block_hash const &);
 	rai::checksum checksum (MDB_txn *, rai::account const &, rai::account const &);
 	void dump_account_chain (rai::account const &);
@@ -53,10 +95,11 @@ public:
 	static const rai::timestamp_t time_tolearance_long = 33360; // seconds
 	static const unsigned int comment_search_max_count = 100; // hard limit
 	static rai::amount_t const unit;
+	// Use bootstrap_weights if the ledger is below their max_blocks. Once switched off, weights come from the store only.
+	void bootstrap_weights_enable (MDB_txn *);
 	rai::block_store & store;
 	rai::stat & stats;
-	std::unordered_map<rai::account, rai::amount_t> bootstrap_weights;
-	uint64_t bootstrap_weight_max_blocks;
-	std::atomic<bool> check_bootstrap_weights;
+	rai::bootstrap_weights bootstrap_weights;
+	std::atomic<bool> bootstrap_weights_active;
 };
 };
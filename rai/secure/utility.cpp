@@ -57,7 +57,8 @@ std::vector<boost::filesystem::path> rai::remove_temporary_directories ()
 	return all_unique_paths;
 }
 
-rai::mdb_env::mdb_env (bool & error_a, boost::filesystem::path const & path_a, int max_dbs)
+rai::mdb_env::mdb_env (bool & error_a, boost::filesystem::path const & path_a, int max_dbs) :
+write_id (0)
 {
 	boost::system::error_code error;
 	if (path_a.has_parent_path ())
@@ -176,7 +177,8 @@ rai::mdb_val::operator MDB_val const & () const
 }
 
 rai::transaction::transaction (rai::mdb_env & environment_a, MDB_txn * parent_a, bool write) :
-environment (environment_a)
+environment (environment_a),
+nested (parent_a != nullptr)
 {
 	assert (environment_a.environment != NULL);
 	if (environment_a.environment != NULL)
@@ -184,13 +186,33 @@ environment (environment_a)
 		auto status (mdb_txn_begin (environment_a, parent_a, write ? 0 : MDB_RDONLY, &handle));
 		assert (status == 0);
 		open_for_write = write;
+		if (write && !nested)
+		{
+			environment_a.write_id = mdb_txn_id (handle);
+		}
 	}
 }
 
 rai::transaction::~transaction ()
 {
-	auto status (mdb_txn_commit (handle));
-	assert (status == 0);
+	if (open_for_write && !nested)
+	{
+		// Top level commits are serialized with the observer so it sees them in order
+		std::lock_guard<std::mutex> lock (environment.commit_mutex);
+		uint64_t id (mdb_txn_id (handle));
+		environment.write_id = 0;
+		auto status (mdb_txn_commit (handle));
+		assert (status == 0);
+		if (environment.commit_observer)
+		{
+			environment.commit_observer (id);
+		}
+	}
+	else
+	{
+		auto status (mdb_txn_commit (handle));
+		assert (status == 0);
+	}
 }
 
 rai::transaction::operator MDB_txn * () const
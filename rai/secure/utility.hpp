@@ -3,6 +3,8 @@
 #include <array>
 #include <atomic>
 #include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <type_traits>
 
 #include <boost/filesystem.hpp>
@@ -111,6 +113,11 @@ public:
 	~mdb_env ();
 	operator MDB_env * () const;
 	MDB_env * environment;
+	/** Id of the open top level write transaction, zero if there is none */
+	std::atomic<uint64_t> write_id;
+	std::mutex commit_mutex;
+	/** Called with the id of every top level write transaction once it has been committed, no other top level write transaction commits until it returns */
+	std::function<void(uint64_t)> commit_observer;
 };
 
 /**
@@ -146,5 +153,6 @@ public:
 	MDB_txn * handle;
 	rai::mdb_env & environment;
 	bool open_for_write;
+	bool nested;
 };
 }